@@ -0,0 +1,609 @@
+#include "catalogue_image.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace transport::image {
+
+	using namespace std;
+
+	namespace {
+
+		uint64_t AlignUp(uint64_t value) {
+			return (value + 7) & ~uint64_t{ 7 };
+		}
+
+		uint32_t CheckedU32(size_t value) {
+			if (value > numeric_limits<uint32_t>::max()) {
+				throw ImageError("catalogue is too big for the image format"s);
+			}
+			return static_cast<uint32_t>(value);
+		}
+
+		// CSR offsets of the indexes may cover only a prefix of the stops; the image has a row per stop
+		vector<uint32_t> NormalizeOffsets(const vector<uint32_t>& offsets, size_t row_count) {
+			vector<uint32_t> result(row_count + 1, 0);
+			if (offsets.empty()) {
+				return result;
+			}
+			for (size_t i = 0; i <= row_count; ++i) {
+				result[i] = offsets[min(i, offsets.size() - 1)];
+			}
+			return result;
+		}
+
+		template <typename T>
+		void WriteSection(ostream& output, uint64_t& written, const Section& section, const T* data) {
+			static const char padding[8] = {};
+			output.write(padding, section.offset - written);
+			output.write(reinterpret_cast<const char*>(data), section.count * sizeof(T));
+			written = section.offset + section.count * sizeof(T);
+		}
+
+	}
+
+	void SaveImage(const TransportCatalogue& catalogue, std::ostream& output) {
+
+		const size_t stop_count = catalogue.GetStopCount();
+		const size_t bus_count = catalogue.GetRouteCount();
+
+		string strings;
+		vector<StopRecord> stops(stop_count);
+		vector<StopId> stops_by_name;
+		for (StopId id = 0; id < stop_count; ++id) {
+			const Stop* stop = catalogue.GetStop(id);
+			stops[id] = { stop->coords.lat, stop->coords.lng, CheckedU32(strings.size()), CheckedU32(stop->name.size()) };
+			strings += stop->name;
+			// with duplicate names only the stop found by name in the catalogue is searchable
+			if (catalogue.GetStop(stop->name) == stop) {
+				stops_by_name.push_back(id);
+			}
+		}
+		sort(stops_by_name.begin(), stops_by_name.end(), [&catalogue](StopId lhs, StopId rhs) {
+			return catalogue.GetStop(lhs)->name < catalogue.GetStop(rhs)->name;
+			});
+
+		vector<BusRecord> buses(bus_count);
+		vector<BusId> buses_by_name;
+		vector<StopId> route_stops;
+		for (BusId id = 0; id < bus_count; ++id) {
+			const Bus* bus = catalogue.GetRoute(id);
+			const RouteInfo info = catalogue.GetRouteInfo(id);
+			const auto& stop_ids = catalogue.GetRouteStops(id);
+
+			buses[id] = { CheckedU32(strings.size()), CheckedU32(bus->name.size()),
+				CheckedU32(route_stops.size()), CheckedU32(stop_ids.size()), CheckedU32(info.unique_stops_amount),
+				bus->isRing, info.length, info.geo_length, info.curvature };
+			strings += bus->name;
+			route_stops.insert(route_stops.end(), stop_ids.cbegin(), stop_ids.cend());
+			if (catalogue.GetRoute(bus->name) == bus) {
+				buses_by_name.push_back(id);
+			}
+		}
+		sort(buses_by_name.begin(), buses_by_name.end(), [&catalogue](BusId lhs, BusId rhs) {
+			return catalogue.GetRoute(lhs)->name < catalogue.GetRoute(rhs)->name;
+			});
+
+		const StopBusIndex& stop_buses = catalogue.GetStopBusIndex();
+		const vector<uint32_t> stop_bus_offsets = NormalizeOffsets(stop_buses.GetOffsets(), stop_count);
+		const DistanceTable& distances = catalogue.GetDistanceTable();
+		const vector<uint32_t> distance_offsets = NormalizeOffsets(distances.GetOffsets(), stop_count);
+
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.format_version = FORMAT_VERSION;
+		header.byte_order = BYTE_ORDER_MARK;
+
+		uint64_t size = sizeof(Header);
+		const auto place = [&size](Section& section, size_t count, size_t element_size) {
+			section = { AlignUp(size), count };
+			size = section.offset + count * element_size;
+		};
+		place(header.strings, strings.size(), sizeof(char));
+		place(header.stops, stops.size(), sizeof(StopRecord));
+		place(header.stops_by_name, stops_by_name.size(), sizeof(StopId));
+		place(header.buses, buses.size(), sizeof(BusRecord));
+		place(header.buses_by_name, buses_by_name.size(), sizeof(BusId));
+		place(header.route_stops, route_stops.size(), sizeof(StopId));
+		place(header.stop_bus_offsets, stop_bus_offsets.size(), sizeof(uint32_t));
+		place(header.stop_bus_ids, stop_buses.GetBusIds().size(), sizeof(BusId));
+		place(header.distance_offsets, distance_offsets.size(), sizeof(uint32_t));
+		place(header.distances, distances.GetEntries().size(), sizeof(DistanceTable::Entry));
+		header.file_size = size;
+
+		uint64_t written = 0;
+		WriteSection(output, written, { 0, 1 }, &header);
+		WriteSection(output, written, header.strings, strings.data());
+		WriteSection(output, written, header.stops, stops.data());
+		WriteSection(output, written, header.stops_by_name, stops_by_name.data());
+		WriteSection(output, written, header.buses, buses.data());
+		WriteSection(output, written, header.buses_by_name, buses_by_name.data());
+		WriteSection(output, written, header.route_stops, route_stops.data());
+		WriteSection(output, written, header.stop_bus_offsets, stop_bus_offsets.data());
+		WriteSection(output, written, header.stop_bus_ids, stop_buses.GetBusIds().data());
+		WriteSection(output, written, header.distance_offsets, distance_offsets.data());
+		WriteSection(output, written, header.distances, distances.GetEntries().data());
+
+		if (!output) {
+			throw ImageError("failed to write catalogue image"s);
+		}
+	}
+
+	MappedCatalogue::MappedCatalogue(const std::string& path) {
+
+#ifdef _WIN32
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) {
+			file_ = nullptr;
+			throw ImageError("cannot open "s + path);
+		}
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart < static_cast<LONGLONG>(sizeof(Header))) {
+			Unmap();
+			throw ImageError("not a catalogue image: "s + path);
+		}
+		size_ = static_cast<size_t>(file_size.QuadPart);
+		mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_) {
+			data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (!data_) {
+			Unmap();
+			throw ImageError("cannot map "s + path);
+		}
+#else
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw ImageError("cannot open "s + path);
+		}
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(Header))) {
+			close(fd);
+			throw ImageError("not a catalogue image: "s + path);
+		}
+		size_ = static_cast<size_t>(file_stat.st_size);
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			throw ImageError("cannot map "s + path);
+		}
+		data_ = static_cast<const char*>(data);
+#endif
+
+		header_ = reinterpret_cast<const Header*>(data_);
+		try {
+			ValidateHeader();
+		}
+		catch (...) {
+			Unmap();
+			throw;
+		}
+	}
+
+	MappedCatalogue::MappedCatalogue(MappedCatalogue&& other) noexcept {
+		*this = move(other);
+	}
+
+	MappedCatalogue& MappedCatalogue::operator=(MappedCatalogue&& other) noexcept {
+		if (this != &other) {
+			Unmap();
+			swap(data_, other.data_);
+			swap(size_, other.size_);
+			swap(header_, other.header_);
+#ifdef _WIN32
+			swap(file_, other.file_);
+			swap(mapping_, other.mapping_);
+#endif
+		}
+		return *this;
+	}
+
+	MappedCatalogue::~MappedCatalogue() {
+		Unmap();
+	}
+
+	void MappedCatalogue::Unmap() {
+#ifdef _WIN32
+		if (data_) {
+			UnmapViewOfFile(data_);
+		}
+		if (mapping_) {
+			CloseHandle(mapping_);
+		}
+		if (file_) {
+			CloseHandle(file_);
+		}
+		file_ = nullptr;
+		mapping_ = nullptr;
+#else
+		if (data_) {
+			munmap(const_cast<char*>(data_), size_);
+		}
+#endif
+		data_ = nullptr;
+		size_ = 0;
+		header_ = nullptr;
+	}
+
+	void MappedCatalogue::ValidateHeader() const {
+
+		if (memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw ImageError("not a catalogue image"s);
+		}
+		if (header_->format_version != FORMAT_VERSION) {
+			throw ImageError("unsupported catalogue image version "s + to_string(header_->format_version));
+		}
+		if (header_->byte_order != BYTE_ORDER_MARK) {
+			throw ImageError("catalogue image has foreign byte order"s);
+		}
+		if (header_->file_size != size_) {
+			throw ImageError("catalogue image is truncated"s);
+		}
+
+		const auto check = [this](const Section& section, size_t element_size) {
+			if (section.offset % 8 != 0 || section.offset > size_
+				|| section.count > (size_ - section.offset) / element_size) {
+				throw ImageError("catalogue image section is out of bounds"s);
+			}
+		};
+		check(header_->strings, sizeof(char));
+		check(header_->stops, sizeof(StopRecord));
+		check(header_->stops_by_name, sizeof(StopId));
+		check(header_->buses, sizeof(BusRecord));
+		check(header_->buses_by_name, sizeof(BusId));
+		check(header_->route_stops, sizeof(StopId));
+		check(header_->stop_bus_offsets, sizeof(uint32_t));
+		check(header_->stop_bus_ids, sizeof(BusId));
+		check(header_->distance_offsets, sizeof(uint32_t));
+		check(header_->distances, sizeof(DistanceTable::Entry));
+
+		if (header_->stop_bus_offsets.count != header_->stops.count + 1
+			|| header_->distance_offsets.count != header_->stops.count + 1) {
+			throw ImageError("catalogue image indexes do not match the stops"s);
+		}
+	}
+
+	void MappedCatalogue::Validate() const {
+
+		const auto check_record = [](bool valid) {
+			if (!valid) {
+				throw ImageError("catalogue image record is out of bounds"s);
+			}
+		};
+		const auto within = [](uint64_t offset, uint64_t count, uint64_t section_count) {
+			return offset <= section_count && count <= section_count - offset;
+		};
+		const auto check_ids = [&check_record](const uint32_t* first, uint64_t count, uint64_t id_count) {
+			check_record(all_of(first, first + count, [id_count](uint32_t id) { return id < id_count; }));
+		};
+		const auto check_offsets = [&check_record](const uint32_t* offsets, uint64_t count, uint64_t element_count) {
+			check_record(is_sorted(offsets, offsets + count) && offsets[count - 1] <= element_count);
+		};
+
+		const uint64_t stop_count = header_->stops.count;
+		const uint64_t bus_count = header_->buses.count;
+		const StopRecord* stops = SectionData<StopRecord>(header_->stops);
+		for (uint64_t i = 0; i < stop_count; ++i) {
+			check_record(within(stops[i].name_offset, stops[i].name_length, header_->strings.count));
+		}
+		const BusRecord* buses = SectionData<BusRecord>(header_->buses);
+		for (uint64_t i = 0; i < bus_count; ++i) {
+			check_record(within(buses[i].name_offset, buses[i].name_length, header_->strings.count)
+				&& within(buses[i].stops_offset, buses[i].stops_count, header_->route_stops.count));
+		}
+		check_ids(SectionData<StopId>(header_->stops_by_name), header_->stops_by_name.count, stop_count);
+		check_ids(SectionData<BusId>(header_->buses_by_name), header_->buses_by_name.count, bus_count);
+		check_ids(SectionData<StopId>(header_->route_stops), header_->route_stops.count, stop_count);
+		check_offsets(SectionData<uint32_t>(header_->stop_bus_offsets), header_->stop_bus_offsets.count, header_->stop_bus_ids.count);
+		check_ids(SectionData<BusId>(header_->stop_bus_ids), header_->stop_bus_ids.count, bus_count);
+		check_offsets(SectionData<uint32_t>(header_->distance_offsets), header_->distance_offsets.count, header_->distances.count);
+	}
+
+	size_t MappedCatalogue::GetStopCount() const {
+		return header_->stops.count;
+	}
+
+	size_t MappedCatalogue::GetRouteCount() const {
+		return header_->buses.count;
+	}
+
+	const StopRecord& MappedCatalogue::GetStopRecord(StopId id) const {
+		if (id >= header_->stops.count) {
+			throw out_of_range("no stop "s + to_string(id));
+		}
+		return SectionData<StopRecord>(header_->stops)[id];
+	}
+
+	const BusRecord& MappedCatalogue::GetBusRecord(BusId id) const {
+		if (id >= header_->buses.count) {
+			throw out_of_range("no bus "s + to_string(id));
+		}
+		return SectionData<BusRecord>(header_->buses)[id];
+	}
+
+	std::string_view MappedCatalogue::GetString(uint32_t offset, uint32_t length) const {
+		if (offset > header_->strings.count || length > header_->strings.count - offset) {
+			throw ImageError("catalogue image name is out of bounds"s);
+		}
+		return { SectionData<char>(header_->strings) + offset, length };
+	}
+
+	std::pair<uint32_t, uint32_t> MappedCatalogue::GetRow(const Section& offsets, uint64_t element_count, uint32_t row) const {
+		const uint32_t first = SectionData<uint32_t>(offsets)[row];
+		const uint32_t last = SectionData<uint32_t>(offsets)[row + 1];
+		if (first > last || last > element_count) {
+			throw ImageError("catalogue image offsets are out of bounds"s);
+		}
+		return { first, last };
+	}
+
+	std::optional<StopId> MappedCatalogue::FindStop(std::string_view stopname) const {
+		const StopId* first = SectionData<StopId>(header_->stops_by_name);
+		const StopId* last = first + header_->stops_by_name.count;
+		const auto name_of = [this](StopId id) {
+			if (id >= header_->stops.count) {
+				throw ImageError("catalogue image stop index is out of bounds"s);
+			}
+			return GetStopName(id);
+		};
+		const StopId* it = lower_bound(first, last, stopname, [&name_of](StopId id, string_view name) {
+			return name_of(id) < name;
+			});
+		if (it == last || name_of(*it) != stopname) {
+			return nullopt;
+		}
+		return *it;
+	}
+
+	std::optional<BusId> MappedCatalogue::FindRoute(std::string_view busname) const {
+		const BusId* first = SectionData<BusId>(header_->buses_by_name);
+		const BusId* last = first + header_->buses_by_name.count;
+		const auto name_of = [this](BusId id) {
+			if (id >= header_->buses.count) {
+				throw ImageError("catalogue image bus index is out of bounds"s);
+			}
+			return GetRouteName(id);
+		};
+		const BusId* it = lower_bound(first, last, busname, [&name_of](BusId id, string_view name) {
+			return name_of(id) < name;
+			});
+		if (it == last || name_of(*it) != busname) {
+			return nullopt;
+		}
+		return *it;
+	}
+
+	std::string_view MappedCatalogue::GetStopName(StopId id) const {
+		const StopRecord& stop = GetStopRecord(id);
+		return GetString(stop.name_offset, stop.name_length);
+	}
+
+	::geo::Coordinates MappedCatalogue::GetStopCoordinates(StopId id) const {
+		const StopRecord& stop = GetStopRecord(id);
+		return { stop.lat, stop.lng };
+	}
+
+	IdRange MappedCatalogue::GetStopBuses(StopId id) const {
+		GetStopRecord(id);
+		const auto [first, last] = GetRow(header_->stop_bus_offsets, header_->stop_bus_ids.count, id);
+		const BusId* bus_ids = SectionData<BusId>(header_->stop_bus_ids);
+		return { bus_ids + first, bus_ids + last };
+	}
+
+	std::string_view MappedCatalogue::GetRouteName(BusId id) const {
+		const BusRecord& bus = GetBusRecord(id);
+		return GetString(bus.name_offset, bus.name_length);
+	}
+
+	bool MappedCatalogue::IsRing(BusId id) const {
+		return GetBusRecord(id).is_ring != 0;
+	}
+
+	IdRange MappedCatalogue::GetRouteStops(BusId id) const {
+		const BusRecord& bus = GetBusRecord(id);
+		if (bus.stops_offset > header_->route_stops.count || bus.stops_count > header_->route_stops.count - bus.stops_offset) {
+			throw ImageError("catalogue image route is out of bounds"s);
+		}
+		const StopId* route_stops = SectionData<StopId>(header_->route_stops) + bus.stops_offset;
+		return { route_stops, route_stops + bus.stops_count };
+	}
+
+	RouteInfo MappedCatalogue::GetRouteInfo(BusId id) const {
+		const BusRecord& bus = GetBusRecord(id);
+		return { GetRouteName(id), bus.stops_count, bus.unique_stops_count, bus.length, bus.geo_length, bus.curvature };
+	}
+
+	unsigned int MappedCatalogue::GetDistance(StopId from, StopId to) const {
+		if (from >= header_->stops.count) {
+			return 0;
+		}
+		const auto [row_first, row_last] = GetRow(header_->distance_offsets, header_->distances.count, from);
+		const DistanceTable::Entry* first = SectionData<DistanceTable::Entry>(header_->distances) + row_first;
+		const DistanceTable::Entry* last = SectionData<DistanceTable::Entry>(header_->distances) + row_last;
+		const auto it = lower_bound(first, last, to, [](const DistanceTable::Entry& entry, StopId id) {
+			return entry.to < id;
+			});
+		return it != last && it->to == to ? it->distance : 0;
+	}
+
+	namespace tests {
+		void TestImageRoundTrip()
+		{
+			TransportCatalogue catalogue;
+			catalogue.AddStop("A", { 55.611087, 37.20829 });
+			catalogue.AddStop("B", { 55.595884, 37.209755 });
+			catalogue.AddStop("C", { 55.632761, 37.333324 });
+			catalogue.AddStop("lonely", { 55.0, 37.0 });
+			catalogue.AddStop("A", { 55.0, 37.0 }); // redefinition hides the first "A"
+			catalogue.AddRoute("750", { "A", "B", "C" }, false);
+			catalogue.AddRoute("256", { "B", "C", "B" }, true);
+			catalogue.AddRoute("empty", {}, true);
+			catalogue.SetDistance("A", "B", 1000);
+			catalogue.SetDistance("B", "C", 2000);
+			catalogue.SetDistance("C", "B", 2500);
+
+			const std::filesystem::path path = std::filesystem::temp_directory_path() / "transport_image_test.bin";
+			{
+				std::ofstream file(path, std::ios::binary);
+				SaveImage(catalogue, file);
+			}
+
+			{
+				const MappedCatalogue mapped(path.string());
+				assert(mapped.GetStopCount() == catalogue.GetStopCount());
+				assert(mapped.GetRouteCount() == catalogue.GetRouteCount());
+				assert(*mapped.FindStop("A") == 4);
+				assert(!mapped.FindStop("D"));
+				assert(*mapped.FindRoute("256") == 1);
+				assert(!mapped.FindRoute("B"));
+				assert(mapped.GetStopName(3) == "lonely");
+				assert(mapped.GetStopCoordinates(2) == catalogue.GetStop(2)->coords);
+
+				for (BusId id = 0; id < catalogue.GetRouteCount(); ++id) {
+					const RouteInfo expected = catalogue.GetRouteInfo(id);
+					const RouteInfo actual = mapped.GetRouteInfo(id);
+					assert(actual.name == expected.name && actual.stops_amount == expected.stops_amount);
+					assert(actual.unique_stops_amount == expected.unique_stops_amount && actual.length == expected.length);
+					assert(actual.curvature == expected.curvature || (std::isnan(actual.curvature) && std::isnan(expected.curvature)));
+					const auto& stops = catalogue.GetRouteStops(id);
+					const IdRange mapped_stops = mapped.GetRouteStops(id);
+					assert(std::equal(stops.begin(), stops.end(), mapped_stops.begin(), mapped_stops.end()));
+					assert(mapped.IsRing(id) == catalogue.GetRoute(id)->isRing);
+				}
+
+				for (StopId from = 0; from < catalogue.GetStopCount(); ++from) {
+					const auto buses = catalogue.GetStopInfo(from).buses;
+					const IdRange mapped_buses = mapped.GetStopBuses(from);
+					assert(buses ? std::equal(buses->ids_begin(), buses->ids_end(), mapped_buses.begin(), mapped_buses.end()) : mapped_buses.empty());
+					for (StopId to = 0; to < catalogue.GetStopCount(); ++to) {
+						assert(mapped.GetDistance(from, to) == catalogue.GetDistance(from, to));
+					}
+				}
+			}
+
+			// damaged images: a bad header or section is rejected on opening, a bad record by Validate
+			// and by the getter that reads it
+			std::string image;
+			{
+				std::ifstream file(path, std::ios::binary);
+				image.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+			Header header;
+			std::memcpy(&header, image.data(), sizeof(header));
+			const auto damage = [&path, &image](size_t size, size_t position, uint32_t value) {
+				std::string damaged = image.substr(0, size);
+				if (position + sizeof(value) <= damaged.size()) {
+					std::memcpy(damaged.data() + position, &value, sizeof(value));
+				}
+				std::ofstream file(path, std::ios::binary | std::ios::trunc);
+				file.write(damaged.data(), damaged.size());
+			};
+			const auto opens = [&path] {
+				try {
+					MappedCatalogue mapped(path.string());
+				}
+				catch (const ImageError&) {
+					return false;
+				}
+				return true;
+			};
+			// opens, then fails the deep check and the query
+			const auto rejected_by = [&path](auto query) {
+				const MappedCatalogue mapped(path.string());
+				bool validated = true;
+				try {
+					mapped.Validate();
+				}
+				catch (const ImageError&) {
+					validated = false;
+				}
+				try {
+					query(mapped);
+				}
+				catch (const ImageError&) {
+					return !validated;
+				}
+				return false;
+			};
+			const auto validate_only = [](const MappedCatalogue&) { throw ImageError("only Validate sees it"); };
+
+			const size_t no_change = image.size();
+			damage(image.size(), no_change, 0);
+			assert(opens());
+			MappedCatalogue(path.string()).Validate();
+			for (const auto& [size, position, value] : {
+				std::tuple{ image.size(), size_t{ 0 }, uint32_t{ 0 } }, // magic
+				std::tuple{ image.size(), offsetof(Header, format_version), FORMAT_VERSION + 1 },
+				std::tuple{ image.size() - 8, no_change, uint32_t{ 0 } },
+				std::tuple{ sizeof(Header) - 1, no_change, uint32_t{ 0 } },
+				std::tuple{ image.size(), offsetof(Header, stops) + offsetof(Section, count), uint32_t{ 1000 } } }) {
+				damage(size, position, value);
+				assert(!opens());
+			}
+
+			damage(image.size(), header.stops.offset + sizeof(StopRecord) + offsetof(StopRecord, name_length), 1000);
+			assert(rejected_by([](const MappedCatalogue& mapped) { mapped.GetStopName(1); }));
+			damage(image.size(), header.buses.offset + offsetof(BusRecord, stops_offset), 1000);
+			assert(rejected_by([](const MappedCatalogue& mapped) { mapped.GetRouteStops(0); }));
+			damage(image.size(), header.buses_by_name.offset, 3);
+			assert(rejected_by([](const MappedCatalogue& mapped) { mapped.FindRoute("256"); }));
+			damage(image.size(), header.route_stops.offset + sizeof(StopId), 5);
+			assert(rejected_by(validate_only));
+			damage(image.size(), header.stop_bus_offsets.offset + sizeof(uint32_t), 1000);
+			assert(rejected_by([](const MappedCatalogue& mapped) { mapped.GetStopBuses(0); }));
+			damage(image.size(), header.stop_bus_ids.offset, 3);
+			assert(rejected_by(validate_only));
+			damage(image.size(), header.distance_offsets.offset + 5 * sizeof(uint32_t), 1000);
+			assert(rejected_by([](const MappedCatalogue& mapped) { mapped.GetDistance(4, 1); }));
+
+			// ids past the end are the caller's error
+			damage(image.size(), no_change, 0);
+			{
+				const MappedCatalogue mapped(path.string());
+				for (const auto& query : std::initializer_list<void (*)(const MappedCatalogue&)>{
+					[](const MappedCatalogue& mapped) { mapped.GetStopName(5); },
+					[](const MappedCatalogue& mapped) { mapped.GetStopCoordinates(5); },
+					[](const MappedCatalogue& mapped) { mapped.GetStopBuses(5); },
+					[](const MappedCatalogue& mapped) { mapped.GetRouteName(3); },
+					[](const MappedCatalogue& mapped) { mapped.IsRing(3); },
+					[](const MappedCatalogue& mapped) { mapped.GetRouteStops(3); },
+					[](const MappedCatalogue& mapped) { mapped.GetRouteInfo(3); } }) {
+					bool thrown = false;
+					try {
+						query(mapped);
+					}
+					catch (const std::out_of_range&) {
+						thrown = true;
+					}
+					assert(thrown);
+				}
+				assert(mapped.GetDistance(5, 0) == 0);
+			}
+
+			std::filesystem::remove(path);
+		}
+	}
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace transport::image {
+
+	// Binary catalogue image. Every section is a plain array addressed by an offset
+	// from the file start, so the image is relocatable and can be queried right
+	// from a read-only memory mapping. Numbers are stored in the host byte order;
+	// a mismatch is detected on load.
+
+	inline constexpr char MAGIC[8] = { 'T', 'C', 'A', 'T', 'I', 'M', 'G', '\0' };
+	inline constexpr uint32_t FORMAT_VERSION = 1;
+	inline constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	struct Section {
+		uint64_t offset; // bytes from the file start, 8-aligned
+		uint64_t count;  // elements
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t format_version;
+		uint32_t byte_order;
+		uint64_t file_size;
+
+		Section strings;          // char; all names, back to back
+		Section stops;            // StopRecord, index: StopId
+		Section stops_by_name;    // StopId, sorted by name
+		Section buses;            // BusRecord, index: BusId
+		Section buses_by_name;    // BusId, sorted by name
+		Section route_stops;      // StopId; full stop sequences of all routes
+		Section stop_bus_offsets; // uint32_t, stop count + 1
+		Section stop_bus_ids;     // BusId; buses of every stop sorted by name
+		Section distance_offsets; // uint32_t, stop count + 1
+		Section distances;        // DistanceTable::Entry; rows sorted by destination
+	};
+
+	struct StopRecord {
+		double lat;
+		double lng;
+		uint32_t name_offset;
+		uint32_t name_length;
+	};
+
+	struct BusRecord {
+		uint32_t name_offset;
+		uint32_t name_length;
+		uint32_t stops_offset; // in route_stops
+		uint32_t stops_count;
+		uint32_t unique_stops_count;
+		uint32_t is_ring;
+		double length;
+		double geo_length;
+		double curvature;
+	};
+
+	class ImageError : public std::runtime_error {
+	public:
+		using runtime_error::runtime_error;
+	};
+
+	// Writes the catalogue image; the catalogue indexes are built on the way if needed
+	void SaveImage(const TransportCatalogue& catalogue, std::ostream& output);
+
+	struct IdRange {
+		const uint32_t* first;
+		const uint32_t* last;
+
+		const uint32_t* begin() const { return first; }
+		const uint32_t* end() const { return last; }
+		size_t size() const { return last - first; }
+		bool empty() const { return first == last; }
+	};
+
+	// Read-only catalogue served straight from a memory-mapped image file.
+	// Opening validates the header and the section bounds only, so it does not depend on the
+	// catalogue size. Getters check the id (std::out_of_range) and the record they read
+	// (ImageError), so a damaged image is never read past the mapping.
+	class MappedCatalogue {
+	public:
+		explicit MappedCatalogue(const std::string& path);
+		MappedCatalogue(MappedCatalogue&& other) noexcept;
+		MappedCatalogue& operator=(MappedCatalogue&& other) noexcept;
+		MappedCatalogue(const MappedCatalogue&) = delete;
+		MappedCatalogue& operator=(const MappedCatalogue&) = delete;
+		~MappedCatalogue();
+
+		size_t GetStopCount() const;
+		size_t GetRouteCount() const;
+
+		std::optional<StopId> FindStop(std::string_view stopname) const;
+		std::optional<BusId> FindRoute(std::string_view busname) const;
+
+		std::string_view GetStopName(StopId id) const;
+		::geo::Coordinates GetStopCoordinates(StopId id) const;
+		IdRange GetStopBuses(StopId id) const; // sorted by name
+
+		std::string_view GetRouteName(BusId id) const;
+		bool IsRing(BusId id) const;
+		IdRange GetRouteStops(BusId id) const; // full (unfolded) stop sequence
+		RouteInfo GetRouteInfo(BusId id) const;
+
+		unsigned int GetDistance(StopId from, StopId to) const;
+
+		// Every record, index and offset against the section bounds, in one pass over the image;
+		// throws ImageError. Also finds damage the getters can not see, such as a bad stop id in a route.
+		void Validate() const;
+
+	private:
+		template <typename T>
+		const T* SectionData(const Section& section) const {
+			return reinterpret_cast<const T*>(data_ + section.offset);
+		}
+
+		void ValidateHeader() const;
+		void Unmap();
+
+		const StopRecord& GetStopRecord(StopId id) const;
+		const BusRecord& GetBusRecord(BusId id) const;
+		std::string_view GetString(uint32_t offset, uint32_t length) const;
+		// [first, last) of a CSR row of "element_count" elements
+		std::pair<uint32_t, uint32_t> GetRow(const Section& offsets, uint64_t element_count, uint32_t row) const;
+
+	private:
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+		const Header* header_ = nullptr;
+#ifdef _WIN32
+		void* file_ = nullptr;
+		void* mapping_ = nullptr;
+#endif
+	};
+
+	namespace tests {
+		void TestImageRoundTrip();
+	}
+
+}
@@ -0,0 +1,157 @@
+#include "catalogue_snapshot.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+
+namespace transport {
+
+	using namespace std;
+
+	CatalogueBatch& CatalogueBatch::AddStop(std::string name, ::geo::Coordinates coords) {
+		ops_.push_back(StopOp{ move(name), coords });
+		return *this;
+	}
+
+	CatalogueBatch& CatalogueBatch::AddRoute(std::string name, std::vector<std::string> stopnames, bool isRing) {
+		ops_.push_back(RouteOp{ move(name), move(stopnames), isRing });
+		return *this;
+	}
+
+	CatalogueBatch& CatalogueBatch::SetDistance(std::string stopname_from, std::string stopname_to, unsigned int distance) {
+		ops_.push_back(DistanceOp{ move(stopname_from), move(stopname_to), distance });
+		return *this;
+	}
+
+	bool CatalogueBatch::Empty() const {
+		return ops_.empty();
+	}
+
+	void CatalogueBatch::ApplyTo(TransportCatalogue& catalogue) const {
+
+		struct Applier {
+			TransportCatalogue& catalogue;
+
+			void operator()(const StopOp& op) const {
+				catalogue.AddStop(op.name, op.coords);
+			}
+			void operator()(const RouteOp& op) const {
+				catalogue.AddRoute(op.name, op.stopnames, op.isRing);
+			}
+			void operator()(const DistanceOp& op) const {
+				catalogue.SetDistance(op.from, op.to, op.distance);
+			}
+		};
+
+		for (const auto& op : ops_) {
+			visit(Applier{ catalogue }, op);
+		}
+	}
+
+	CataloguePublisher::CataloguePublisher()
+		: CataloguePublisher(TransportCatalogue{}) {
+	}
+
+	CataloguePublisher::CataloguePublisher(TransportCatalogue initial) {
+		initial.Finalize();
+		Store(make_shared<const TransportCatalogue>(move(initial)));
+	}
+
+	CatalogueSnapshot CataloguePublisher::GetSnapshot() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+		return current_.load(memory_order_acquire);
+#else
+		return atomic_load_explicit(&current_, memory_order_acquire);
+#endif
+	}
+
+	void CataloguePublisher::Store(CatalogueSnapshot snapshot) {
+#ifdef __cpp_lib_atomic_shared_ptr
+		current_.store(move(snapshot), memory_order_release);
+#else
+		atomic_store_explicit(&current_, move(snapshot), memory_order_release);
+#endif
+	}
+
+	CatalogueSnapshot CataloguePublisher::Publish(const CatalogueBatch& batch) {
+
+		lock_guard guard(writer_mutex_);
+
+		auto next = make_shared<TransportCatalogue>(*GetSnapshot());
+		batch.ApplyTo(*next);
+		next->Finalize();
+
+		CatalogueSnapshot result = move(next);
+		Store(result);
+		return result;
+	}
+
+	namespace tests {
+		void TestCataloguePublisher()
+		{
+			CataloguePublisher publisher(TransportCatalogue{ AllocationMode::ARENA });
+			const CatalogueSnapshot empty = publisher.GetSnapshot();
+			assert(empty->GetStopCount() == 0);
+
+			CatalogueBatch batch;
+			batch.AddStop("A", { 55.611087, 37.20829 })
+				.AddStop("B", { 55.595884, 37.209755 })
+				.AddRoute("1", { "A", "B" }, false)
+				.SetDistance("A", "B", 1000);
+			const CatalogueSnapshot first = publisher.Publish(batch);
+
+			assert(publisher.GetSnapshot() == first);
+			assert(empty->GetStopCount() == 0); // old versions are untouched
+			assert(first->GetVersion() > empty->GetVersion());
+			assert(first->GetRouteInfo("1").length == 2000);
+			assert(first->GetRoute("1")->stops[1] == first->GetStop("B"));
+
+			// a batch that fails half-way publishes nothing
+			CatalogueBatch broken;
+			broken.AddStop("C", { 55.6, 37.2 })
+				.AddRoute("2", { "A", "unknown" }, false);
+			bool thrown = false;
+			try {
+				publisher.Publish(broken);
+			}
+			catch (const std::invalid_argument&) {
+				thrown = true;
+			}
+			assert(thrown && publisher.GetSnapshot() == first);
+			assert(!first->GetStop("C") && !first->GetRoute("2"));
+
+			// readers run while the writer keeps publishing; every version they see is complete
+			std::atomic<bool> done = false;
+			std::vector<std::thread> readers;
+			for (int i = 0; i < 4; ++i) {
+				readers.emplace_back([&publisher, &done] {
+					while (!done) {
+						const CatalogueSnapshot snapshot = publisher.GetSnapshot();
+						for (BusId id = 0; id < snapshot->GetRouteCount(); ++id) {
+							const RouteInfo info = snapshot->GetRouteInfo(id);
+							assert(info.stops_amount == 3 && info.length == 2000);
+							assert(snapshot->GetStopInfo(snapshot->GetRoute(id)->stops[1]->id).buses.has_value());
+						}
+					}
+					});
+			}
+
+			for (int i = 0; i < 50; ++i) {
+				const std::string suffix = std::to_string(i);
+				CatalogueBatch next;
+				next.AddStop("C" + suffix, { 55.6, 37.2 })
+					.AddRoute("bus" + suffix, { "A", "C" + suffix }, false)
+					.SetDistance("A", "C" + suffix, 1000);
+				publisher.Publish(next);
+			}
+			done = true;
+			for (auto& reader : readers) {
+				reader.join();
+			}
+
+			assert(publisher.GetSnapshot()->GetRouteCount() == 51);
+			assert(first->GetRouteCount() == 1);
+		}
+	}
+
+}
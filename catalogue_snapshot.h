@@ -0,0 +1,81 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace transport {
+
+	// Immutable, finalized version of the catalogue; stays valid while somebody holds it
+	using CatalogueSnapshot = std::shared_ptr<const TransportCatalogue>;
+
+	// Modifications to be published together, applied in the order they were added
+	class CatalogueBatch {
+	public:
+		CatalogueBatch& AddStop(std::string name, ::geo::Coordinates coords);
+		CatalogueBatch& AddRoute(std::string name, std::vector<std::string> stopnames, bool isRing);
+		CatalogueBatch& SetDistance(std::string stopname_from, std::string stopname_to, unsigned int distance);
+
+		void ApplyTo(TransportCatalogue& catalogue) const;
+
+		bool Empty() const;
+
+	private:
+		struct StopOp {
+			std::string name;
+			::geo::Coordinates coords;
+		};
+
+		struct RouteOp {
+			std::string name;
+			std::vector<std::string> stopnames;
+			bool isRing;
+		};
+
+		struct DistanceOp {
+			std::string from;
+			std::string to;
+			unsigned int distance;
+		};
+
+		std::vector<std::variant<StopOp, RouteOp, DistanceOp>> ops_;
+	};
+
+	// RCU-style holder of the current catalogue version.
+	// Readers take GetSnapshot() without locking and keep using it as long as they need;
+	// a writer copies the current version, applies a whole batch to the copy and
+	// publishes it at once, so readers never see a half-applied batch.
+	class CataloguePublisher {
+	public:
+		CataloguePublisher();
+		explicit CataloguePublisher(TransportCatalogue initial);
+
+		CatalogueSnapshot GetSnapshot() const;
+
+		// returns the published version; concurrent writers are serialized. If the batch throws
+		// (std::invalid_argument for an unknown stop), nothing is published and the current version stays.
+		CatalogueSnapshot Publish(const CatalogueBatch& batch);
+
+	private:
+		void Store(CatalogueSnapshot snapshot);
+
+	private:
+		std::mutex writer_mutex_; // writers only
+#ifdef __cpp_lib_atomic_shared_ptr
+		std::atomic<CatalogueSnapshot> current_;
+#else
+		CatalogueSnapshot current_; // accessed through std::atomic_load / std::atomic_store only
+#endif
+	};
+
+	namespace tests {
+		void TestCataloguePublisher();
+	}
+
+}
@@ -0,0 +1,680 @@
+#include "contraction_hierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <sstream>
+
+namespace transport::graph {
+
+	using namespace std;
+
+	namespace {
+		constexpr char MAGIC[8] = { 'T', 'C', 'H', 'I', 'E', 'R', '\0', '\0' };
+		constexpr uint32_t FORMAT_VERSION = 1;
+		constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+		// witness searches give up past these many settled vertices or arcs on a path;
+		// a missed witness costs a needless shortcut, not correctness
+		struct WitnessLimits {
+			size_t settled;
+			uint32_t hops;
+		};
+		constexpr WitnessLimits CONTRACTION_LIMITS = { 500, 8 };
+		// when only counting shortcuts for the contraction order: single arcs are the only witnesses
+		constexpr WitnessLimits SIMULATION_LIMITS = { 1, 1 };
+
+		constexpr double INF = numeric_limits<double>::infinity();
+
+		struct FileHeader {
+			char magic[8];
+			uint32_t format_version;
+			uint32_t byte_order;
+			uint64_t vertex_count;
+			uint64_t fingerprint;
+		};
+
+		template <typename T>
+		void WriteVector(ostream& output, const vector<T>& data) {
+			const uint64_t size = data.size();
+			output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+			output.write(reinterpret_cast<const char*>(data.data()), static_cast<streamsize>(data.size() * sizeof(T)));
+		}
+
+		template <typename T>
+		vector<T> ReadVector(istream& input, uint64_t max_size) {
+			uint64_t size = 0;
+			input.read(reinterpret_cast<char*>(&size), sizeof(size));
+			if (!input || size > max_size) {
+				throw HierarchyError("truncated or corrupt hierarchy");
+			}
+			vector<T> data(size);
+			input.read(reinterpret_cast<char*>(data.data()), static_cast<streamsize>(size * sizeof(T)));
+			if (!input) {
+				throw HierarchyError("truncated hierarchy");
+			}
+			return data;
+		}
+	}
+
+	// Dynamic graph of the not yet contracted vertices plus the witness search over it
+	class ContractionHierarchy::Builder {
+	public:
+		Builder(const DirectedWeightedGraph& graph, vector<Arc>& arcs)
+			: arcs_(arcs)
+			, out_(graph.GetVertexCount())
+			, in_(graph.GetVertexCount())
+			, contracted_(graph.GetVertexCount(), false)
+			, level_(graph.GetVertexCount(), 0)
+			, weight_(graph.GetVertexCount(), INF)
+			, hops_(graph.GetVertexCount(), 0)
+			, arc_to_(graph.GetVertexCount(), NO_ARC)
+		{
+			for (EdgeId id = 0; id < graph.GetEdgeCount(); ++id) {
+				const Edge& edge = graph.GetEdge(id);
+				if (edge.from != edge.to) {
+					AddArc({ edge.from, edge.to, edge.weight, ORIGINAL, id });
+				}
+			}
+			for (auto& row : out_) {
+				SortByWeight(row);
+			}
+		}
+
+		// contraction rank of every vertex
+		vector<uint32_t> Contract() {
+
+			const size_t vertex_count = out_.size();
+			// priorities change only for the neighbours of a contracted vertex: they are marked stale
+			// and recomputed when they reach the top, outdated entries are skipped
+			using Item = pair<double, VertexId>;
+			priority_queue<Item, vector<Item>, greater<Item>> order;
+			vector<double> priority(vertex_count);
+			vector<bool> stale(vertex_count, false);
+			for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+				priority[vertex] = Priority(vertex);
+				order.push({ priority[vertex], vertex });
+			}
+
+			vector<uint32_t> rank(vertex_count);
+			uint32_t next_rank = 0;
+			while (!order.empty()) {
+				const auto [vertex_priority, vertex] = order.top();
+				order.pop();
+				if (contracted_[vertex] || vertex_priority != priority[vertex]) {
+					continue;
+				}
+				if (stale[vertex]) {
+					stale[vertex] = false;
+					priority[vertex] = Priority(vertex);
+					if (!order.empty() && priority[vertex] > order.top().first) {
+						order.push({ priority[vertex], vertex });
+						continue;
+					}
+				}
+
+				Process(vertex, true);
+				for (uint32_t id : in_[vertex]) {
+					stale[arcs_[id].from] = true;
+				}
+				for (uint32_t id : out_[vertex]) {
+					stale[arcs_[id].to] = true;
+				}
+				Remove(vertex);
+				rank[vertex] = next_rank++;
+			}
+			return rank;
+		}
+
+	private:
+		struct QueueItem {
+			double weight;
+			VertexId vertex;
+
+			bool operator>(const QueueItem& other) const {
+				return weight > other.weight;
+			}
+		};
+
+		static constexpr uint32_t NO_ARC = ~uint32_t{ 0 };
+
+		// out_ rows are kept lightest first, so witness searches stop scanning a row at the limit
+		void SortByWeight(vector<uint32_t>& row) {
+			sort(row.begin(), row.end(), [this](uint32_t lhs, uint32_t rhs) { return arcs_[lhs].weight < arcs_[rhs].weight; });
+		}
+
+		// for the graph edges; parallel ones are merged, the lighter one wins
+		void AddArc(const Arc& arc) {
+			for (uint32_t id : out_[arc.from]) {
+				if (arcs_[id].to == arc.to) {
+					if (arc.weight < arcs_[id].weight) {
+						arcs_[id] = arc;
+					}
+					return;
+				}
+			}
+			const auto id = static_cast<uint32_t>(arcs_.size());
+			arcs_.push_back(arc);
+			arc_hops_.push_back(1);
+			out_[arc.from].push_back(id);
+			in_[arc.to].push_back(id);
+		}
+
+		struct Shortcuts {
+			double count = 0;
+			double hops = 0; // original edges they replace
+		};
+
+		// arcs and original edges the contraction adds per each it removes, plus the level,
+		// which keeps the contraction spread evenly over the graph
+		double Priority(VertexId vertex) {
+			const Shortcuts added = Process(vertex, false);
+			double removed_hops = 0;
+			for (const auto* row : { &in_[vertex], &out_[vertex] }) {
+				for (uint32_t id : *row) {
+					removed_hops += arc_hops_[id];
+				}
+			}
+			const double removed = static_cast<double>(in_[vertex].size() + out_[vertex].size());
+			return level_[vertex] + (removed > 0 ? (added.count / removed + added.hops / removed_hops) : 0);
+		}
+
+		// shortcuts needed to contract the vertex; adds them if "apply"
+		Shortcuts Process(VertexId vertex, bool apply) {
+
+			Shortcuts shortcuts;
+			// shortcuts grow in_/out_ of the neighbours, never of "vertex" itself
+			for (size_t i = 0; i < in_[vertex].size(); ++i) {
+
+				const uint32_t in_id = in_[vertex][i];
+				const VertexId from = arcs_[in_id].from;
+				const double in_weight = arcs_[in_id].weight;
+				WitnessSearch(from, vertex, in_weight, apply ? CONTRACTION_LIMITS : SIMULATION_LIMITS);
+
+				if (apply) {
+					for (uint32_t id : out_[from]) {
+						arc_to_[arcs_[id].to] = id;
+					}
+				}
+				for (size_t j = 0; j < out_[vertex].size(); ++j) {
+					const uint32_t out_id = out_[vertex][j];
+					const VertexId to = arcs_[out_id].to;
+					const double weight = in_weight + arcs_[out_id].weight;
+					if (to == from || weight_[to] <= weight) {
+						continue;
+					}
+					const uint32_t hops = arc_hops_[in_id] + arc_hops_[out_id];
+					++shortcuts.count;
+					shortcuts.hops += hops;
+					if (!apply) {
+						continue;
+					}
+					// an existing arc is always a witness unless it is heavier; it is replaced then
+					if (const uint32_t existing = arc_to_[to]; existing != NO_ARC) {
+						arcs_[existing] = { from, to, weight, in_id, out_id };
+						arc_hops_[existing] = hops;
+					}
+					else {
+						arc_to_[to] = static_cast<uint32_t>(arcs_.size());
+						arcs_.push_back({ from, to, weight, in_id, out_id });
+						arc_hops_.push_back(hops);
+						out_[from].push_back(arc_to_[to]);
+						in_[to].push_back(arc_to_[to]);
+					}
+				}
+				if (apply) {
+					for (uint32_t id : out_[from]) {
+						arc_to_[arcs_[id].to] = NO_ARC;
+					}
+					SortByWeight(out_[from]);
+				}
+			}
+			return shortcuts;
+		}
+
+		// Dijkstra from "source" avoiding "skip", until every vertex "skip" leads to is reached no heavier
+		// than through "skip" or the rest of them can not be
+		void WitnessSearch(VertexId source, VertexId skip, double in_weight, WitnessLimits limits) {
+
+			for (VertexId vertex : touched_) {
+				weight_[vertex] = INF;
+			}
+			touched_.clear();
+			queue_.clear();
+
+			// out_[skip] is sorted by weight: "pending" arcs from its end on still lack a witness
+			const auto& targets = out_[skip];
+			size_t pending = targets.size();
+			const auto resolved = [&](uint32_t id) {
+				return arcs_[id].to == source || weight_[arcs_[id].to] <= in_weight + arcs_[id].weight;
+			};
+
+			weight_[source] = 0;
+			hops_[source] = 0;
+			touched_.push_back(source);
+			queue_.push_back({ 0, source });
+
+			size_t settled = 0;
+			while (!queue_.empty() && settled < limits.settled) {
+				pop_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+				const auto [weight, vertex] = queue_.back();
+				queue_.pop_back();
+				if (weight > weight_[vertex]) {
+					continue;
+				}
+				while (pending > 0 && resolved(targets[pending - 1])) {
+					--pending;
+				}
+				if (pending == 0) {
+					break;
+				}
+				const double limit = in_weight + arcs_[targets[pending - 1]].weight;
+				if (weight > limit) {
+					break;
+				}
+				++settled;
+				if (hops_[vertex] == limits.hops) {
+					continue;
+				}
+
+				for (uint32_t id : out_[vertex]) {
+					const Arc& arc = arcs_[id];
+					const double candidate = weight + arc.weight;
+					if (candidate > limit) {
+						break; // the rest of the row is heavier still
+					}
+					if (arc.to != skip && candidate < weight_[arc.to]) {
+						if (weight_[arc.to] == INF) {
+							touched_.push_back(arc.to);
+						}
+						weight_[arc.to] = candidate;
+						hops_[arc.to] = hops_[vertex] + 1;
+						// a vertex at the hop limit is never expanded, its weight is all that counts
+						if (hops_[arc.to] < limits.hops) {
+							queue_.push_back({ candidate, arc.to });
+							push_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+						}
+					}
+				}
+			}
+		}
+
+		// drops the vertex from the dynamic graph; its arcs stay in arcs_
+		void Remove(VertexId vertex) {
+			contracted_[vertex] = true;
+			for (uint32_t id : in_[vertex]) {
+				const VertexId from = arcs_[id].from;
+				auto& row = out_[from];
+				row.erase(remove_if(row.begin(), row.end(), [this, vertex](uint32_t arc) { return arcs_[arc].to == vertex; }), row.end());
+				level_[from] = max(level_[from], level_[vertex] + 1);
+			}
+			for (uint32_t id : out_[vertex]) {
+				const VertexId to = arcs_[id].to;
+				auto& row = in_[to];
+				row.erase(remove_if(row.begin(), row.end(), [this, vertex](uint32_t arc) { return arcs_[arc].from == vertex; }), row.end());
+				level_[to] = max(level_[to], level_[vertex] + 1);
+			}
+		}
+
+	private:
+		vector<Arc>& arcs_;
+		vector<vector<uint32_t>> out_; // arc ids between not contracted vertices
+		vector<vector<uint32_t>> in_;
+		vector<bool> contracted_;
+		vector<uint32_t> arc_hops_; // index: arc id; original edges it stands for
+		vector<int> level_; // 1 + the highest level of a contracted neighbour
+
+		vector<double> weight_;
+		vector<uint32_t> hops_; // arcs on the path to the vertex found by the witness search
+		vector<uint32_t> arc_to_; // index: VertexId; arc from the vertex being connected, NO_ARC if none
+		vector<VertexId> touched_;
+		vector<QueueItem> queue_;
+	};
+
+	ContractionHierarchy::ContractionHierarchy(const DirectedWeightedGraph& graph)
+		: vertex_count_(graph.GetVertexCount())
+		, fingerprint_(Fingerprint(graph))
+	{
+		const vector<uint32_t> rank = Builder(graph, arcs_).Contract();
+
+		// every arc goes up from one of its ends: forward from "from", backward from "to"
+		forward_offsets_.assign(vertex_count_ + 1, 0);
+		backward_offsets_.assign(vertex_count_ + 1, 0);
+		for (const Arc& arc : arcs_) {
+			if (rank[arc.from] < rank[arc.to]) {
+				++forward_offsets_[arc.from + 1];
+			}
+			else {
+				++backward_offsets_[arc.to + 1];
+			}
+		}
+		for (size_t vertex = 0; vertex < vertex_count_; ++vertex) {
+			forward_offsets_[vertex + 1] += forward_offsets_[vertex];
+			backward_offsets_[vertex + 1] += backward_offsets_[vertex];
+		}
+
+		vector<uint32_t> forward_pos(forward_offsets_.begin(), forward_offsets_.end() - 1);
+		vector<uint32_t> backward_pos(backward_offsets_.begin(), backward_offsets_.end() - 1);
+		forward_.resize(forward_offsets_.back());
+		backward_.resize(backward_offsets_.back());
+		for (uint32_t id = 0; id < arcs_.size(); ++id) {
+			const Arc& arc = arcs_[id];
+			if (rank[arc.from] < rank[arc.to]) {
+				forward_[forward_pos[arc.from]++] = { arc.to, id, arc.weight };
+			}
+			else {
+				backward_[backward_pos[arc.to]++] = { arc.from, id, arc.weight };
+			}
+		}
+	}
+
+	uint64_t ContractionHierarchy::Fingerprint(const DirectedWeightedGraph& graph) {
+		// FNV-1a over the edge list
+		uint64_t hash = 14695981039346656037ull;
+		const auto mix = [&hash](const void* data, size_t size) {
+			const auto* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; ++i) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+		};
+		const uint64_t vertex_count = graph.GetVertexCount();
+		mix(&vertex_count, sizeof(vertex_count));
+		for (EdgeId id = 0; id < graph.GetEdgeCount(); ++id) {
+			const Edge& edge = graph.GetEdge(id);
+			mix(&edge.from, sizeof(edge.from));
+			mix(&edge.to, sizeof(edge.to));
+			mix(&edge.weight, sizeof(edge.weight));
+		}
+		return hash;
+	}
+
+	void ContractionHierarchy::Save(std::ostream& output) const {
+		FileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.format_version = FORMAT_VERSION;
+		header.byte_order = BYTE_ORDER_MARK;
+		header.vertex_count = vertex_count_;
+		header.fingerprint = fingerprint_;
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		WriteVector(output, arcs_);
+		WriteVector(output, forward_offsets_);
+		WriteVector(output, forward_);
+		WriteVector(output, backward_offsets_);
+		WriteVector(output, backward_);
+	}
+
+	ContractionHierarchy ContractionHierarchy::Load(std::istream& input, const DirectedWeightedGraph& graph) {
+
+		FileHeader header;
+		input.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!input || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw HierarchyError("not a contraction hierarchy");
+		}
+		if (header.byte_order != BYTE_ORDER_MARK) {
+			throw HierarchyError("hierarchy was written with another byte order");
+		}
+		if (header.format_version != FORMAT_VERSION) {
+			throw HierarchyError("unsupported hierarchy format version");
+		}
+		if (header.vertex_count != graph.GetVertexCount() || header.fingerprint != Fingerprint(graph)) {
+			throw HierarchyError("hierarchy was built from another graph");
+		}
+
+		ContractionHierarchy result;
+		result.vertex_count_ = header.vertex_count;
+		result.fingerprint_ = header.fingerprint;
+		constexpr uint64_t max_arcs = numeric_limits<uint32_t>::max();
+		result.arcs_ = ReadVector<Arc>(input, max_arcs);
+		result.forward_offsets_ = ReadVector<uint32_t>(input, header.vertex_count + 1);
+		result.forward_ = ReadVector<UpArc>(input, max_arcs);
+		result.backward_offsets_ = ReadVector<uint32_t>(input, header.vertex_count + 1);
+		result.backward_ = ReadVector<UpArc>(input, max_arcs);
+
+		// enough to make the queries safe on a damaged file
+		const auto valid_rows = [&result](const vector<uint32_t>& offsets, const vector<UpArc>& rows) {
+			return offsets.size() == result.vertex_count_ + 1 && offsets.front() == 0 && offsets.back() == rows.size()
+				&& is_sorted(offsets.begin(), offsets.end())
+				&& all_of(rows.begin(), rows.end(), [&result](const UpArc& arc) {
+				return arc.to < result.vertex_count_ && arc.arc < result.arcs_.size();
+					});
+		};
+		const bool valid_arcs = all_of(result.arcs_.begin(), result.arcs_.end(), [&result, &graph](const Arc& arc) {
+			return arc.from < result.vertex_count_ && arc.to < result.vertex_count_
+				&& (arc.first == ORIGINAL ? arc.second < graph.GetEdgeCount() : arc.first < result.arcs_.size() && arc.second < result.arcs_.size());
+			});
+		if (!valid_arcs || !valid_rows(result.forward_offsets_, result.forward_) || !valid_rows(result.backward_offsets_, result.backward_)) {
+			throw HierarchyError("corrupt hierarchy");
+		}
+		return result;
+	}
+
+	size_t ContractionHierarchy::GetVertexCount() const {
+		return vertex_count_;
+	}
+
+	size_t ContractionHierarchy::GetShortcutCount() const {
+		return count_if(arcs_.begin(), arcs_.end(), [](const Arc& arc) { return arc.first != ORIGINAL; });
+	}
+
+	HierarchySearch::HierarchySearch(const ContractionHierarchy& hierarchy)
+		: hierarchy_(hierarchy)
+	{
+		for (Side* side : { &forward_, &backward_ }) {
+			side->weight.assign(hierarchy.vertex_count_, INF);
+			side->parent_arc.assign(hierarchy.vertex_count_, NO_ARC);
+		}
+	}
+
+	void HierarchySearch::Reset() {
+		for (VertexId vertex : touched_) {
+			for (Side* side : { &forward_, &backward_ }) {
+				side->weight[vertex] = INF;
+				side->parent_arc[vertex] = NO_ARC;
+			}
+		}
+		touched_.clear();
+		forward_.queue.clear();
+		backward_.queue.clear();
+	}
+
+	void HierarchySearch::Step(Side& side, const Side& other, const std::vector<uint32_t>& up_offsets, const std::vector<ContractionHierarchy::UpArc>& up,
+		const std::vector<uint32_t>& down_offsets, const std::vector<ContractionHierarchy::UpArc>& down) {
+
+		pop_heap(side.queue.begin(), side.queue.end(), greater<QueueItem>{});
+		const auto [weight, vertex] = side.queue.back();
+		side.queue.pop_back();
+		if (weight > side.weight[vertex]) {
+			return;
+		}
+
+		if (other.weight[vertex] != INF && weight + other.weight[vertex] < best_) {
+			best_ = weight + other.weight[vertex];
+			meeting_ = vertex;
+		}
+
+		// stall on demand: a higher vertex already reaches this one cheaper, so nothing found from here is shortest
+		for (uint32_t i = down_offsets[vertex]; i < down_offsets[vertex + 1]; ++i) {
+			if (side.weight[down[i].to] + down[i].weight < weight) {
+				return;
+			}
+		}
+
+		for (uint32_t i = up_offsets[vertex]; i < up_offsets[vertex + 1]; ++i) {
+			const auto& arc = up[i];
+			const double candidate = weight + arc.weight;
+			if (candidate < side.weight[arc.to]) {
+				if (side.weight[arc.to] == INF && other.weight[arc.to] == INF) {
+					touched_.push_back(arc.to);
+				}
+				side.weight[arc.to] = candidate;
+				side.parent_arc[arc.to] = arc.arc;
+				side.queue.push_back({ candidate, arc.to });
+				push_heap(side.queue.begin(), side.queue.end(), greater<QueueItem>{});
+			}
+		}
+	}
+
+	std::optional<double> HierarchySearch::Run(VertexId from, VertexId to) {
+
+		Reset();
+		best_ = INF;
+
+		forward_.weight[from] = 0;
+		forward_.queue.push_back({ 0, from });
+		touched_.push_back(from);
+		backward_.weight[to] = 0;
+		backward_.queue.push_back({ 0, to });
+		touched_.push_back(to);
+
+		const auto& ch = hierarchy_;
+		for (;;) {
+			const double forward_min = forward_.queue.empty() ? INF : forward_.queue.front().weight;
+			const double backward_min = backward_.queue.empty() ? INF : backward_.queue.front().weight;
+			if (min(forward_min, backward_min) >= best_) {
+				break;
+			}
+			if (forward_min <= backward_min) {
+				Step(forward_, backward_, ch.forward_offsets_, ch.forward_, ch.backward_offsets_, ch.backward_);
+			}
+			else {
+				Step(backward_, forward_, ch.backward_offsets_, ch.backward_, ch.forward_offsets_, ch.forward_);
+			}
+		}
+
+		if (best_ == INF) {
+			return nullopt;
+		}
+		return best_;
+	}
+
+	void HierarchySearch::Unpack(uint32_t arc, std::vector<EdgeId>& path) const {
+		vector<uint32_t> stack{ arc };
+		while (!stack.empty()) {
+			const auto& current = hierarchy_.arcs_[stack.back()];
+			stack.pop_back();
+			if (current.first == ContractionHierarchy::ORIGINAL) {
+				path.push_back(current.second);
+			}
+			else {
+				stack.push_back(current.second);
+				stack.push_back(current.first);
+			}
+		}
+	}
+
+	std::vector<EdgeId> HierarchySearch::GetPath() const {
+
+		vector<uint32_t> forward_arcs;
+		for (VertexId vertex = meeting_; forward_.parent_arc[vertex] != NO_ARC; ) {
+			forward_arcs.push_back(forward_.parent_arc[vertex]);
+			vertex = hierarchy_.arcs_[forward_arcs.back()].from;
+		}
+
+		vector<EdgeId> path;
+		for (auto it = forward_arcs.rbegin(); it != forward_arcs.rend(); ++it) {
+			Unpack(*it, path);
+		}
+		for (VertexId vertex = meeting_; backward_.parent_arc[vertex] != NO_ARC; ) {
+			const uint32_t arc = backward_.parent_arc[vertex];
+			Unpack(arc, path);
+			vertex = hierarchy_.arcs_[arc].to;
+		}
+		return path;
+	}
+
+	namespace tests {
+
+		// grid with random integer weights (so path sums compare exactly) and a few short one-way links
+		static DirectedWeightedGraph MakeGridGraph(VertexId side, unsigned seed) {
+			mt19937 generator(seed);
+			uniform_int_distribution<int> weight(1, 20);
+			uniform_int_distribution<int> shift(-3, 3);
+
+			DirectedWeightedGraph graph(size_t{ side } * side);
+			for (VertexId row = 0; row < side; ++row) {
+				for (VertexId col = 0; col < side; ++col) {
+					const VertexId vertex = row * side + col;
+					if (col + 1 < side) {
+						graph.AddEdge({ vertex, vertex + 1, static_cast<double>(weight(generator)) });
+						graph.AddEdge({ vertex + 1, vertex, static_cast<double>(weight(generator)) });
+					}
+					if (row + 1 < side) {
+						graph.AddEdge({ vertex, vertex + side, static_cast<double>(weight(generator)) });
+						graph.AddEdge({ vertex + side, vertex, static_cast<double>(weight(generator)) });
+					}
+					const int to_row = static_cast<int>(row) + shift(generator);
+					const int to_col = static_cast<int>(col) + shift(generator);
+					if (vertex % 4 == 0 && to_row >= 0 && to_row < static_cast<int>(side) && to_col >= 0 && to_col < static_cast<int>(side)) {
+						graph.AddEdge({ vertex, static_cast<VertexId>(to_row * side + to_col), static_cast<double>(weight(generator) * 3) });
+					}
+				}
+			}
+			graph.Build();
+			return graph;
+		}
+
+		void TestContractionHierarchy()
+		{
+			const DirectedWeightedGraph graph = MakeGridGraph(20, 7);
+			const ContractionHierarchy hierarchy(graph);
+			assert(hierarchy.GetVertexCount() == graph.GetVertexCount());
+
+			DijkstraSearch plain(graph);
+			HierarchySearch search(hierarchy);
+			mt19937 generator(11);
+			uniform_int_distribution<VertexId> vertex(0, 399);
+			for (int i = 0; i < 500; ++i) {
+				const VertexId from = vertex(generator);
+				const VertexId to = i % 50 == 0 ? from : vertex(generator);
+				const auto expected = plain.Run(from, to);
+				const auto actual = search.Run(from, to);
+				assert(expected == actual);
+
+				// the unpacked path is a chain of graph edges of the same weight
+				double weight = 0;
+				VertexId at = from;
+				for (EdgeId id : search.GetPath()) {
+					assert(graph.GetEdge(id).from == at);
+					at = graph.GetEdge(id).to;
+					weight += graph.GetEdge(id).weight;
+				}
+				assert(at == to && weight == *actual);
+			}
+
+			// a vertex nobody reaches
+			DirectedWeightedGraph lonely(3);
+			lonely.AddEdge({ 0, 1, 1 });
+			lonely.Build();
+			const ContractionHierarchy lonely_hierarchy(lonely);
+			HierarchySearch lonely_search(lonely_hierarchy);
+			assert(!lonely_search.Run(0, 2));
+			assert(*lonely_search.Run(0, 1) == 1);
+
+			// save / load round trip, bound to the graph it was built from
+			stringstream stream;
+			hierarchy.Save(stream);
+			const ContractionHierarchy loaded = ContractionHierarchy::Load(stream, graph);
+			assert(loaded.GetShortcutCount() == hierarchy.GetShortcutCount());
+			HierarchySearch loaded_search(loaded);
+			assert(loaded_search.Run(3, 350) == plain.Run(3, 350));
+
+			stream.clear();
+			stream.seekg(0);
+			bool thrown = false;
+			try {
+				ContractionHierarchy::Load(stream, MakeGridGraph(20, 8));
+			}
+			catch (const HierarchyError&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+	}
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace transport::graph {
+
+	class HierarchyError : public std::runtime_error {
+	public:
+		using runtime_error::runtime_error;
+	};
+
+	// Contraction hierarchy of a DirectedWeightedGraph: vertices are contracted one by one
+	// (by shortcuts added per arc removed, plus a level term; only the neighbours of a contracted
+	// vertex are re-rated), adding a shortcut wherever a shortest path went through the contracted
+	// vertex. A query is then two Dijkstra searches that only go up
+	// the contraction order. The graph must not change after the hierarchy is built.
+	class ContractionHierarchy {
+	public:
+		ContractionHierarchy() = default;
+		explicit ContractionHierarchy(const DirectedWeightedGraph& graph);
+
+		// Binary, host byte order. Load checks that the hierarchy was built from this very graph
+		// and throws HierarchyError otherwise.
+		void Save(std::ostream& output) const;
+		static ContractionHierarchy Load(std::istream& input, const DirectedWeightedGraph& graph);
+
+		size_t GetVertexCount() const;
+		size_t GetShortcutCount() const;
+
+	private:
+		friend class HierarchySearch;
+		class Builder;
+
+		static constexpr uint32_t ORIGINAL = ~uint32_t{ 0 };
+
+		struct Arc {
+			VertexId from;
+			VertexId to;
+			double weight;
+			uint32_t first;  // ORIGINAL for a graph edge, otherwise the two arcs the shortcut replaces
+			uint32_t second; // the graph EdgeId for a graph edge
+		};
+
+		struct UpArc {
+			VertexId to;
+			uint32_t arc;
+			double weight;
+		};
+
+		static uint64_t Fingerprint(const DirectedWeightedGraph& graph);
+
+	private:
+		uint64_t vertex_count_ = 0;
+		uint64_t fingerprint_ = 0;
+		std::vector<Arc> arcs_;
+		// forward_: arcs to a higher vertex, rows by "from"; backward_: arcs from a higher vertex, rows by "to"
+		std::vector<uint32_t> forward_offsets_;
+		std::vector<UpArc> forward_;
+		std::vector<uint32_t> backward_offsets_;
+		std::vector<UpArc> backward_;
+	};
+
+	// Bidirectional upward search over a hierarchy with buffers kept between runs,
+	// like DijkstraSearch. One object serves one search at a time.
+	class HierarchySearch {
+	public:
+		explicit HierarchySearch(const ContractionHierarchy& hierarchy);
+
+		std::optional<double> Run(VertexId from, VertexId to);
+		// graph edges of the path found by the last Run, from the start
+		std::vector<EdgeId> GetPath() const;
+
+	private:
+		struct QueueItem {
+			double weight;
+			VertexId vertex;
+
+			bool operator>(const QueueItem& other) const {
+				return weight > other.weight;
+			}
+		};
+
+		static constexpr uint32_t NO_ARC = ~uint32_t{ 0 };
+
+		struct Side {
+			std::vector<double> weight; // index: VertexId
+			std::vector<uint32_t> parent_arc;
+			std::vector<QueueItem> queue;
+		};
+
+		void Reset();
+		// settles one vertex of "side" searching over "up", stalled via "down"
+		void Step(Side& side, const Side& other, const std::vector<uint32_t>& up_offsets, const std::vector<ContractionHierarchy::UpArc>& up,
+			const std::vector<uint32_t>& down_offsets, const std::vector<ContractionHierarchy::UpArc>& down);
+		void Unpack(uint32_t arc, std::vector<EdgeId>& path) const;
+
+	private:
+		const ContractionHierarchy& hierarchy_;
+		Side forward_;
+		Side backward_;
+		std::vector<VertexId> touched_;
+		double best_ = 0;
+		VertexId meeting_ = 0;
+	};
+
+	namespace tests {
+		void TestContractionHierarchy();
+	}
+
+}
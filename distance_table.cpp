@@ -0,0 +1,201 @@
+#include "distance_table.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <tuple>
+
+namespace transport {
+
+	using namespace std;
+
+	void DistanceTable::Set(StopId from, StopId to, unsigned int distance) {
+
+		const size_t pos = Find(from, to);
+		if (pos == entries_.size()) {
+			pending_.push_back({ from, to, distance });
+			return;
+		}
+
+		// the pair is already in the rows: update in place
+		entries_[pos] = { to, distance };
+		is_explicit_[pos] = true;
+
+		const size_t reverse_pos = Find(to, from);
+		if (!is_explicit_[reverse_pos]) {
+			entries_[reverse_pos].distance = distance;
+		}
+	}
+
+	unsigned int DistanceTable::Get(StopId from, StopId to) const {
+		const size_t pos = Find(from, to);
+		return pos == entries_.size() ? 0 : entries_[pos].distance;
+	}
+
+	size_t DistanceTable::Find(StopId from, StopId to) const {
+
+		if (from + size_t{ 1 } >= offsets_.size()) {
+			return entries_.size();
+		}
+
+		const auto row_begin = entries_.begin() + offsets_[from];
+		const auto row_end = entries_.begin() + offsets_[from + 1];
+		const auto it = lower_bound(row_begin, row_end, to, [](const Entry& entry, StopId id) {
+			return entry.to < id;
+			});
+
+		if (it == row_end || it->to != to) {
+			return entries_.size();
+		}
+		return it - entries_.begin();
+	}
+
+	void DistanceTable::Build(unsigned threads) {
+
+		if (pending_.empty()) {
+			return;
+		}
+
+		// explicit pairs with the order of their Set calls: already built ones first, then pending
+		vector<pair<Edge, size_t>> edges;
+		edges.reserve(entries_.size() + pending_.size());
+		for (StopId from = 0; from + size_t{ 1 } < offsets_.size(); ++from) {
+			for (uint32_t i = offsets_[from]; i < offsets_[from + 1]; ++i) {
+				if (is_explicit_[i]) {
+					edges.push_back({ { from, entries_[i].to, entries_[i].distance }, edges.size() });
+				}
+			}
+		}
+		for (const Edge& edge : pending_) {
+			edges.push_back({ edge, edges.size() });
+		}
+		pending_.clear();
+		pending_.shrink_to_fit();
+
+		const auto by_pair = [](const Edge& lhs, const Edge& rhs) {
+			return tie(lhs.from, lhs.to) < tie(rhs.from, rhs.to);
+		};
+
+		// the latest Set of a pair wins
+		utils::ParallelSort(edges.begin(), edges.end(), [&by_pair](const auto& lhs, const auto& rhs) {
+			return by_pair(lhs.first, rhs.first) || (!by_pair(rhs.first, lhs.first) && lhs.second < rhs.second);
+			}, threads);
+		vector<Edge> explicit_edges;
+		explicit_edges.reserve(edges.size());
+		for (const auto& [edge, order] : edges) {
+			if (!explicit_edges.empty() && !by_pair(explicit_edges.back(), edge)) {
+				explicit_edges.back() = edge;
+			}
+			else {
+				explicit_edges.push_back(edge);
+			}
+		}
+		edges = {};
+
+		vector<char> has_reverse(explicit_edges.size());
+		utils::ParallelFor(explicit_edges.size(), threads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const Edge reverse{ explicit_edges[i].to, explicit_edges[i].from, 0 };
+				has_reverse[i] = binary_search(explicit_edges.begin(), explicit_edges.end(), reverse, by_pair);
+			}
+			});
+
+		// rows are built from (edge, is_explicit) sorted by (from, to)
+		vector<pair<Edge, bool>> rows;
+		rows.reserve(explicit_edges.size() * 2);
+		for (size_t i = 0; i < explicit_edges.size(); ++i) {
+			const Edge& edge = explicit_edges[i];
+			rows.push_back({ edge, true });
+			if (!has_reverse[i]) {
+				rows.push_back({ { edge.to, edge.from, edge.distance }, false });
+			}
+		}
+		utils::ParallelSort(rows.begin(), rows.end(), [&by_pair](const auto& lhs, const auto& rhs) {
+			return by_pair(lhs.first, rhs.first);
+			}, threads);
+
+		StopId max_id = 0;
+		for (const auto& [edge, is_explicit] : rows) {
+			max_id = max(max_id, edge.from);
+		}
+
+		offsets_.assign(max_id + size_t{ 2 }, 0);
+		entries_.clear();
+		entries_.reserve(rows.size());
+		is_explicit_.assign(rows.size(), false);
+		for (const auto& [edge, is_explicit] : rows) {
+			++offsets_[edge.from + 1];
+			is_explicit_[entries_.size()] = is_explicit;
+			entries_.push_back({ edge.to, edge.distance });
+		}
+		for (size_t i = 1; i < offsets_.size(); ++i) {
+			offsets_[i] += offsets_[i - 1];
+		}
+	}
+
+	bool DistanceTable::HasPending() const {
+		return !pending_.empty();
+	}
+
+	size_t DistanceTable::GetEntryCount() const {
+		return entries_.size();
+	}
+
+	const std::vector<uint32_t>& DistanceTable::GetOffsets() const {
+		return offsets_;
+	}
+
+	const std::vector<DistanceTable::Entry>& DistanceTable::GetEntries() const {
+		return entries_;
+	}
+
+	size_t DistanceTable::GetMemoryUsage() const {
+		return offsets_.capacity() * sizeof(uint32_t)
+			+ entries_.capacity() * sizeof(Entry)
+			+ is_explicit_.capacity() / 8
+			+ pending_.capacity() * sizeof(Edge);
+	}
+
+	namespace tests {
+		void TestDistanceTable()
+		{
+			DistanceTable table;
+			assert(table.Get(0, 1) == 0);
+
+			table.Set(0, 1, 100);
+			table.Set(2, 0, 50);
+			table.Set(1, 0, 70);
+			table.Set(3, 3, 10);
+			table.Set(0, 1, 120); // the latest value wins
+			assert(table.HasPending());
+			table.Build();
+			assert(!table.HasPending());
+
+			assert(table.Get(0, 1) == 120);
+			assert(table.Get(1, 0) == 70);
+			assert(table.Get(0, 2) == 50); // reverse direction
+			assert(table.Get(2, 0) == 50);
+			assert(table.Get(3, 3) == 10);
+			assert(table.Get(1, 2) == 0);
+			assert(table.Get(100, 2) == 0);
+			assert(table.GetEntryCount() == 5);
+
+			// updates of known pairs do not need a rebuild
+			table.Set(2, 0, 55);
+			assert(!table.HasPending());
+			assert(table.Get(0, 2) == 55);
+			table.Set(0, 2, 60);
+			table.Set(2, 0, 65);
+			assert(table.Get(0, 2) == 60);
+
+			table.Set(4, 1, std::numeric_limits<unsigned int>::max());
+			table.Build();
+			assert(table.Get(1, 4) == std::numeric_limits<unsigned int>::max());
+			assert(table.Get(0, 1) == 120);
+			assert(table.Get(0, 2) == 60);
+			assert(table.GetMemoryUsage() > 0);
+		}
+	}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace transport {
+
+	// Road distances between stops in CSR layout: the neighbours of every stop lie
+	// in one contiguous sorted row. The reverse direction is resolved at build time,
+	// so Get(from, to) is a single lookup in the row of "from".
+	class DistanceTable {
+	public:
+		struct Entry {
+			StopId to;
+			unsigned int distance;
+		};
+
+		// explicit distance from -> to; it is also used for to -> from unless that one is set explicitly
+		void Set(StopId from, StopId to, unsigned int distance);
+		unsigned int Get(StopId from, StopId to) const; // 0 if unknown; call Build() after new pairs were set
+
+		// merges pairs added since the last build into the rows
+		void Build(unsigned threads = 1);
+		bool HasPending() const;
+
+		size_t GetEntryCount() const;
+		size_t GetMemoryUsage() const; // bytes
+
+		// raw rows as of the last build: row of stop i is entries[offsets[i]..offsets[i + 1]),
+		// offsets may be shorter than the number of stops
+		const std::vector<uint32_t>& GetOffsets() const;
+		const std::vector<Entry>& GetEntries() const;
+
+	private:
+		struct Edge {
+			StopId from;
+			StopId to;
+			unsigned int distance;
+		};
+
+		// position of "to" in the row of "from" or entries_.size()
+		size_t Find(StopId from, StopId to) const;
+
+	private:
+		std::vector<uint32_t> offsets_; // row of stop i is [offsets_[i], offsets_[i + 1])
+		std::vector<Entry> entries_;
+		std::vector<bool> is_explicit_; // parallel to entries_; false for resolved reverse entries
+		std::vector<Edge> pending_;
+	};
+
+	namespace tests {
+		void TestDistanceTable();
+	}
+
+}
@@ -2,19 +2,26 @@
 
 #include "geo.h"
 
+#include <cstdint>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <set>
 
 namespace transport {
 
+	// dense ids are assigned by TransportCatalogue in order of addition: 0, 1, 2...
+	using StopId = uint32_t;
+	using BusId = uint32_t;
+
 	struct Stop;
 
 	struct Bus { // aka Route		
 
-		std::string name;
-		std::vector<const Stop*> stops;
+		std::pmr::string name;
+		std::pmr::vector<const Stop*> stops;
 		bool isRing;
+		BusId id;
 
 		bool operator<(const Bus& other) const {
 			return name < other.name;
@@ -32,8 +39,9 @@ namespace transport {
 	using BusSet = std::set<const Bus*, BusComparator>;
 
 	struct Stop {
-		std::string name;
+		std::pmr::string name;
 		::geo::Coordinates coords;
+		StopId id;
 	};
 
 }
\ No newline at end of file
@@ -1,7 +1,15 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
 
 namespace geo {
 
@@ -17,4 +25,136 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * radius;
 }
 
+double ComputeDistance(Coordinates from, Coordinates to, DistanceMode mode) {
+    using namespace std;
+    static const double dr = M_PI / 180.;
+    static const int radius = 6371000;
+    switch (mode) {
+    case DistanceMode::HAVERSINE: {
+        const double sin_lat = sin((to.lat - from.lat) * dr / 2);
+        const double sin_lng = sin((to.lng - from.lng) * dr / 2);
+        const double hav = sin_lat * sin_lat + cos(from.lat * dr) * cos(to.lat * dr) * sin_lng * sin_lng;
+        return 2 * radius * asin(sqrt(min(1., hav)));
+    }
+    case DistanceMode::EQUIRECTANGULAR: {
+        // the shorter way around, so that the antimeridian is not a wall
+        double dlng = to.lng - from.lng;
+        dlng = dlng > 180 ? dlng - 360 : dlng < -180 ? dlng + 360 : dlng;
+        const double x = dlng * dr * cos((from.lat + to.lat) / 2 * dr);
+        const double y = (to.lat - from.lat) * dr;
+        return sqrt(x * x + y * y) * radius;
+    }
+    default:
+        return ComputeDistance(from, to);
+    }
+}
+
+namespace tests {
+
+namespace {
+
+// the great circle distance by the atan2 formula in long double: exact at any distance
+double ReferenceDistance(Coordinates from, Coordinates to) {
+    const long double dr = M_PI / 180.;
+    const long double lat1 = from.lat * dr, lat2 = to.lat * dr, dlng = (to.lng - from.lng) * dr;
+    const long double y = std::hypot(std::cos(lat2) * std::sin(dlng),
+        std::cos(lat1) * std::sin(lat2) - std::sin(lat1) * std::cos(lat2) * std::cos(dlng));
+    const long double x = std::sin(lat1) * std::sin(lat2) + std::cos(lat1) * std::cos(lat2) * std::cos(dlng);
+    return static_cast<double>(std::atan2(y, x) * 6371000);
+}
+
+// a point at the given distance (up to x1.5) and a random bearing from a random point at |lat| <= 60
+std::pair<Coordinates, Coordinates> RandomPair(std::mt19937& generator, double meters) {
+    std::uniform_real_distribution<double> lat(-60, 60), lng(-180, 180), bearing(0, 2 * M_PI), scale(0.5, 1.5);
+    const double dr = M_PI / 180.;
+    const Coordinates from{ lat(generator), lng(generator) };
+    const double angle = meters * scale(generator) / 6371000;
+    const double course = bearing(generator);
+    const double lat1 = from.lat * dr;
+    const double lat2 = std::asin(std::sin(lat1) * std::cos(angle) + std::cos(lat1) * std::sin(angle) * std::cos(course));
+    const double lng2 = from.lng * dr + std::atan2(std::sin(course) * std::sin(angle) * std::cos(lat1),
+        std::cos(angle) - std::sin(lat1) * std::sin(lat2));
+    return { from, { lat2 / dr, std::remainder(lng2 / dr, 360.) } };
+}
+
+const DistanceMode MODES[] = { DistanceMode::EXACT, DistanceMode::HAVERSINE, DistanceMode::EQUIRECTANGULAR };
+const char* const MODE_NAMES[] = { "exact", "haversine", "equirectangular" };
+
+}  // namespace
+
+void TestDistanceModes() {
+    const Coordinates moscow{ 55.7558, 37.6173 }, near{ 55.7559, 37.6174 };
+    for (DistanceMode mode : MODES) {
+        assert(ComputeDistance(moscow, moscow, mode) == 0);
+        assert(ComputeDistance(moscow, near, mode) == ComputeDistance(near, moscow, mode));
+    }
+    assert(ComputeDistance(moscow, near, DistanceMode::EXACT) == ComputeDistance(moscow, near));
+
+    // a quarter of the equator and across the antimeridian
+    const double quarter = M_PI / 2 * 6371000;
+    assert(std::abs(ComputeDistance({ 0, 0 }, { 0, 90 }, DistanceMode::HAVERSINE) - quarter) < 1e-6);
+    assert(std::abs(ComputeDistance({ 0, 0 }, { 0, 90 }, DistanceMode::EQUIRECTANGULAR) - quarter) < 1e-6);
+    assert(ComputeDistance({ 10, 179.99 }, { 10, -179.99 }, DistanceMode::EQUIRECTANGULAR) < 2500);
+
+    // the bounds of the table in geo.h, with some room
+    std::mt19937 generator(5);
+    const std::pair<double, double> equirectangular_bounds[] = { { 1000, 2e-8 }, { 10000, 2e-6 }, { 100000, 2e-4 } };
+    for (const auto& [meters, relative] : equirectangular_bounds) {
+        for (int i = 0; i < 2000; ++i) {
+            const auto [from, to] = RandomPair(generator, meters);
+            const double expected = ReferenceDistance(from, to);
+            assert(std::abs(ComputeDistance(from, to, DistanceMode::EXACT) - expected) < 0.1);
+            assert(std::abs(ComputeDistance(from, to, DistanceMode::HAVERSINE) - expected) < 1e-8);
+            assert(std::abs(ComputeDistance(from, to, DistanceMode::EQUIRECTANGULAR) - expected) <= expected * relative + 1e-8);
+        }
+    }
+}
+
+void BenchmarkDistanceModes() {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937 generator(3);
+
+    std::cerr << "max error, meters (relative)\n" << std::setw(10) << "distance";
+    for (const char* name : MODE_NAMES) {
+        std::cerr << std::setw(26) << name;
+    }
+    std::cerr << '\n';
+    for (double meters : { 10., 100., 1e3, 1e4, 1e5, 1e6, 1e7 }) {
+        double absolute[3] = {}, relative[3] = {};
+        for (int i = 0; i < 200000; ++i) {
+            const auto [from, to] = RandomPair(generator, meters);
+            const double expected = ReferenceDistance(from, to);
+            for (int mode = 0; mode < 3; ++mode) {
+                const double error = std::abs(ComputeDistance(from, to, MODES[mode]) - expected);
+                absolute[mode] = std::max(absolute[mode], error);
+                relative[mode] = std::max(relative[mode], error / expected);
+            }
+        }
+        std::cerr << std::setw(10) << meters;
+        for (int mode = 0; mode < 3; ++mode) {
+            std::ostringstream cell;
+            cell << std::setprecision(2) << absolute[mode] << " (" << relative[mode] << ')';
+            std::cerr << std::setw(26) << cell.str();
+        }
+        std::cerr << '\n';
+    }
+
+    // city-sized pairs, as the catalogue sees them
+    std::vector<std::pair<Coordinates, Coordinates>> pairs(1000000);
+    for (auto& pair : pairs) {
+        pair = RandomPair(generator, 5000);
+    }
+    for (int mode = 0; mode < 3; ++mode) {
+        const auto start = Clock::now();
+        double sum = 0;
+        for (const auto& [from, to] : pairs) {
+            sum += ComputeDistance(from, to, MODES[mode]);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / pairs.size();
+        std::cerr << MODE_NAMES[mode] << ": " << ns << " ns per distance (sum " << sum << ")\n";
+    }
+}
+
+}  // namespace tests
+
 }  // namespace geo
\ No newline at end of file
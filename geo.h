@@ -15,4 +15,29 @@ struct Coordinates {
 
 double ComputeDistance(Coordinates from, Coordinates to);
 
+// Ways to measure the distance between two points of the sphere, from the most exact to the
+// cheapest. Max errors against the great circle distance, as measured by
+// tests::BenchmarkDistanceModes over |latitude| <= 60 (relative in parentheses):
+//
+//   distance    EXACT          HAVERSINE    EQUIRECTANGULAR
+//   10 m        2e-3 m         2e-9 m       1e-9 m
+//   1 km        2e-5 m         2e-9 m       1.2e-5 m (8e-9)
+//   10 km       2e-6 m         2e-9 m       1.2e-2 m (8e-7)
+//   100 km      2e-7 m         3e-9 m       12 m (8e-5)
+//   1000 km     2e-8 m         3e-9 m       17 km (1.1%)
+//   10000 km    6e-9 m         9e-9 m       8000 km (75%)
+//   time        41 ns          26 ns        11 ns
+enum class DistanceMode {
+    EXACT,           // spherical law of cosines, what ComputeDistance(from, to) does
+    HAVERSINE,       // same sphere, but stable for close points: no acos of a number near 1
+    EQUIRECTANGULAR, // flat map at the mean latitude: one cos and a sqrt; for a city, not for a planet
+};
+
+double ComputeDistance(Coordinates from, Coordinates to, DistanceMode mode);
+
+namespace tests {
+    void TestDistanceModes();
+    void BenchmarkDistanceModes(); // prints the error table and throughput to std::cerr
+}
+
 }  // namespace geo
\ No newline at end of file
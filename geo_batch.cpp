@@ -0,0 +1,312 @@
+#define _USE_MATH_DEFINES
+#include "geo_batch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GEO_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and clang compile intrinsics of an instruction set only in functions marked for it
+#if defined(GEO_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GEO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GEO_TARGET_AVX2
+#endif
+
+namespace geo {
+
+namespace {
+
+const double DR = M_PI / 180.;
+const double RADIUS = 6371000;
+
+// cosine of the central angle; the kernels below keep exactly this order of operations
+inline double Cosine(const PreparedPoint* points, uint32_t a, uint32_t b) {
+    const PreparedPoint& p = points[a];
+    const PreparedPoint& q = points[b];
+    const double cos_dlng = p.cos_lng * q.cos_lng + p.sin_lng * q.sin_lng;
+    return p.sin_lat * q.sin_lat + p.cos_lat * q.cos_lat * cos_dlng;
+}
+
+void CosinesScalar(const PreparedPoint* points, const uint32_t* from, const uint32_t* to, size_t count, double* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = Cosine(points, from[i], to[i]);
+    }
+}
+
+#ifdef GEO_X86
+
+// a point is two aligned loads: { sin_lat, cos_lat } and { sin_lng, cos_lng }
+void CosinesSse2(const PreparedPoint* points, const uint32_t* from, const uint32_t* to, size_t count, double* out) {
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const double* a0 = &points[from[i]].sin_lat;
+        const double* a1 = &points[from[i + 1]].sin_lat;
+        const double* b0 = &points[to[i]].sin_lat;
+        const double* b1 = &points[to[i + 1]].sin_lat;
+        // products of the same values of the two points of a pair
+        const __m128d lat0 = _mm_mul_pd(_mm_load_pd(a0), _mm_load_pd(b0));
+        const __m128d lat1 = _mm_mul_pd(_mm_load_pd(a1), _mm_load_pd(b1));
+        const __m128d lng0 = _mm_mul_pd(_mm_load_pd(a0 + 2), _mm_load_pd(b0 + 2));
+        const __m128d lng1 = _mm_mul_pd(_mm_load_pd(a1 + 2), _mm_load_pd(b1 + 2));
+        // the same products of both pairs side by side
+        const __m128d cos_dlng = _mm_add_pd(_mm_unpackhi_pd(lng0, lng1), _mm_unpacklo_pd(lng0, lng1));
+        const __m128d cosine = _mm_add_pd(_mm_unpacklo_pd(lat0, lat1), _mm_mul_pd(_mm_unpackhi_pd(lat0, lat1), cos_dlng));
+        _mm_storeu_pd(out + i, cosine);
+    }
+    CosinesScalar(points, from + i, to + i, count - i, out + i);
+}
+
+// a point is one aligned load; four pairs are multiplied, then transposed into columns
+GEO_TARGET_AVX2 void CosinesAvx2(const PreparedPoint* points, const uint32_t* from, const uint32_t* to, size_t count, double* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d products[4];
+        for (size_t k = 0; k < 4; ++k) {
+            products[k] = _mm256_mul_pd(_mm256_load_pd(&points[from[i + k]].sin_lat), _mm256_load_pd(&points[to[i + k]].sin_lat));
+        }
+        const __m256d lo01 = _mm256_unpacklo_pd(products[0], products[1]); // sin_lat 0 1, sin_lng 0 1
+        const __m256d hi01 = _mm256_unpackhi_pd(products[0], products[1]); // cos_lat 0 1, cos_lng 0 1
+        const __m256d lo23 = _mm256_unpacklo_pd(products[2], products[3]);
+        const __m256d hi23 = _mm256_unpackhi_pd(products[2], products[3]);
+        const __m256d sin_lat = _mm256_permute2f128_pd(lo01, lo23, 0x20);
+        const __m256d sin_lng = _mm256_permute2f128_pd(lo01, lo23, 0x31);
+        const __m256d cos_lat = _mm256_permute2f128_pd(hi01, hi23, 0x20);
+        const __m256d cos_lng = _mm256_permute2f128_pd(hi01, hi23, 0x31);
+        const __m256d cosine = _mm256_add_pd(sin_lat, _mm256_mul_pd(cos_lat, _mm256_add_pd(cos_lng, sin_lng)));
+        _mm256_storeu_pd(out + i, cosine);
+    }
+    CosinesScalar(points, from + i, to + i, count - i, out + i);
+}
+
+bool HasAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && (info[1] & (1 << 5));
+#else
+    return false;
+#endif
+}
+
+#endif
+
+DistanceKernel Resolve(DistanceKernel kernel) {
+    if (kernel != DistanceKernel::BEST) {
+        return kernel;
+    }
+    // not AVX2: the pairs index the points at random, so the time goes to the loads and the acos,
+    // and the wider registers only add the shuffles of the transposition
+    return IsKernelSupported(DistanceKernel::SSE2) ? DistanceKernel::SSE2 : DistanceKernel::SCALAR;
+}
+
+}  // namespace
+
+bool IsKernelSupported(DistanceKernel kernel) {
+    switch (kernel) {
+#ifdef GEO_X86
+    case DistanceKernel::SSE2:
+        return true;
+    case DistanceKernel::AVX2: {
+        static const bool has_avx2 = HasAvx2();
+        return has_avx2;
+    }
+#endif
+    case DistanceKernel::SCALAR:
+    case DistanceKernel::BEST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+PreparedPoints::PreparedPoints(const std::vector<Coordinates>& points) {
+    coords_.reserve(points.size());
+    prepared_.reserve(points.size());
+    for (const Coordinates& point : points) {
+        Add(point);
+    }
+}
+
+void PreparedPoints::Add(Coordinates point) {
+    coords_.push_back(point);
+    prepared_.push_back({ std::sin(point.lat * DR), std::cos(point.lat * DR), std::sin(point.lng * DR), std::cos(point.lng * DR) });
+}
+
+size_t PreparedPoints::Size() const {
+    return coords_.size();
+}
+
+double PreparedPoints::ComputeDistance(uint32_t from, uint32_t to) const {
+    double distance;
+    ComputeDistances(&from, &to, 1, &distance, DistanceKernel::SCALAR);
+    return distance;
+}
+
+void PreparedPoints::ComputeDistances(const uint32_t* from, const uint32_t* to, size_t count, double* distances,
+    DistanceKernel kernel) const {
+
+    const PreparedPoint* points = prepared_.data();
+    switch (Resolve(kernel)) {
+#ifdef GEO_X86
+    case DistanceKernel::AVX2:
+        CosinesAvx2(points, from, to, count, distances);
+        break;
+    case DistanceKernel::SSE2:
+        CosinesSse2(points, from, to, count, distances);
+        break;
+#endif
+    default:
+        CosinesScalar(points, from, to, count, distances);
+        break;
+    }
+
+    // the same point is exactly 0 apart, as in ComputeDistance; rounding may take the cosine past +-1
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = coords_[from[i]] == coords_[to[i]] ? 0.
+            : std::acos(std::clamp(distances[i], -1., 1.)) * RADIUS;
+    }
+}
+
+namespace tests {
+
+void TestPreparedPoints() {
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> lat(-90, 90), lng(-180, 180), step(-0.01, 0.01);
+
+    // whole globe, a dense city and a few exact edge cases
+    std::vector<Coordinates> points{ { 0, 0 }, { 0, 180 }, { 90, 0 }, { -90, 0 }, { 55.75, 37.62 }, { 55.75, 37.62 } };
+    for (int i = 0; i < 500; ++i) {
+        points.push_back({ lat(generator), lng(generator) });
+    }
+    for (int i = 0; i < 500; ++i) {
+        points.push_back({ 55.75 + step(generator), 37.62 + step(generator) });
+    }
+    PreparedPoints prepared(points);
+    assert(prepared.Size() == points.size());
+
+    std::vector<uint32_t> from, to;
+    for (uint32_t a = 0; a < points.size(); a += 7) {
+        for (uint32_t b = 0; b < points.size(); b += 5) {
+            from.push_back(a);
+            to.push_back(b);
+        }
+    }
+    from.push_back(4); // the same coordinates under two indexes
+    to.push_back(5);
+
+    std::vector<double> scalar(from.size());
+    prepared.ComputeDistances(from.data(), to.data(), from.size(), scalar.data(), DistanceKernel::SCALAR);
+    for (DistanceKernel kernel : { DistanceKernel::SSE2, DistanceKernel::AVX2, DistanceKernel::BEST }) {
+        if (!IsKernelSupported(kernel)) {
+            continue;
+        }
+        // odd counts leave a tail for the scalar loop
+        for (size_t count : { from.size(), from.size() - 3, size_t{ 1 } }) {
+            std::vector<double> simd(count);
+            prepared.ComputeDistances(from.data(), to.data(), count, simd.data(), kernel);
+            assert(std::equal(simd.begin(), simd.end(), scalar.begin()));
+        }
+    }
+
+    for (size_t i = 0; i < from.size(); ++i) {
+        const double expected = ::geo::ComputeDistance(points[from[i]], points[to[i]]);
+        assert(std::abs(scalar[i] - expected) <= std::max(0.1, expected * 1e-9));
+        assert(scalar[i] == prepared.ComputeDistance(from[i], to[i]));
+    }
+    assert(scalar.back() == 0);
+    assert(prepared.ComputeDistance(0, 0) == 0);
+    assert(std::abs(prepared.ComputeDistance(2, 3) - M_PI * RADIUS) < 1e-6);
+
+    // the default kernel is never slower than the scalar one: the best of a few runs each, with some room for noise
+    std::uniform_int_distribution<uint32_t> point(0, static_cast<uint32_t>(points.size() - 1));
+    std::vector<uint32_t> random_from(100000), random_to(100000);
+    for (size_t i = 0; i < random_from.size(); ++i) {
+        random_from[i] = point(generator);
+        random_to[i] = point(generator);
+    }
+    std::vector<double> distances(random_from.size());
+    const auto fastest = [&](DistanceKernel kernel) {
+        auto best = std::chrono::steady_clock::duration::max();
+        for (int run = 0; run < 7; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            prepared.ComputeDistances(random_from.data(), random_to.data(), random_from.size(), distances.data(), kernel);
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        return best;
+    };
+    assert(fastest(DistanceKernel::BEST) <= fastest(DistanceKernel::SCALAR) * 5 / 4);
+}
+
+void BenchmarkPreparedPoints() {
+    using Clock = std::chrono::steady_clock;
+
+    // stops of a city, pairs as consecutive stops of routes
+    constexpr uint32_t POINTS = 100000;
+    constexpr size_t PAIRS = 4000000;
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> lat(55.5, 56), lng(37.3, 38);
+    std::uniform_int_distribution<uint32_t> point(0, POINTS - 1);
+
+    std::vector<Coordinates> points(POINTS);
+    for (auto& coords : points) {
+        coords = { lat(generator), lng(generator) };
+    }
+    std::vector<uint32_t> from(PAIRS), to(PAIRS);
+    for (size_t i = 0; i < PAIRS; ++i) {
+        from[i] = point(generator);
+        to[i] = point(generator);
+    }
+
+    const auto report = [](const char* name, Clock::duration duration, double sum) {
+        std::cerr << name << ": " << std::chrono::duration<double, std::nano>(duration).count() / PAIRS
+            << " ns per pair (sum " << sum << ")\n";
+    };
+
+    const auto exact_start = Clock::now();
+    double exact_sum = 0;
+    for (size_t i = 0; i < PAIRS; ++i) {
+        exact_sum += ::geo::ComputeDistance(points[from[i]], points[to[i]]);
+    }
+    report("ComputeDistance", Clock::now() - exact_start, exact_sum);
+
+    const auto prepare_start = Clock::now();
+    PreparedPoints prepared(points);
+    std::cerr << "prepare: " << std::chrono::duration<double, std::milli>(Clock::now() - prepare_start).count()
+        << " ms for " << POINTS << " points\n";
+
+    std::vector<double> distances(PAIRS);
+    const std::pair<const char*, DistanceKernel> kernels[] = {
+        { "scalar", DistanceKernel::SCALAR }, { "sse2", DistanceKernel::SSE2 }, { "avx2", DistanceKernel::AVX2 } };
+    for (const auto& [name, kernel] : kernels) {
+        if (!IsKernelSupported(kernel)) {
+            continue;
+        }
+        const auto start = Clock::now();
+        prepared.ComputeDistances(from.data(), to.data(), PAIRS, distances.data(), kernel);
+        const auto duration = Clock::now() - start;
+        double sum = 0;
+        for (double distance : distances) {
+            sum += distance;
+        }
+        report(name, duration, sum);
+    }
+}
+
+}  // namespace tests
+
+}  // namespace geo
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geo {
+
+// Implementations of PreparedPoints::ComputeDistances; all give bit for bit the same results
+enum class DistanceKernel {
+    SCALAR,
+    SSE2,
+    AVX2,
+    BEST, // the fastest one the CPU supports: SSE2 on x86
+};
+
+bool IsKernelSupported(DistanceKernel kernel);
+
+// the values of one point PreparedPoints keeps, in the order the kernels load them
+struct alignas(32) PreparedPoint {
+    double sin_lat;
+    double cos_lat;
+    double sin_lng;
+    double cos_lng;
+};
+
+// Points with the sines and cosines of their latitude and longitude computed once, so that
+// the distance between two of them takes a few multiplications and one acos instead of
+// five trigonometric calls. Same formula as ComputeDistance with cos(lng1 - lng2) expanded;
+// results differ from it by rounding only: within 1e-9 relative, or 0.1 m for points
+// closer than that (which is how exact the acos formula is there anyway).
+class PreparedPoints {
+public:
+    PreparedPoints() = default;
+    explicit PreparedPoints(const std::vector<Coordinates>& points);
+
+    void Add(Coordinates point); // its index is the number of points before it
+    size_t Size() const;
+
+    double ComputeDistance(uint32_t from, uint32_t to) const;
+    // distances[i] from point from[i] to point to[i], meters
+    void ComputeDistances(const uint32_t* from, const uint32_t* to, size_t count, double* distances,
+        DistanceKernel kernel = DistanceKernel::BEST) const;
+
+private:
+    std::vector<Coordinates> coords_;
+    // a point per 32-byte block, so that a pair costs two contiguous loads, not eight scattered ones
+    std::vector<PreparedPoint> prepared_;
+};
+
+namespace tests {
+    void TestPreparedPoints();
+    void BenchmarkPreparedPoints(); // prints to std::cerr
+}
+
+}  // namespace geo
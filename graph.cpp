@@ -0,0 +1,255 @@
+#include "graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+
+namespace transport::graph {
+
+	using namespace std;
+
+	DirectedWeightedGraph::DirectedWeightedGraph(size_t vertex_count)
+		: vertex_count_(vertex_count)
+	{
+	}
+
+	EdgeId DirectedWeightedGraph::AddEdge(const Edge& edge) {
+		assert(edge.from < vertex_count_ && edge.to < vertex_count_);
+		edges_.push_back(edge);
+		return static_cast<EdgeId>(edges_.size() - 1);
+	}
+
+	void DirectedWeightedGraph::Build() {
+
+		offsets_.assign(vertex_count_ + 1, 0);
+		for (const Edge& edge : edges_) {
+			++offsets_[edge.from + 1];
+		}
+		for (size_t vertex = 0; vertex < vertex_count_; ++vertex) {
+			offsets_[vertex + 1] += offsets_[vertex];
+		}
+
+		vector<uint32_t> position(offsets_.begin(), offsets_.end() - 1);
+		outgoing_.resize(edges_.size());
+		for (EdgeId id = 0; id < edges_.size(); ++id) {
+			const Edge& edge = edges_[id];
+			outgoing_[position[edge.from]++] = { edge.to, id, edge.weight };
+		}
+	}
+
+	size_t DirectedWeightedGraph::GetVertexCount() const {
+		return vertex_count_;
+	}
+
+	size_t DirectedWeightedGraph::GetEdgeCount() const {
+		return edges_.size();
+	}
+
+	const Edge& DirectedWeightedGraph::GetEdge(EdgeId id) const {
+		return edges_[id];
+	}
+
+	OutgoingRange DirectedWeightedGraph::GetOutgoingEdges(VertexId from) const {
+		const OutgoingEdge* data = outgoing_.data();
+		return { data + offsets_[from], data + offsets_[from + 1] };
+	}
+
+	DijkstraSearch::DijkstraSearch(const DirectedWeightedGraph& graph)
+		: graph_(graph)
+		, weight_(graph.GetVertexCount(), numeric_limits<double>::infinity())
+		, prev_edge_(graph.GetVertexCount(), NO_EDGE)
+	{
+	}
+
+	void DijkstraSearch::Reset() {
+		for (VertexId vertex : touched_) {
+			weight_[vertex] = numeric_limits<double>::infinity();
+			prev_edge_[vertex] = NO_EDGE;
+		}
+		touched_.clear();
+		queue_.clear();
+		settled_.clear();
+	}
+
+	std::optional<double> DijkstraSearch::Run(VertexId from, VertexId to) {
+
+		Reset();
+		source_ = from;
+
+		weight_[from] = 0;
+		touched_.push_back(from);
+		queue_.push_back({ 0, from });
+
+		while (!queue_.empty()) {
+
+			pop_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+			const auto [weight, vertex] = queue_.back();
+			queue_.pop_back();
+
+			if (weight > weight_[vertex]) {
+				continue; // outdated queue item
+			}
+			if (vertex == to) {
+				return weight;
+			}
+
+			for (const OutgoingEdge& edge : graph_.GetOutgoingEdges(vertex)) {
+				const double candidate = weight + edge.weight;
+				if (candidate < weight_[edge.to]) {
+					if (prev_edge_[edge.to] == NO_EDGE && edge.to != from) {
+						touched_.push_back(edge.to);
+					}
+					weight_[edge.to] = candidate;
+					prev_edge_[edge.to] = edge.id;
+					queue_.push_back({ candidate, edge.to });
+					push_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+				}
+			}
+		}
+
+		return nullopt;
+	}
+
+	std::vector<EdgeId> DijkstraSearch::GetPath(VertexId to) const {
+		vector<EdgeId> path;
+		for (VertexId vertex = to; vertex != source_ && prev_edge_[vertex] != NO_EDGE; ) {
+			path.push_back(prev_edge_[vertex]);
+			vertex = graph_.GetEdge(prev_edge_[vertex]).from;
+		}
+		reverse(path.begin(), path.end());
+		return path;
+	}
+
+	const std::vector<VertexId>& DijkstraSearch::RunBounded(VertexId from, double limit) {
+
+		Reset();
+		source_ = from;
+
+		weight_[from] = 0;
+		touched_.push_back(from);
+		queue_.push_back({ 0, from });
+
+		while (!queue_.empty()) {
+
+			pop_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+			const auto [weight, vertex] = queue_.back();
+			queue_.pop_back();
+
+			if (weight > weight_[vertex]) {
+				continue; // outdated queue item
+			}
+			settled_.push_back(vertex);
+
+			for (const OutgoingEdge& edge : graph_.GetOutgoingEdges(vertex)) {
+				const double candidate = weight + edge.weight;
+				// what is past the limit never gets into the queue
+				if (candidate <= limit && candidate < weight_[edge.to]) {
+					if (prev_edge_[edge.to] == NO_EDGE && edge.to != from) {
+						touched_.push_back(edge.to);
+					}
+					weight_[edge.to] = candidate;
+					prev_edge_[edge.to] = edge.id;
+					queue_.push_back({ candidate, edge.to });
+					push_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+				}
+			}
+		}
+
+		return settled_;
+	}
+
+	void DijkstraSearch::RunToTargets(VertexId from, const std::vector<VertexId>& targets) {
+
+		Reset();
+		source_ = from;
+
+		// stamps instead of clearing marks between runs
+		if (target_stamp_.empty() || ++stamp_ == 0) {
+			target_stamp_.assign(graph_.GetVertexCount(), 0);
+			stamp_ = 1;
+		}
+		size_t remaining = 0;
+		for (VertexId target : targets) {
+			if (target_stamp_[target] != stamp_) {
+				target_stamp_[target] = stamp_;
+				++remaining;
+			}
+		}
+
+		weight_[from] = 0;
+		touched_.push_back(from);
+		queue_.push_back({ 0, from });
+
+		while (!queue_.empty() && remaining > 0) {
+
+			pop_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+			const auto [weight, vertex] = queue_.back();
+			queue_.pop_back();
+
+			if (weight > weight_[vertex]) {
+				continue; // outdated queue item
+			}
+			if (target_stamp_[vertex] == stamp_) {
+				--remaining;
+			}
+
+			for (const OutgoingEdge& edge : graph_.GetOutgoingEdges(vertex)) {
+				const double candidate = weight + edge.weight;
+				if (candidate < weight_[edge.to]) {
+					if (prev_edge_[edge.to] == NO_EDGE && edge.to != from) {
+						touched_.push_back(edge.to);
+					}
+					weight_[edge.to] = candidate;
+					prev_edge_[edge.to] = edge.id;
+					queue_.push_back({ candidate, edge.to });
+					push_heap(queue_.begin(), queue_.end(), greater<QueueItem>{});
+				}
+			}
+		}
+	}
+
+	double DijkstraSearch::GetWeight(VertexId vertex) const {
+		return weight_[vertex];
+	}
+
+	namespace tests {
+		void TestDijkstraSearch()
+		{
+			DirectedWeightedGraph graph(5);
+			graph.AddEdge({ 0, 1, 1 });
+			graph.AddEdge({ 1, 2, 1 });
+			const EdgeId direct = graph.AddEdge({ 0, 2, 1.5 });
+			graph.AddEdge({ 2, 3, 4 });
+			graph.AddEdge({ 3, 0, 1 });
+			graph.Build();
+
+			assert(graph.GetOutgoingEdges(0).size() == 2);
+			assert(graph.GetOutgoingEdges(4).size() == 0);
+
+			DijkstraSearch search(graph);
+			assert(*search.Run(0, 2) == 1.5);
+			assert(search.GetPath(2) == std::vector<EdgeId>{ direct });
+			assert(*search.Run(0, 3) == 5.5);
+			assert(search.GetPath(3).size() == 2);
+			assert(*search.Run(3, 3) == 0);
+			assert(search.GetPath(3).empty());
+			assert(!search.Run(0, 4));
+			assert(*search.Run(1, 0) == 6); // buffers of the previous runs do not leak in
+			assert(search.GetPath(0).size() == 3);
+
+			assert((search.RunBounded(0, 1.5) == std::vector<VertexId>{ 0, 1, 2 }));
+			assert(search.GetWeight(2) == 1.5 && search.GetWeight(3) == numeric_limits<double>::infinity());
+			assert(search.GetPath(2) == std::vector<EdgeId>{ direct });
+			assert(search.RunBounded(0, 100).size() == 4);
+			assert((search.RunBounded(3, 0.5) == std::vector<VertexId>{ 3 }));
+			assert(*search.Run(0, 3) == 5.5); // bounded runs leave nothing behind either
+
+			search.RunToTargets(1, { 3, 2, 3 });
+			assert(search.GetWeight(2) == 1 && search.GetWeight(3) == 5 && search.GetWeight(4) == numeric_limits<double>::infinity());
+			search.RunToTargets(0, { 4 }); // unreachable, so everything is settled
+			assert(search.GetWeight(3) == 5.5 && search.GetWeight(4) == numeric_limits<double>::infinity());
+		}
+	}
+
+}
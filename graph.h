@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace transport::graph {
+
+	using VertexId = uint32_t;
+	using EdgeId = uint32_t;
+
+	struct Edge {
+		VertexId from;
+		VertexId to;
+		double weight;
+	};
+
+	// what a search reads for every relaxed edge; rows of these are contiguous per source vertex
+	struct OutgoingEdge {
+		VertexId to;
+		EdgeId id;
+		double weight;
+	};
+
+	struct OutgoingRange {
+		const OutgoingEdge* first;
+		const OutgoingEdge* last;
+
+		const OutgoingEdge* begin() const { return first; }
+		const OutgoingEdge* end() const { return last; }
+		size_t size() const { return last - first; }
+	};
+
+	// Edges are added one by one (ids in the order of addition), then Build lays them
+	// out as a CSR adjacency; the graph is not modified after that.
+	class DirectedWeightedGraph {
+	public:
+		DirectedWeightedGraph() = default;
+		explicit DirectedWeightedGraph(size_t vertex_count);
+
+		EdgeId AddEdge(const Edge& edge);
+		void Build();
+
+		size_t GetVertexCount() const;
+		size_t GetEdgeCount() const;
+		const Edge& GetEdge(EdgeId id) const;
+		OutgoingRange GetOutgoingEdges(VertexId from) const;
+
+	private:
+		size_t vertex_count_ = 0;
+		std::vector<Edge> edges_; // index: EdgeId
+		std::vector<uint32_t> offsets_; // vertex count + 1
+		std::vector<OutgoingEdge> outgoing_;
+	};
+
+	// Dijkstra search with buffers kept between runs; a run resets only what the previous one touched.
+	// One object serves one search at a time.
+	class DijkstraSearch {
+	public:
+		explicit DijkstraSearch(const DirectedWeightedGraph& graph);
+
+		// stops as soon as "to" is settled; nullopt if it is unreachable
+		std::optional<double> Run(VertexId from, VertexId to);
+		// edges of the path found by the last Run, from the start
+		std::vector<EdgeId> GetPath(VertexId to) const;
+
+		// one-to-all search that never goes past "limit": returns every vertex within it
+		// in the order of distance (valid until the next run), see GetWeight
+		const std::vector<VertexId>& RunBounded(VertexId from, double limit);
+		// one-to-many search that stops once every target is settled
+		void RunToTargets(VertexId from, const std::vector<VertexId>& targets);
+		// distance to the vertex found by the last run, infinity if it was not reached
+		double GetWeight(VertexId vertex) const;
+
+	private:
+		struct QueueItem {
+			double weight;
+			VertexId vertex;
+
+			bool operator>(const QueueItem& other) const {
+				return weight > other.weight;
+			}
+		};
+
+		static constexpr EdgeId NO_EDGE = ~EdgeId{ 0 };
+
+		void Reset();
+
+	private:
+		const DirectedWeightedGraph& graph_;
+		std::vector<double> weight_; // index: VertexId; infinity if not reached
+		std::vector<EdgeId> prev_edge_;
+		std::vector<VertexId> touched_;
+		std::vector<QueueItem> queue_; // binary min-heap
+		std::vector<VertexId> settled_; // by RunBounded
+		std::vector<uint32_t> target_stamp_; // index: VertexId; == stamp_ for a target of the current run
+		uint32_t stamp_ = 0;
+		VertexId source_ = 0;
+	};
+
+	namespace tests {
+		void TestDijkstraSearch();
+	}
+
+}
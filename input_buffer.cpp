@@ -0,0 +1,218 @@
+#include "input_buffer.h"
+
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace json {
+
+    namespace {
+        constexpr size_t READ_CHUNK = 1 << 20;
+
+#ifdef _WIN32
+        int OpenFile(const std::string& path) {
+            return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+        }
+        void CloseFile(int fd) {
+            _close(fd);
+        }
+        int StdinFile() {
+            return _fileno(stdin);
+        }
+#else
+        int OpenFile(const std::string& path) {
+            return open(path.c_str(), O_RDONLY);
+        }
+        void CloseFile(int fd) {
+            close(fd);
+        }
+        int StdinFile() {
+            return STDIN_FILENO;
+        }
+#endif
+    }
+
+    InputBuffer InputBuffer::FromFile(const std::string& path) {
+        const int fd = OpenFile(path);
+        if (fd < 0) {
+            throw InputError("cannot open "s + path);
+        }
+        InputBuffer buffer;
+        const bool mapped = buffer.Map(fd);
+        CloseFile(fd);
+        if (mapped) {
+            return buffer;
+        }
+
+        // an empty file, a device...
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) {
+            throw InputError("cannot open "s + path);
+        }
+        size_t size = 0;
+        do {
+            buffer.owned_.resize(size + READ_CHUNK);
+            size += fread(buffer.owned_.data() + size, 1, READ_CHUNK, file);
+        } while (size == buffer.owned_.size());
+        const bool failed = ferror(file);
+        fclose(file);
+        if (failed) {
+            throw InputError("cannot read "s + path);
+        }
+        buffer.owned_.resize(size);
+        return buffer;
+    }
+
+    InputBuffer InputBuffer::FromStdin() {
+        InputBuffer buffer;
+        if (buffer.Map(StdinFile())) {
+            return buffer;
+        }
+        return FromStream(std::cin);
+    }
+
+    InputBuffer InputBuffer::FromStream(std::istream& input) {
+        InputBuffer buffer;
+        size_t size = 0;
+        while (input) {
+            buffer.owned_.resize(size + READ_CHUNK);
+            input.read(buffer.owned_.data() + size, READ_CHUNK);
+            size += static_cast<size_t>(input.gcount());
+        }
+        if (input.bad()) {
+            throw InputError("cannot read the input"s);
+        }
+        buffer.owned_.resize(size);
+        return buffer;
+    }
+
+    InputBuffer::InputBuffer(InputBuffer&& other) noexcept {
+        *this = move(other);
+    }
+
+    InputBuffer& InputBuffer::operator=(InputBuffer&& other) noexcept {
+        if (this != &other) {
+            Unmap();
+            owned_ = move(other.owned_);
+            swap(data_, other.data_);
+            swap(size_, other.size_);
+        }
+        return *this;
+    }
+
+    InputBuffer::~InputBuffer() {
+        Unmap();
+    }
+
+    std::string_view InputBuffer::GetText() const {
+        return data_ ? std::string_view(data_, size_) : std::string_view(owned_);
+    }
+
+    bool InputBuffer::IsMapped() const {
+        return data_ != nullptr;
+    }
+
+    bool InputBuffer::Map(int fd) {
+#ifdef _WIN32
+        const HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        LARGE_INTEGER file_size;
+        if (file == INVALID_HANDLE_VALUE || GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &file_size)
+            || file_size.QuadPart == 0 || _telli64(fd) != 0) {
+            return false;
+        }
+        // the view keeps the mapping and the file open
+        const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            return false;
+        }
+        data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (!data_) {
+            return false;
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size == 0 || lseek(fd, 0, SEEK_CUR) != 0) {
+            return false;
+        }
+        void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        // read once, front to back
+        madvise(data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<size_t>(file_stat.st_size);
+#endif
+        return true;
+    }
+
+    void InputBuffer::Unmap() {
+        if (data_) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap(const_cast<char*>(data_), size_);
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    namespace tests {
+
+        void TestInputBuffer() {
+            const std::filesystem::path path = std::filesystem::temp_directory_path() / "transport_input_buffer_test.json";
+            const std::string text = "{\"base_requests\": [], \"stat_requests\": []}\n"s;
+            std::ofstream(path, std::ios::binary) << text;
+
+            InputBuffer mapped = InputBuffer::FromFile(path.string());
+            assert(mapped.IsMapped() && mapped.GetText() == text);
+
+            // moves hand the mapping over
+            InputBuffer moved = std::move(mapped);
+            assert(moved.GetText() == text && !mapped.IsMapped() && mapped.GetText().empty());
+
+            std::ofstream(path, std::ios::binary | std::ios::trunc);
+            const InputBuffer empty = InputBuffer::FromFile(path.string());
+            assert(!empty.IsMapped() && empty.GetText().empty());
+            std::filesystem::remove(path);
+
+            // longer than a read chunk
+            const std::string long_text(READ_CHUNK * 2 + 17, 'x');
+            std::istringstream input(long_text);
+            const InputBuffer read = InputBuffer::FromStream(input);
+            assert(!read.IsMapped() && read.GetText() == long_text);
+
+            bool thrown = false;
+            try {
+                InputBuffer::FromFile(path.string());
+            }
+            catch (const InputError&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+
+    }  // namespace tests
+
+}  // namespace json
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace json {
+
+    class InputError : public std::runtime_error {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+    // The whole input in one contiguous block, for json::Load(std::string_view): a file is
+    // memory-mapped, a pipe or a stream is read in bulk into an owned string.
+    class InputBuffer {
+    public:
+        static InputBuffer FromFile(const std::string& path);
+        // mapped when stdin is redirected from a regular file
+        static InputBuffer FromStdin();
+        static InputBuffer FromStream(std::istream& input);
+
+        InputBuffer(InputBuffer&& other) noexcept;
+        InputBuffer& operator=(InputBuffer&& other) noexcept;
+        InputBuffer(const InputBuffer&) = delete;
+        InputBuffer& operator=(const InputBuffer&) = delete;
+        ~InputBuffer();
+
+        std::string_view GetText() const;
+        bool IsMapped() const;
+
+    private:
+        InputBuffer() = default;
+
+        // false if fd cannot be mapped: not a regular file, empty, or not read from the start
+        bool Map(int fd);
+        void Unmap();
+
+    private:
+        std::string owned_;
+        const char* data_ = nullptr; // mapped view, if any
+        size_t size_ = 0;
+    };
+
+    namespace tests {
+        void TestInputBuffer();
+    }
+
+}  // namespace json
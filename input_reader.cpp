@@ -28,7 +28,7 @@ namespace transport::input {
 			if (command.first == "Stop") {
 				auto stop_info = ParseStopCommand(command.second);
 				string_view stopname = get<0>(stop_info);
-				catalogue.AddStop(string(stopname), { get<1>(stop_info), get<2>(stop_info) });
+				catalogue.AddStop(stopname, { get<1>(stop_info), get<2>(stop_info) });
 				stop_distances[catalogue.GetStop(stopname)->name] = std::move(get<3>(stop_info));
 			}
 			else if (command.first == "Bus") {
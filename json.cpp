@@ -1,5 +1,12 @@
 #include "json.h"
 
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <sstream>
+
 using namespace std;
 
 namespace json {
@@ -186,7 +193,7 @@ namespace json {
 
                 string key = LoadString(input);
                 input >> c;
-                result.insert({ move(key), LoadNode(input) });
+                result.emplace(key, LoadNode(input));
             }
 
             if (c != '}') {
@@ -310,9 +317,13 @@ namespace json {
         }
     }
 
-    const std::string& Node::AsString() const {
+    Node::Node(const std::string& value)
+        : Value(std::pmr::string(value)) {
+    }
+
+    const std::pmr::string& Node::AsString() const {
         try {
-            return get<std::string>(*this);
+            return get<std::pmr::string>(*this);
         }
         catch (const bad_variant_access&) {
             throw std::logic_error("wrong type");
@@ -328,6 +339,105 @@ namespace json {
         }
     }
 
+    namespace {
+
+        // calls visit(i) for the indexes of items in key order, skipping all but the first of equal keys
+        template <typename Item, typename Visit>
+        void VisitInKeyOrder(const Item* items, size_t count, Visit visit) {
+            // the order is sorted rather than the items, which are slower to move than indexes
+            constexpr size_t STACK_COUNT = 32;
+            uint32_t stack_order[STACK_COUNT];
+            std::vector<uint32_t> heap_order;
+            uint32_t* order = stack_order;
+            if (count > STACK_COUNT) {
+                heap_order.resize(count);
+                order = heap_order.data();
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                order[i] = i;
+            }
+            const auto key_less = [items](uint32_t lhs, uint32_t rhs) {
+                return items[lhs].first < items[rhs].first;
+            };
+            if (count <= STACK_COUNT) {
+                for (size_t i = 1; i < count; ++i) {
+                    const uint32_t index = order[i];
+                    size_t j = i;
+                    for (; j > 0 && key_less(index, order[j - 1]); --j) {
+                        order[j] = order[j - 1];
+                    }
+                    order[j] = index;
+                }
+            }
+            else {
+                std::stable_sort(order, order + count, key_less);
+            }
+            // all compared before the first visit, which may move the item out
+            size_t unique = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (unique == 0 || items[order[unique - 1]].first != items[order[i]].first) {
+                    order[unique++] = order[i];
+                }
+            }
+            for (size_t i = 0; i < unique; ++i) {
+                visit(order[i]);
+            }
+        }
+
+    }  // namespace
+
+    Dict::Dict(std::pmr::memory_resource* resource)
+        : items_(resource) {
+    }
+
+    Dict::Dict(std::initializer_list<std::pair<std::string_view, Node>> items) {
+        items_.reserve(items.size());
+        VisitInKeyOrder(items.begin(), items.size(), [this, &items](uint32_t i) {
+            items_.emplace_back(items.begin()[i].first, items.begin()[i].second);
+            });
+    }
+
+    Dict Dict::MoveFrom(std::vector<value_type>& fields, std::pmr::memory_resource* resource) {
+        Dict result(resource);
+        result.items_.reserve(fields.size());
+        VisitInKeyOrder(fields.data(), fields.size(), [&result, &fields](uint32_t i) {
+            result.items_.push_back(move(fields[i]));
+            });
+        fields.clear();
+        return result;
+    }
+
+    const Node& Dict::at(std::string_view key) const {
+        const auto it = find(key);
+        if (it == items_.end()) {
+            throw std::out_of_range("no key " + std::string(key));
+        }
+        return it->second;
+    }
+
+    std::pair<Dict::const_iterator, bool> Dict::emplace(std::string_view key, Node value) {
+        const auto it = LowerBound(key);
+        if (it != items_.end() && it->first == key) {
+            return { it, false };
+        }
+        return { items_.emplace(it, key, move(value)), true };
+    }
+
+    size_t Dict::erase(std::string_view key) {
+        const auto it = LowerBound(key);
+        if (it == items_.end() || it->first != key) {
+            return 0;
+        }
+        items_.erase(it);
+        return 1;
+    }
+
+    std::pmr::vector<Dict::value_type>::iterator Dict::LowerBound(std::string_view key) {
+        return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+            return std::string_view(item.first) < key;
+            });
+    }
+
     const Dict& Node::AsMap() const {
         try {
             return get<Dict>(*this);
@@ -341,6 +451,19 @@ namespace json {
         : root_(move(root)) {
     }
 
+    Document::Document(std::unique_ptr<std::pmr::monotonic_buffer_resource> arena, Node root)
+        : arena_(move(arena))
+        , root_(move(root)) {
+    }
+
+    Document::~Document() {
+        if (arena_) {
+            // the tree is moved, keeping its arena allocations, to a node in the arena that is never
+            // destroyed: the empty root left is destroyed at once, and the arena frees the rest
+            new (arena_->allocate(sizeof(Node), alignof(Node))) Node(move(root_));
+        }
+    }
+
     const Node& Document::GetRoot() const {
         return root_;
     }
@@ -349,154 +472,673 @@ namespace json {
         return Document{ LoadNode(input) };
     }
 
-    // ---Print functions:
-    // Контекст вывода, хранит ссылку на поток вывода и текущий отсуп
-    struct PrintContext {
-        std::ostream& out;
-        int indent_step = 4;
-        int indent = 0;
+    namespace detail {
 
-        void PrintIndent() const {
-            for (int i = 0; i < indent; ++i) {
-                out.put(' ');
-            }
+        TextScanner::TextScanner(std::string_view text)
+            : pos_(text.data()), end_(text.data() + text.size()) {
         }
 
-        // Возвращает новый контекст вывода с увеличенным смещением
-        PrintContext Indented() const {
-            return { out, indent_step, indent_step + indent };
+        char TextScanner::Peek() {
+            // the characters operator>> skips
+            while (pos_ != end_ && (*pos_ == ' ' || (*pos_ >= '\t' && *pos_ <= '\r'))) {
+                ++pos_;
+            }
+            return pos_ != end_ ? *pos_ : '\0';
         }
-    };
-    //void PrintValue(const Dict& value, std::ostream& out);
-    // Шаблон, подходящий для вывода double и int
-    // binary '<<': no operator found which takes a right - hand operand of type 'const Value' (or there is no acceptable conversion)
-    template <typename Value>
-    void PrintValue(const Value& value, const PrintContext& ctx) {
-        ctx.PrintIndent();
-        ctx.out << value;
-    }
 
-    // Перегрузка функции PrintValue для вывода значений null
-    void PrintValue(std::nullptr_t, const PrintContext& ctx) {
-        ctx.PrintIndent();
-        ctx.out << "null"sv;
-    }
-
-    void PrintValue(bool value, const PrintContext& ctx) {
-        ctx.PrintIndent();
-        ctx.out << std::boolalpha << value;
-    }
-
-    void PrintValue(const std::string& value, const PrintContext& ctx) {
-
-        ctx.PrintIndent();
-        ctx.out << "\"";
-
-        auto it = value.begin();
-        auto end = value.end();
-
-        while (true) {
+        void TextScanner::Skip() {
+            ++pos_;
+        }
 
-            if (it == end) break;
+        bool TextScanner::AtEnd() {
+            Peek();
+            return pos_ == end_;
+        }
 
-            const char ch = *it;
-            if (ch == '\n' || /*ch == '\t' ||*/ ch == '\r' || ch == '"' || ch == '\\') {
-                // Встретили символ для экранирования
-                ctx.out << '\\';
+        void TextScanner::ExpectWord(std::string_view word, const char* error) {
+            if (static_cast<size_t>(end_ - pos_) < word.size() || std::string_view(pos_, word.size()) != word) {
+                throw ParsingError(error);
+            }
+            pos_ += word.size();
+        }
 
-                // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
-                switch (ch) {
-                case '\n':
-                    ctx.out << 'n';
+        std::string_view TextScanner::ReadString(std::string& scratch) {
+            bool escaped = false;
+            while (true) {
+                // a run of plain characters is taken at once
+                const char* run = pos_;
+                while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\' && *pos_ != '\n' && *pos_ != '\r') {
+                    ++pos_;
+                }
+                if (pos_ == end_) {
+                    throw ParsingError("String parsing error");
+                }
+                const char ch = *pos_++;
+                if (ch == '"' && !escaped) {
+                    return std::string_view(run, pos_ - 1 - run);
+                }
+                if (!escaped) {
+                    scratch.clear();
+                    escaped = true;
+                }
+                scratch.append(run, pos_ - 1);
+                if (ch == '"') {
+                    return scratch;
+                }
+                if (ch != '\\') {
+                    throw ParsingError("Unexpected end of line"s);
+                }
+                if (pos_ == end_) {
+                    throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *pos_++;
+                switch (escaped_char) {
+                case 'n':
+                    scratch.push_back('\n');
                     break;
-                case '\t':
-                    ctx.out << 't';
+                case 't':
+                    scratch.push_back('\t');
                     break;
-                case '\r':
-                    ctx.out << 'r';
+                case 'r':
+                    scratch.push_back('\r');
                     break;
                 case '"':
-                    ctx.out << '"';
+                    scratch.push_back('"');
                     break;
                 case '\\':
-                    ctx.out << '\\';
+                    scratch.push_back('\\');
                     break;
+                default:
+                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+            }
+        }
+
+        Number TextScanner::ReadNumber() {
+            const char* begin = pos_;
+            const auto read_digits = [this] {
+                if (pos_ == end_ || !std::isdigit(static_cast<unsigned char>(*pos_))) {
+                    throw ParsingError("A digit is expected"s);
                 }
+                while (pos_ != end_ && std::isdigit(static_cast<unsigned char>(*pos_))) {
+                    ++pos_;
+                }
+            };
+
+            if (*pos_ == '-') {
+                ++pos_;
+            }
+            if (pos_ != end_ && *pos_ == '0') {
+                ++pos_;
             }
             else {
-                ctx.out << ch;
+                read_digits();
             }
-            ++it;
+
+            bool is_int = true;
+            if (pos_ != end_ && *pos_ == '.') {
+                ++pos_;
+                read_digits();
+                is_int = false;
+            }
+            if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+                ++pos_;
+                if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+                    ++pos_;
+                }
+                read_digits();
+                is_int = false;
+            }
+
+            if (is_int) {
+                int value;
+                if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_) {
+                    return value;
+                }
+                // out of the int range: a double, as with the stream loader
+            }
+            double value;
+            if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec != std::errc{} || ptr != pos_) {
+                throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+            }
+            return value;
+        }
+
+        void ObjectStack::Push() {
+            if (levels_.size() == depth_) {
+                levels_.emplace_back();
+            }
+            levels_[depth_++].clear();
         }
-        ctx.out << "\"";
+
+        void ObjectStack::Add(std::pmr::string key, Node value) {
+            levels_[depth_ - 1].emplace_back(move(key), move(value));
+        }
+
+        Dict ObjectStack::Pop(std::pmr::memory_resource* resource) {
+            return Dict::MoveFrom(levels_[--depth_], resource);
+        }
+
+        void ArrayStack::Push() {
+            if (levels_.size() == depth_) {
+                levels_.emplace_back();
+            }
+            levels_[depth_++].clear();
+        }
+
+        void ArrayStack::Add(Node value) {
+            levels_[depth_ - 1].push_back(move(value));
+        }
+
+        Array ArrayStack::Pop(std::pmr::memory_resource* resource) {
+            std::vector<Node>& elements = levels_[--depth_];
+            Array result(resource);
+            result.reserve(elements.size());
+            result.insert(result.end(), std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+            elements.clear();
+            return result;
+        }
+
+    }  // namespace detail
+
+    namespace {
+
+        Node NumberNode(Number number) {
+            if (const int* value = std::get_if<int>(&number)) {
+                return Node{ *value };
+            }
+            return Node{ std::get<double>(number) };
+        }
+
+        // Same grammar and same nodes as the stream loader above, over a contiguous buffer
+        class BufferParser {
+        public:
+            BufferParser(std::string_view text, std::pmr::memory_resource* resource)
+                : scanner_(text)
+                , resource_(resource) {
+            }
+
+            Node ParseDocument() {
+                Node root = ParseNode();
+                if (!scanner_.AtEnd()) {
+                    throw ParsingError("Unexpected data after the document"s);
+                }
+                return root;
+            }
+
+        private:
+            Node ParseNode() {
+                const char c = scanner_.Peek();
+                if (c == '[') {
+                    scanner_.Skip();
+                    return ParseArray();
+                }
+                else if (c == '{') {
+                    scanner_.Skip();
+                    return ParseDict();
+                }
+                else if (c == '"') {
+                    scanner_.Skip();
+                    return Node{ std::pmr::string(scanner_.ReadString(scratch_), resource_) };
+                }
+                else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+                    return NumberNode(scanner_.ReadNumber());
+                }
+                else if (c == ']') {
+                    throw ParsingError("Unexpected end of array"s);
+                }
+                else if (c == '}') {
+                    throw ParsingError("Unexpected end of dictionary"s);
+                }
+                else if (c == 't') {
+                    scanner_.ExpectWord("true"sv, "Boolean parsing error");
+                    return Node{ true };
+                }
+                else if (c == 'f') {
+                    scanner_.ExpectWord("false"sv, "Boolean parsing error");
+                    return Node{ false };
+                }
+                scanner_.ExpectWord("null"sv, "null parsing error");
+                return Node{};
+            }
+
+            Node ParseArray() {
+                if (scanner_.Peek() == ']') {
+                    scanner_.Skip();
+                    return Node(Array(resource_));
+                }
+                arrays_.Push();
+                while (true) {
+                    arrays_.Add(ParseNode());
+                    const char c = scanner_.Peek();
+                    scanner_.Skip();
+                    if (c == ']') {
+                        break;
+                    }
+                    if (c != ',') {
+                        throw ParsingError("Unexpected end of array"s);
+                    }
+                }
+                return Node(arrays_.Pop(resource_));
+            }
+
+            Node ParseDict() {
+                if (scanner_.Peek() == '}') {
+                    scanner_.Skip();
+                    return Node(Dict(resource_));
+                }
+                objects_.Push();
+                while (true) {
+                    if (scanner_.Peek() != '"') {
+                        throw ParsingError("Unexpected end of dictionary"s);
+                    }
+                    scanner_.Skip();
+                    std::pmr::string key(scanner_.ReadString(scratch_), resource_);
+                    if (scanner_.Peek() != ':') {
+                        throw ParsingError("Unexpected end of dictionary"s);
+                    }
+                    scanner_.Skip();
+                    // the first of repeated keys wins, as with the stream loader
+                    Node value = ParseNode();
+                    objects_.Add(move(key), move(value));
+                    const char c = scanner_.Peek();
+                    scanner_.Skip();
+                    if (c == '}') {
+                        break;
+                    }
+                    if (c != ',') {
+                        throw ParsingError("Unexpected end of dictionary"s);
+                    }
+                }
+                return Node(objects_.Pop(resource_));
+            }
+
+        private:
+            detail::TextScanner scanner_;
+            std::pmr::memory_resource* resource_; // of every string and container of the tree
+            std::string scratch_; // escaped strings
+            detail::ObjectStack objects_;
+            detail::ArrayStack arrays_;
+        };
+
+    }  // namespace
+
+    Document Load(std::string_view text, Allocation allocation) {
+        if (allocation == Allocation::ARENA) {
+            // the tree takes a few times the size of the text: blocks grow from there
+            auto arena = std::make_unique<std::pmr::monotonic_buffer_resource>(text.size());
+            Node root = BufferParser(text, arena.get()).ParseDocument();
+            return Document{ move(arena), move(root) };
+        }
+        return Document{ BufferParser(text, std::pmr::get_default_resource()).ParseDocument() };
     }
 
-    void PrintValue(const Array& value, const PrintContext& ctx) {
-        ctx.PrintIndent();
-        ctx.out << "["sv;
-        bool first = true;
-        for (const auto& element : value) {
-            if (!first) {
-                ctx.out << ", "sv;
+    EventReader::EventReader(std::string_view text)
+        : scanner_(text) {
+    }
+
+    Event EventReader::Next() {
+        while (true) {
+            switch (state_) {
+            case State::DONE:
+                return Event::END;
+
+            case State::AFTER_VALUE: {
+                if (containers_.empty()) {
+                    if (!scanner_.AtEnd()) {
+                        throw ParsingError("Unexpected data after the document"s);
+                    }
+                    state_ = State::DONE;
+                    return Event::END;
+                }
+                const bool in_object = containers_.back() == '{';
+                const char c = scanner_.Peek();
+                scanner_.Skip();
+                if (c == ',') {
+                    state_ = in_object ? State::KEY : State::VALUE;
+                    continue;
+                }
+                if (c == (in_object ? '}' : ']')) {
+                    containers_.pop_back();
+                    return in_object ? Event::END_OBJECT : Event::END_ARRAY;
+                }
+                throw ParsingError(in_object ? "Unexpected end of dictionary"s : "Unexpected end of array"s);
+            }
+
+            case State::FIRST_VALUE:
+                if (scanner_.Peek() == ']') {
+                    scanner_.Skip();
+                    containers_.pop_back();
+                    state_ = State::AFTER_VALUE;
+                    return Event::END_ARRAY;
+                }
+                return ReadValue();
+
+            case State::FIRST_KEY:
+                if (scanner_.Peek() == '}') {
+                    scanner_.Skip();
+                    containers_.pop_back();
+                    state_ = State::AFTER_VALUE;
+                    return Event::END_OBJECT;
+                }
+                [[fallthrough]];
+
+            case State::KEY:
+                if (scanner_.Peek() != '"') {
+                    throw ParsingError("Unexpected end of dictionary"s);
+                }
+                scanner_.Skip();
+                string_ = scanner_.ReadString(scratch_);
+                if (scanner_.Peek() != ':') {
+                    throw ParsingError("Unexpected end of dictionary"s);
+                }
+                scanner_.Skip();
+                state_ = State::VALUE;
+                return Event::KEY;
+
+            default:
+                return ReadValue();
             }
-            first = false;
-            ctx.out << '\n';
-            std::visit(
-                [&ctx](const auto& value) { PrintValue(value, ctx.Indented()); },
-                element.GetValue());
         }
-        ctx.out << '\n';
-        ctx.PrintIndent();
-        ctx.out << "]"sv;
     }
 
-    void PrintValue(const Dict& value, const PrintContext& ctx) {
-        ctx.PrintIndent();
-        ctx.out << "{"sv;
-        bool first = true;
-        for (const auto& pair : value) {
-            if (!first) {
-                ctx.out << ", "sv;
+    Event EventReader::ReadValue() {
+        const char c = scanner_.Peek();
+        state_ = State::AFTER_VALUE;
+        if (c == '[' || c == '{') {
+            scanner_.Skip();
+            containers_.push_back(c);
+            state_ = c == '[' ? State::FIRST_VALUE : State::FIRST_KEY;
+            return c == '[' ? Event::START_ARRAY : Event::START_OBJECT;
+        }
+        else if (c == '"') {
+            scanner_.Skip();
+            string_ = scanner_.ReadString(scratch_);
+            return Event::STRING;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+            number_ = scanner_.ReadNumber();
+            return std::holds_alternative<int>(number_) ? Event::INT : Event::DOUBLE;
+        }
+        else if (c == ']') {
+            throw ParsingError("Unexpected end of array"s);
+        }
+        else if (c == '}') {
+            throw ParsingError("Unexpected end of dictionary"s);
+        }
+        else if (c == 't') {
+            scanner_.ExpectWord("true"sv, "Boolean parsing error");
+            bool_ = true;
+            return Event::BOOL;
+        }
+        else if (c == 'f') {
+            scanner_.ExpectWord("false"sv, "Boolean parsing error");
+            bool_ = false;
+            return Event::BOOL;
+        }
+        scanner_.ExpectWord("null"sv, "null parsing error");
+        return Event::NULL_VALUE;
+    }
+
+    std::string_view EventReader::GetString() const {
+        return string_;
+    }
+
+    int EventReader::GetInt() const {
+        return std::get<int>(number_);
+    }
+
+    double EventReader::GetDouble() const {
+        const int* value = std::get_if<int>(&number_);
+        return value ? *value : std::get<double>(number_);
+    }
+
+    bool EventReader::GetBool() const {
+        return bool_;
+    }
+
+    size_t EventReader::GetDepth() const {
+        return containers_.size();
+    }
+
+    void EventReader::SkipValue() {
+        const size_t depth = GetDepth();
+        Next();
+        while (GetDepth() > depth) {
+            Next();
+        }
+    }
+
+    Node EventReader::ReadNode() {
+        return ReadNode(Next());
+    }
+
+    Node EventReader::ReadNode(Event first) {
+        switch (first) {
+        case Event::START_ARRAY: {
+            arrays_.Push();
+            for (Event event = Next(); event != Event::END_ARRAY; event = Next()) {
+                arrays_.Add(ReadNode(event));
+            }
+            return Node(arrays_.Pop(std::pmr::get_default_resource()));
+        }
+        case Event::START_OBJECT: {
+            objects_.Push();
+            for (Event event = Next(); event != Event::END_OBJECT; event = Next()) {
+                std::pmr::string key(string_);
+                Node value = ReadNode();
+                objects_.Add(move(key), move(value));
             }
-            first = false;
-            ctx.out << '\n';
-            PrintValue(pair.first, ctx.Indented());
-            ctx.out << ": ";
+            return Node(objects_.Pop(std::pmr::get_default_resource()));
+        }
+        case Event::STRING:
+            return Node{ std::pmr::string(string_) };
+        case Event::INT:
+        case Event::DOUBLE:
+            return NumberNode(number_);
+        case Event::BOOL:
+            return Node{ bool_ };
+        case Event::NULL_VALUE:
+            return Node{};
+        default:
+            throw ParsingError("A value is expected"s);
+        }
+    }
+
+    void Parse(std::string_view text, EventHandler& handler) {
+        EventReader reader(text);
+        for (Event event = reader.Next(); event != Event::END; event = reader.Next()) {
+            switch (event) {
+            case Event::START_OBJECT:
+                handler.StartObject();
+                break;
+            case Event::END_OBJECT:
+                handler.EndObject();
+                break;
+            case Event::START_ARRAY:
+                handler.StartArray();
+                break;
+            case Event::END_ARRAY:
+                handler.EndArray();
+                break;
+            case Event::KEY:
+                handler.Key(reader.GetString());
+                break;
+            case Event::STRING:
+                handler.String(reader.GetString());
+                break;
+            case Event::INT:
+                handler.Int(reader.GetInt());
+                break;
+            case Event::DOUBLE:
+                handler.Double(reader.GetDouble());
+                break;
+            case Event::BOOL:
+                handler.Bool(reader.GetBool());
+                break;
+            default:
+                handler.Null();
+                break;
+            }
+        }
+    }
+
+    // ---Print functions:
+    namespace {
+
+        constexpr size_t INDENT_STEP = 4;
+        // the buffer goes to the stream once it holds this much
+        constexpr size_t WRITER_CHUNK = 64 * 1024;
 
-            if (pair.second.IsArray()) {
-                std::visit(
-                    [&ctx](const auto& value) { PrintValue(value, ctx.Indented()); },
-                    pair.second.GetValue());
+        template <typename Number>
+        void AppendNumber(std::string& buffer, Number value) {
+            char digits[32];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            buffer.append(digits, result.ptr);
+        }
+
+        // the 6 significant digits of the stream default, which the pretty layout has always printed
+        void AppendStreamDouble(std::string& buffer, double value) {
+            char digits[32];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+            buffer.append(digits, result.ptr);
+        }
+
+    }  // namespace
+
+    Writer::Writer(std::ostream& output, Layout layout)
+        : output_(output)
+        , pretty_(layout == Layout::PRETTY) {
+        buffer_.reserve(WRITER_CHUNK + WRITER_CHUNK / 4);
+    }
+
+    Writer::~Writer() {
+        Flush();
+    }
+
+    void Writer::Write(const Node& node) {
+        WriteValue(node, 0);
+    }
+
+    void Writer::StartArray() {
+        buffer_ += '[';
+        first_element_ = true;
+    }
+
+    void Writer::AddElement(const Node& element) {
+        StartItem(first_element_);
+        WriteValue(element, INDENT_STEP);
+    }
+
+    void Writer::EndArray() {
+        EndContainer(']', 0);
+    }
+
+    void Writer::Flush() {
+        output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    void Writer::WriteValue(const Node& node, size_t indent) {
+        if (buffer_.size() >= WRITER_CHUNK) {
+            Flush();
+        }
+        if (pretty_) {
+            buffer_.append(indent, ' ');
+        }
+        const Value& value = node.GetValue();
+        if (const auto* dict = std::get_if<Dict>(&value)) {
+            WriteDict(*dict, indent);
+        }
+        else if (const auto* array = std::get_if<Array>(&value)) {
+            WriteArray(*array, indent);
+        }
+        else if (const auto* text = std::get_if<std::pmr::string>(&value)) {
+            WriteString(*text);
+        }
+        else if (const auto* integer = std::get_if<int>(&value)) {
+            AppendNumber(buffer_, *integer);
+        }
+        else if (const auto* real = std::get_if<double>(&value)) {
+            if (pretty_) {
+                AppendStreamDouble(buffer_, *real);
             }
             else {
-                std::visit(
-                    [&ctx](const auto& value) { PrintValue(value, { ctx.out }); },
-                    pair.second.GetValue());
+                AppendNumber(buffer_, *real);
             }
+        }
+        else if (const auto* boolean = std::get_if<bool>(&value)) {
+            buffer_ += *boolean ? "true"sv : "false"sv;
+        }
+        else {
+            buffer_ += "null"sv;
+        }
+    }
 
+    void Writer::WriteArray(const Array& array, size_t indent) {
+        buffer_ += '[';
+        bool first = true;
+        for (const Node& element : array) {
+            StartItem(first);
+            WriteValue(element, indent + INDENT_STEP);
         }
-        ctx.out << '\n';
-        ctx.PrintIndent();
-        ctx.out << "}"sv;
+        EndContainer(']', indent);
     }
 
-    std::ostream& operator<<(std::ostream& out, const Dict& dict) {
-        PrintValue(dict, PrintContext{ out });
-        return out;
+    void Writer::WriteDict(const Dict& dict, size_t indent) {
+        buffer_ += '{';
+        bool first = true;
+        for (const auto& [key, value] : dict) {
+            StartItem(first);
+            if (pretty_) {
+                buffer_.append(indent + INDENT_STEP, ' ');
+            }
+            WriteString(key);
+            buffer_ += pretty_ ? ": "sv : ":"sv;
+            // the pretty layout as it always was: an array goes one step deeper, anything else from column 0
+            WriteValue(value, value.IsArray() ? indent + INDENT_STEP : 0);
+        }
+        EndContainer('}', indent);
     }
 
-    void PrintNode(const Node& node, std::ostream& out) {
-        PrintContext ctx{ out };
-        std::visit(
-            [&ctx](const auto& value) { PrintValue(value, ctx); },
-            node.GetValue());
+    void Writer::WriteString(std::string_view text) {
+        buffer_ += '"';
+        const char* run = text.data();
+        const char* const end = run + text.size();
+        for (const char* pos = run; pos != end; ++pos) {
+            const char ch = *pos;
+            if (ch == '\n' || ch == '\r' || ch == '"' || ch == '\\') {
+                buffer_.append(run, pos);
+                buffer_ += '\\';
+                buffer_ += ch == '\n' ? 'n' : ch == '\r' ? 'r' : ch;
+                run = pos + 1;
+            }
+        }
+        buffer_.append(run, end);
+        buffer_ += '"';
     }
 
-    void Print(const Document& doc, std::ostream& output) {
+    void Writer::StartItem(bool& first) {
+        if (pretty_) {
+            buffer_ += first ? "\n"sv : ", \n"sv;
+        }
+        else if (!first) {
+            buffer_ += ',';
+        }
+        first = false;
+    }
 
-        const auto& root = doc.GetRoot();
-        PrintNode(root, output);
+    void Writer::EndContainer(char bracket, size_t indent) {
+        if (pretty_) {
+            buffer_ += '\n';
+            buffer_.append(indent, ' ');
+        }
+        buffer_ += bracket;
+    }
 
+    void Print(const Document& doc, std::ostream& output, Layout layout) {
+        Writer writer(output, layout);
+        writer.Write(doc.GetRoot());
     }
 
 
@@ -515,7 +1157,7 @@ namespace json {
         return holds_alternative<bool>(*this);
     }
     bool Node::IsString() const {
-        return holds_alternative<std::string>(*this);
+        return holds_alternative<std::pmr::string>(*this);
     }
     bool Node::IsNull() const {
         return holds_alternative<std::nullptr_t>(*this);
@@ -528,4 +1170,423 @@ namespace json {
     }
 
 
+    namespace tests {
+
+        void TestLoadBuffer() {
+            const auto same_as_stream = [](const std::string& text) {
+                std::istringstream input(text);
+                return Load(input) == Load(std::string_view(text));
+            };
+
+            assert(same_as_stream("null"s));
+            assert(same_as_stream(" \t\r\n[ ]"s));
+            assert(same_as_stream("{}"s));
+            assert(same_as_stream("[1, -0, 0.5, -2.5e-3, 1E+2, 2147483647, -2147483648, 2147483648, 1e308]"s));
+            assert(same_as_stream("[true, false, null, \"\", \"a\\\"b\\\\c\\nd\\te\\r\"]"s));
+            assert(same_as_stream("{\"key\": {\"nested\": [1, {\"x\": \"y\"}]}, \"b\": false}"s));
+            assert(same_as_stream("{\"same\": 1, \"same\": 2}"s)); // the first wins
+            assert(same_as_stream("\"\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0\""s));
+
+            const Node numbers = Load("[2147483647, 2147483648, 0.1]"sv).GetRoot();
+            assert(numbers.AsArray()[0].IsInt() && numbers.AsArray()[0].AsInt() == 2147483647);
+            assert(numbers.AsArray()[1].IsPureDouble() && numbers.AsArray()[1].AsDouble() == 2147483648.);
+            assert(numbers.AsArray()[2].AsDouble() == 0.1);
+
+            for (const std::string_view broken : { "["sv, "[1"sv, "[1 2]"sv, "{\"a\" 1}"sv, "{1: 2}"sv, "\"abc"sv,
+                "\"a\nb\""sv, "\"\\x\""sv, "tru"sv, "nul"sv, "-"sv, "1."sv, "1e"sv, "1e999"sv, "]"sv, "{} x"sv, ""sv }) {
+                bool thrown = false;
+                try {
+                    Load(broken);
+                }
+                catch (const ParsingError&) {
+                    thrown = true;
+                }
+                assert(thrown);
+            }
+        }
+
+        void TestDict() {
+            // key order and the first of repeated keys, as std::map kept them
+            const Dict small{ { "type"s, "Bus"s }, { "id"s, 1 }, { "name"s, "14"s }, { "id"s, 2 } };
+            std::vector<std::string> keys;
+            for (const auto& [key, value] : small) {
+                keys.emplace_back(key);
+            }
+            assert(keys == (std::vector<std::string>{ "id", "name", "type" }));
+            assert(small.at("id").AsInt() == 1 && small.count("name") == 1 && small.count("nam") == 0);
+            assert(small.find("radius") == small.end());
+            bool thrown = false;
+            try {
+                small.at("radius");
+            }
+            catch (const std::out_of_range&) {
+                thrown = true;
+            }
+            assert(thrown);
+
+            Dict answer = small;
+            assert(answer == small);
+            assert(answer.emplace("request_id"s, 5).second && !answer.emplace("id"s, 7).second);
+            assert(answer.at("request_id").AsInt() == 5 && answer.at("id").AsInt() == 1);
+            assert(answer.erase("request_id") == 1 && answer.erase("request_id") == 0 && answer == small);
+
+            // past the scan and the stack order: binary search and stable_sort
+            std::ostringstream text;
+            text << '{';
+            for (int i = 99; i >= 0; --i) {
+                text << "\"k" << i % 50 << "\": " << i << (i ? ", " : "}");
+            }
+            const Dict big = Load(text.str()).GetRoot().AsMap();
+            assert(big.size() == 50 && std::is_sorted(big.begin(), big.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+                }));
+            for (int i = 0; i < 50; ++i) {
+                assert(big.at("k" + std::to_string(i)).AsInt() == i + 50);
+            }
+            std::istringstream stream(text.str());
+            assert(Load(stream).GetRoot().AsMap() == big);
+        }
+
+        void TestEventReader() {
+            EventReader reader("{\"a\": [1, 2.5, \"x\\ty\"], \"b\": {}, \"c\": [true, null]}"sv);
+            const std::vector<Event> expected{ Event::START_OBJECT, Event::KEY, Event::START_ARRAY, Event::INT, Event::DOUBLE, Event::STRING,
+                Event::END_ARRAY, Event::KEY, Event::START_OBJECT, Event::END_OBJECT, Event::KEY, Event::START_ARRAY, Event::BOOL,
+                Event::NULL_VALUE, Event::END_ARRAY, Event::END_OBJECT, Event::END, Event::END };
+            std::vector<std::string> strings;
+            for (Event event : expected) {
+                assert(reader.Next() == event);
+                if (event == Event::KEY || event == Event::STRING) {
+                    strings.emplace_back(reader.GetString());
+                }
+                if (event == Event::INT) {
+                    assert(reader.GetInt() == 1 && reader.GetDepth() == 2);
+                }
+                if (event == Event::DOUBLE) {
+                    assert(reader.GetDouble() == 2.5);
+                }
+                if (event == Event::BOOL) {
+                    assert(reader.GetBool());
+                }
+            }
+            assert(strings == (std::vector<std::string>{ "a", "x\ty", "b", "c" }));
+
+            // nodes built from events are the nodes Load builds
+            for (const std::string_view text : { "[]"sv, " 7 "sv, "{\"k\": [1, {\"n\": null}], \"k\": 2, \"e\": \"\\\"\"}"sv, "[[], [[-1e3]], {}]"sv }) {
+                EventReader node_reader(text);
+                assert(node_reader.ReadNode() == Load(text).GetRoot());
+                assert(node_reader.Next() == Event::END);
+            }
+
+            // a part of the document as a node, the rest as events
+            EventReader partial("[{\"id\": 1}, {\"id\": 2}]"sv);
+            assert(partial.Next() == Event::START_ARRAY);
+            int ids = 0;
+            for (Event event = partial.Next(); event != Event::END_ARRAY; event = partial.Next()) {
+                ids += partial.ReadNode(event).AsMap().at("id").AsInt();
+            }
+            assert(ids == 3 && partial.Next() == Event::END);
+
+            // skipped values leave the reader on the next key
+            EventReader skipping("{\"a\": [1, {\"b\": [2]}], \"c\": 3, \"d\": {}}"sv);
+            assert(skipping.Next() == Event::START_OBJECT && skipping.Next() == Event::KEY);
+            skipping.SkipValue();
+            assert(skipping.Next() == Event::KEY && skipping.GetString() == "c"sv);
+            skipping.SkipValue();
+            assert(skipping.Next() == Event::KEY && skipping.GetString() == "d"sv);
+            skipping.SkipValue();
+            assert(skipping.Next() == Event::END_OBJECT && skipping.Next() == Event::END);
+
+            // push interface
+            struct Recorder : EventHandler {
+                std::string events;
+                void StartObject() override { events += '{'; }
+                void EndObject() override { events += '}'; }
+                void StartArray() override { events += '['; }
+                void EndArray() override { events += ']'; }
+                void Key(std::string_view key) override { events.append(key).append(":"); }
+                void String(std::string_view value) override { events.append("'").append(value).append("'"); }
+                void Int(int value) override { events += std::to_string(value); }
+                void Double(double) override { events += 'd'; }
+                void Bool(bool value) override { events += value ? 'T' : 'F'; }
+                void Null() override { events += 'N'; }
+            } recorder;
+            Parse("{\"a\": [1, 0.5, false], \"b\": \"s\", \"c\": null}"sv, recorder);
+            assert(recorder.events == "{a:[1dF]b:'s'c:N}");
+
+            for (const std::string_view broken : { "[1 2]"sv, "{\"a\" 1}"sv, "{1: 2}"sv, "[1,]"sv, "{\"a\": 1,}"sv, "[}"sv, "{]"sv, "[] []"sv, ""sv }) {
+                bool thrown = false;
+                try {
+                    EventReader broken_reader(broken);
+                    while (broken_reader.Next() != Event::END) {
+                    }
+                }
+                catch (const ParsingError&) {
+                    thrown = true;
+                }
+                assert(thrown);
+            }
+        }
+
+        namespace {
+
+            // base requests of a big city, ~30 MB
+            std::string MakeBaseRequests() {
+                std::ostringstream out;
+                out << "{\"base_requests\": [";
+                constexpr int STOPS = 200000;
+                for (int i = 0; i < STOPS; ++i) {
+                    out << (i ? ", " : "") << "{\"type\": \"Stop\", \"name\": \"Stop " << i << "\", \"latitude\": "
+                        << 55.5 + i % 1000 * 0.000513 << ", \"longitude\": " << 37.3 + i / 1000 * 0.00271
+                        << ", \"road_distances\": {\"Stop " << (i + 1) % STOPS << "\": " << 300 + i % 1700
+                        << ", \"Stop " << (i + 7) % STOPS << "\": " << 900 + i % 3100 << "}}";
+                }
+                for (int i = 0; i < STOPS / 20; ++i) {
+                    out << ", {\"type\": \"Bus\", \"name\": \"" << i << "\", \"is_roundtrip\": false, \"stops\": [";
+                    for (int j = 0; j < 20; ++j) {
+                        out << (j ? ", " : "") << "\"Stop " << (i * 20 + j * 7) % STOPS << '"';
+                    }
+                    out << "]}";
+                }
+                out << "]}";
+                return out.str();
+            }
+
+            // counts what goes through it to the default resource
+            class CountingResource : public std::pmr::memory_resource {
+            public:
+                size_t allocations = 0;
+                size_t bytes = 0;
+
+            private:
+                void* do_allocate(size_t size, size_t alignment) override {
+                    ++allocations;
+                    bytes += size;
+                    return upstream_->allocate(size, alignment);
+                }
+                void do_deallocate(void* ptr, size_t size, size_t alignment) override {
+                    upstream_->deallocate(ptr, size, alignment);
+                }
+                bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                    return this == &other;
+                }
+
+                std::pmr::memory_resource* upstream_ = std::pmr::get_default_resource();
+            };
+
+        }  // namespace
+
+        void TestArenaDocument() {
+            std::ostringstream out;
+            out << "{\"long key, past the inline buffer of a string\": [";
+            for (int i = 0; i < 1000; ++i) {
+                out << (i ? ", " : "") << "{\"id\": " << i << ", \"name\": \"a name long enough to be allocated " << i << "\"}";
+            }
+            out << "], \"e\": {}, \"a\": []}";
+            const std::string text = out.str();
+
+            CountingResource counting;
+            std::pmr::memory_resource* const previous = std::pmr::set_default_resource(&counting);
+            const Document heap = Load(std::string_view(text));
+            const size_t heap_allocations = counting.allocations;
+            std::optional<Document> arena(Load(std::string_view(text), Allocation::ARENA));
+            const size_t arena_allocations = counting.allocations - heap_allocations;
+            std::pmr::set_default_resource(previous);
+
+            assert(heap_allocations > 2000 && arena_allocations < 20);
+            assert(*arena == heap);
+
+            // moves keep the arena with the tree, copies leave it
+            Document moved(std::move(*arena));
+            const Dict copy = moved.GetRoot().AsMap();
+            arena.reset();
+            assert(moved == heap);
+            {
+                const Document destroyed = std::move(moved);
+            }
+            assert(copy == heap.GetRoot().AsMap());
+            assert(copy.at("long key, past the inline buffer of a string").AsArray()[999].AsMap().at("name").AsString()
+                == "a name long enough to be allocated 999"sv);
+        }
+
+        void TestWriter() {
+            const Node node = Array{ Dict{ { "a", Array{ 1, Dict{ { "b", nullptr } }, Array{} } },
+                { "c", Dict{ { "d", true }, { "e", Array{ 2.5 } } } }, { "f", "x\"\n"s } }, Dict{}, -7 };
+
+            // the pretty layout is the one Print has always had
+            std::ostringstream pretty;
+            Print(Document{ node }, pretty);
+            assert(pretty.str() == "[\n    {\n        \"a\":         [\n            1, \n            {\n                \"b\": null\n"
+                "            }, \n            [\n            ]\n        ], \n        \"c\": {\n    \"d\": true, \n    \"e\":     [\n"
+                "        2.5\n    ]\n}, \n        \"f\": \"x\\\"\\n\"\n    }, \n    {\n    }, \n    -7\n]"sv);
+
+            std::ostringstream compact;
+            Print(Document{ node }, compact, Layout::COMPACT);
+            assert(compact.str() == R"([{"a":[1,{"b":null},[]],"c":{"d":true,"e":[2.5]},"f":"x\"\n"},{},-7])"sv);
+
+            // runs between escapes are copied whole; a tab is left as it is
+            std::ostringstream escaped;
+            Print(Document{ "plain \"quoted\" back\\slash\r\n\ttab"s }, escaped, Layout::COMPACT);
+            assert(escaped.str() == R"("plain \"quoted\" back\\slash\r\n)" "\ttab\""sv);
+
+            // compact doubles in the shortest form that reads back exactly
+            const Array numbers{ 0.1, 1.0 / 3, 1e21, -2.5e-300, 123456789.0, 0.0, 1, -2147483647 - 1 };
+            std::ostringstream printed;
+            Print(Document{ numbers }, printed, Layout::COMPACT);
+            assert(printed.str() == "[0.1,0.3333333333333333,1e+21,-2.5e-300,123456789,0,1,-2147483648]"sv);
+            const Array read = Load(std::string_view(printed.str())).GetRoot().AsArray();
+            for (size_t i = 0; i < numbers.size(); ++i) {
+                assert(read[i].AsDouble() == numbers[i].AsDouble());
+            }
+            // and in the pretty layout as an ostream prints them by default
+            std::ostringstream rounded;
+            Print(Document{ numbers }, rounded);
+            std::ostringstream streamed;
+            for (const Node& number : numbers) {
+                streamed << (&number == &numbers.front() ? "[\n    " : ", \n    ");
+                if (number.IsPureDouble()) {
+                    streamed << number.AsDouble();
+                }
+                else {
+                    streamed << number.AsInt();
+                }
+            }
+            streamed << "\n]";
+            assert(rounded.str() == streamed.str());
+            assert(rounded.str().find("1.23457e+08") != std::string::npos);
+
+            // element by element, as Write writes the whole array, in both layouts and past the chunk size
+            Array big;
+            for (int i = 0; i < 20000; ++i) {
+                big.emplace_back(Dict{ { "request_id", i }, { "stop_name", "Stop "s + std::to_string(i) } });
+            }
+            for (const Layout layout : { Layout::PRETTY, Layout::COMPACT }) {
+                for (const Array& array : { Array{}, Array{ 1 }, Array{ Dict{ { "k", Array{ 1, "s"s } } }, nullptr, Array{} }, big }) {
+                    std::ostringstream whole, by_element;
+                    Print(Document{ array }, whole, layout);
+                    {
+                        Writer writer(by_element, layout);
+                        writer.StartArray();
+                        for (const Node& element : array) {
+                            writer.AddElement(element);
+                        }
+                        writer.EndArray();
+                    }
+                    assert(by_element.str() == whole.str());
+                    assert(Load(std::string_view(whole.str())).GetRoot().AsArray() == array);
+                }
+            }
+        }
+
+        void BenchmarkLoad() {
+            using Clock = std::chrono::steady_clock;
+
+            const std::string text = MakeBaseRequests();
+
+            const auto stream_start = Clock::now();
+            std::istringstream input(text);
+            const Document from_stream = Load(input);
+            const auto stream_time = Clock::now() - stream_start;
+
+            const auto buffer_start = Clock::now();
+            const Document from_buffer = Load(std::string_view(text));
+            const auto buffer_time = Clock::now() - buffer_start;
+
+            std::cerr << text.size() / 1000000. << " MB: stream " << std::chrono::duration<double, std::milli>(stream_time).count()
+                << " ms, buffer " << std::chrono::duration<double, std::milli>(buffer_time).count() << " ms"
+                << (from_stream == from_buffer ? "" : ", DIFFERENT DOCUMENTS") << '\n';
+        }
+
+        void BenchmarkArena() {
+            using Clock = std::chrono::steady_clock;
+            using Ms = std::chrono::duration<double, std::milli>;
+
+            const std::string text = MakeBaseRequests();
+            for (const Allocation allocation : { Allocation::HEAP, Allocation::ARENA }) {
+                // strings and containers of the tree come from the default resource or from an arena over it
+                CountingResource counting;
+                std::pmr::memory_resource* const previous = std::pmr::set_default_resource(&counting);
+
+                const auto load_start = Clock::now();
+                std::optional<Document> doc(Load(std::string_view(text), allocation));
+                const auto load_time = Clock::now() - load_start;
+                const size_t allocations = counting.allocations;
+                const size_t bytes = counting.bytes;
+
+                const auto free_start = Clock::now();
+                doc.reset();
+                const auto free_time = Clock::now() - free_start;
+                std::pmr::set_default_resource(previous);
+
+                std::cerr << (allocation == Allocation::HEAP ? "heap: " : "arena: ") << allocations << " allocations, "
+                    << bytes / 1000000. << " MB; load " << Ms(load_time).count() << " ms ("
+                    << text.size() / 1000. / Ms(load_time).count() << " MB/s), free " << Ms(free_time).count() << " ms\n";
+            }
+        }
+
+        void BenchmarkObjects() {
+            using Clock = std::chrono::steady_clock;
+
+            // stat requests: many small objects, each looked up by its fields
+            std::ostringstream out;
+            out << '[';
+            constexpr int REQUESTS = 500000;
+            for (int i = 0; i < REQUESTS; ++i) {
+                out << (i ? ", " : "") << "{\"id\": " << i << ", \"type\": \"" << (i % 3 ? "Bus" : "Stop")
+                    << "\", \"name\": \"Name " << i % 1000 << "\"}";
+            }
+            out << ']';
+            const std::string text = out.str();
+
+            const auto load_start = Clock::now();
+            const Document doc = Load(std::string_view(text));
+            const auto load_time = Clock::now() - load_start;
+
+            const auto lookup_start = Clock::now();
+            size_t checksum = 0;
+            for (int pass = 0; pass < 10; ++pass) {
+                for (const Node& request : doc.GetRoot().AsArray()) {
+                    const Dict& fields = request.AsMap();
+                    checksum += fields.at("type").AsString() == "Bus"sv ? fields.at("name").AsString().size() : 0;
+                    checksum += fields.at("id").AsInt() + fields.count("radius");
+                }
+            }
+            const auto lookup_time = Clock::now() - lookup_start;
+
+            std::cerr << REQUESTS << " objects: load " << std::chrono::duration<double, std::milli>(load_time).count()
+                << " ms, 4 lookups each " << std::chrono::duration<double, std::nano>(lookup_time).count() / (10. * REQUESTS)
+                << " ns (checksum " << checksum << ")\n";
+        }
+
+        void BenchmarkWriter() {
+            using Clock = std::chrono::steady_clock;
+            using Ms = std::chrono::duration<double, std::milli>;
+
+            // answers to stat requests: small objects, and now and then a long string with quotes
+            Array answers;
+            std::string map(100000, 'x');
+            for (size_t i = 0; i < map.size(); i += 50) {
+                map[i] = '"';
+            }
+            for (int i = 0; i < 200000; ++i) {
+                if (i % 1000 == 0) {
+                    answers.emplace_back(Dict{ { "map", map }, { "request_id", i } });
+                    continue;
+                }
+                answers.emplace_back(Dict{ { "buses", Array{ "14"s, "22k"s, std::to_string(i % 300) } }, { "request_id", i },
+                    { "curvature", 1.0 + i % 977 / 1000.3 }, { "route_length", 1000 + i % 50000 }, { "stop_count", i % 40 } });
+            }
+            const Document doc{ answers };
+
+            for (const Layout layout : { Layout::PRETTY, Layout::COMPACT }) {
+                std::ostringstream output;
+                const auto start = Clock::now();
+                Print(doc, output, layout);
+                const auto time = Clock::now() - start;
+                std::cerr << (layout == Layout::PRETTY ? "pretty: " : "compact: ") << output.str().size() / 1000000. << " MB in "
+                    << Ms(time).count() << " ms, " << output.str().size() / 1000. / Ms(time).count() << " MB/s\n";
+            }
+        }
+
+    }  // namespace tests
+
 }  // namespace json
\ No newline at end of file
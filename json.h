@@ -1,17 +1,60 @@
 #pragma once
 
+#include <algorithm>
+#include <initializer_list>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <variant>
 
 namespace json {
 
     class Node;
-    // Сохраните объявления Dict и Array без изменения
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
+
+    // JSON object: key/value pairs in one array sorted by key, a single allocation instead of a tree
+    // node per key. Iterates in key order, and the first of repeated keys wins, as with std::map.
+    // Lookups in the few fields of a request scan it comparing lengths first.
+    // Like strings and arrays, allocates from a memory resource, the default one unless given; copies
+    // go to the default one too.
+    class Dict {
+    public:
+        using value_type = std::pair<std::pmr::string, Node>;
+        using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+        Dict() = default;
+        explicit Dict(std::pmr::memory_resource* resource);
+        Dict(std::initializer_list<std::pair<std::string_view, Node>> items);
+        // moves the pairs out of fields, in any order, e.g. as parsed; fields keeps its buffer for reuse
+        static Dict MoveFrom(std::vector<value_type>& fields, std::pmr::memory_resource* resource);
+
+        const_iterator begin() const;
+        const_iterator end() const;
+        size_t size() const;
+        bool empty() const;
+        size_t capacity() const;
+
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+        const Node& at(std::string_view key) const; // throws std::out_of_range
+
+        // no change if the key is there already
+        std::pair<const_iterator, bool> emplace(std::string_view key, Node value);
+        size_t erase(std::string_view key);
+
+        bool operator==(const Dict& other) const;
+        bool operator!=(const Dict& other) const;
+
+    private:
+        std::pmr::vector<value_type>::iterator LowerBound(std::string_view key);
+
+        std::pmr::vector<value_type> items_;
+    };
+
+    using Array = std::pmr::vector<Node>;
 
     // Эта ошибка должна выбрасываться при ошибках парсинга JSON
     class ParsingError : public std::runtime_error {
@@ -21,12 +64,13 @@ namespace json {
 
     using Number = std::variant<int, double>;
 
-    using Value = std::variant<std::nullptr_t, int, double, std::string, bool, Array, Dict>;
+    using Value = std::variant<std::nullptr_t, int, double, std::pmr::string, bool, Array, Dict>;
     class Node final : private Value {
     public:
 
         // Делаем доступными все конструкторы родительского класса variant
         using variant::variant;
+        Node(const std::string& value);
 
         const Value& GetValue() const { return *this; }
 
@@ -42,12 +86,12 @@ namespace json {
         int AsInt() const;
         bool AsBool() const;
         double AsDouble() const; // Возвращает значение типа double, если внутри хранится double либо int.В последнем случае возвращается приведённое в double значение.
-        const std::string& AsString() const;
+        const std::pmr::string& AsString() const;
         const Array& AsArray() const;
         const Dict& AsMap() const;
 
         bool operator==(const Node& other) const {
-            return *this == other;
+            return GetValue() == other.GetValue();
         }
 
         bool operator!=(const Node& other) const {
@@ -58,9 +102,65 @@ namespace json {
     private:
     };
 
+    inline Dict::const_iterator Dict::begin() const {
+        return items_.begin();
+    }
+
+    inline Dict::const_iterator Dict::end() const {
+        return items_.end();
+    }
+
+    inline size_t Dict::size() const {
+        return items_.size();
+    }
+
+    inline bool Dict::empty() const {
+        return items_.empty();
+    }
+
+    inline size_t Dict::capacity() const {
+        return items_.capacity();
+    }
+
+    inline Dict::const_iterator Dict::find(std::string_view key) const {
+        if (items_.size() <= 8) {
+            for (auto it = items_.begin(); it != items_.end(); ++it) {
+                if (std::string_view(it->first) == key) {
+                    return it;
+                }
+            }
+            return items_.end();
+        }
+        const auto it = std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+            return std::string_view(item.first) < key;
+            });
+        return it != items_.end() && std::string_view(it->first) == key ? it : items_.end();
+    }
+
+    inline size_t Dict::count(std::string_view key) const {
+        return find(key) != items_.end();
+    }
+
+    inline bool Dict::operator==(const Dict& other) const {
+        return items_ == other.items_;
+    }
+
+    inline bool Dict::operator!=(const Dict& other) const {
+        return !(*this == other);
+    }
+
+    enum class Allocation {
+        HEAP,  // every string and container of the tree is a separate heap allocation
+        ARENA, // all of them go to a monotonic arena of the document, freed at once with it
+    };
+
     class Document {
     public:
         explicit Document(Node root);
+        // root allocated from arena, which the document keeps
+        Document(std::unique_ptr<std::pmr::monotonic_buffer_resource> arena, Node root);
+        Document(Document&& other) = default;
+        ~Document();
 
         const Node& GetRoot() const;
         bool operator==(const Document& other) const {
@@ -71,11 +171,194 @@ namespace json {
         }
 
     private:
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
         Node root_;
     };
 
     Document Load(std::istream& input);
+    // The same document from text in memory, e.g. an InputBuffer; several times faster than the stream
+    // version. Unlike it, rejects anything but whitespace after the root node.
+    // With Allocation::ARENA parsing makes a few large allocations, and the document is freed in O(1).
+    Document Load(std::string_view text, Allocation allocation = Allocation::HEAP);
+
+    namespace detail {
+
+        // Tokens of a JSON text in memory, for Load(std::string_view) and EventReader
+        class TextScanner {
+        public:
+            explicit TextScanner(std::string_view text);
+
+            char Peek(); // the next character after whitespace, not consumed; '\0' at the end
+            void Skip(); // the peeked character
+            bool AtEnd(); // nothing but whitespace left
+            void ExpectWord(std::string_view word, const char* error);
+            // after the opening quote; a view of the text, or of scratch if the string has escapes
+            std::string_view ReadString(std::string& scratch);
+            Number ReadNumber();
+
+        private:
+            const char* pos_;
+            const char* end_;
+        };
+
+        // Fields of the objects being parsed, one array per nesting level reused from object to object,
+        // so that an object costs the single allocation of its Dict
+        class ObjectStack {
+        public:
+            void Push(); // an object starts
+            void Add(std::pmr::string key, Node value); // to the innermost one
+            Dict Pop(std::pmr::memory_resource* resource);
+
+        private:
+            std::vector<std::vector<Dict::value_type>> levels_;
+            size_t depth_ = 0;
+        };
+
+        // The same for the elements of arrays: an array is allocated once, of its exact size
+        class ArrayStack {
+        public:
+            void Push();
+            void Add(Node value);
+            Array Pop(std::pmr::memory_resource* resource);
+
+        private:
+            std::vector<std::vector<Node>> levels_;
+            size_t depth_ = 0;
+        };
+
+    }  // namespace detail
+
+    enum class Event {
+        START_OBJECT,
+        END_OBJECT,
+        START_ARRAY,
+        END_ARRAY,
+        KEY,
+        STRING,
+        INT,
+        DOUBLE,
+        BOOL,
+        NULL_VALUE,
+        END, // of the document; returned from then on
+    };
+
+    // Pull parser: the document as a sequence of events, without building nodes. Memory is
+    // the nesting depth plus the longest escaped string. Throws ParsingError on the event
+    // where the text goes wrong, with the same grammar as Load(std::string_view).
+    class EventReader {
+    public:
+        explicit EventReader(std::string_view text);
+
+        Event Next();
+
+        // values of the last event; a string or key view is valid until the next call
+        std::string_view GetString() const; // KEY, STRING
+        int GetInt() const; // INT
+        double GetDouble() const; // INT, DOUBLE
+        bool GetBool() const; // BOOL
+        size_t GetDepth() const; // open objects and arrays
+
+        // the next value, or the one that starts with first (just returned by Next()), as a node
+        Node ReadNode();
+        Node ReadNode(Event first);
+        // past the next value, nodes not built
+        void SkipValue();
+
+    private:
+        enum class State {
+            VALUE,
+            FIRST_VALUE, // of an array, or its end
+            FIRST_KEY, // of an object, or its end
+            KEY,
+            AFTER_VALUE, // a comma or the end of the container
+            DONE,
+        };
+
+        Event ReadValue();
+
+    private:
+        detail::TextScanner scanner_;
+        State state_ = State::VALUE;
+        std::vector<char> containers_; // '{' or '[' of every open container
+        std::string_view string_;
+        std::string scratch_;
+        detail::ObjectStack objects_;
+        detail::ArrayStack arrays_;
+        Number number_;
+        bool bool_ = false;
+    };
+
+    // Push interface to the same events
+    class EventHandler {
+    public:
+        virtual void StartObject() = 0;
+        virtual void EndObject() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void Key(std::string_view key) = 0; // valid during the call only, as are strings
+        virtual void String(std::string_view value) = 0;
+        virtual void Int(int value) = 0;
+        virtual void Double(double value) = 0;
+        virtual void Bool(bool value) = 0;
+        virtual void Null() = 0;
+
+    protected:
+        ~EventHandler() = default;
+    };
+
+    void Parse(std::string_view text, EventHandler& handler);
+
+    enum class Layout {
+        PRETTY,  // a value per line, indented as Print always did, doubles to 6 significant digits
+        COMPACT, // no whitespace at all, doubles in full
+    };
+
+    // Appends the text to a buffer of its own that goes to the stream in large chunks. Strings are
+    // escaped a run of plain characters at a time, numbers formatted with std::to_chars. Doubles keep
+    // the stream default of 6 significant digits in the pretty layout, so its output is what Print
+    // has always given; the compact one has them in the shortest form that reads back the same.
+    class Writer {
+    public:
+        explicit Writer(std::ostream& output, Layout layout = Layout::PRETTY);
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer(); // flushes what is left
+
+        void Write(const Node& node);
+
+        // a top-level array element by element, written as Write writes an Array of the same elements
+        void StartArray();
+        void AddElement(const Node& element);
+        void EndArray();
+
+        void Flush(); // the buffer to the stream; the stream itself is not flushed
+
+    private:
+        void WriteValue(const Node& node, size_t indent);
+        void WriteArray(const Array& array, size_t indent);
+        void WriteDict(const Dict& dict, size_t indent);
+        void WriteString(std::string_view text);
+        void StartItem(bool& first); // of an array or an object
+        void EndContainer(char bracket, size_t indent);
+
+        std::ostream& output_;
+        bool pretty_;
+        std::string buffer_;
+        bool first_element_ = true;
+    };
+
+    void Print(const Document& doc, std::ostream& output, Layout layout = Layout::PRETTY);
 
-    void Print(const Document& doc, std::ostream& output);
+    namespace tests {
+        void TestLoadBuffer();
+        void TestDict();
+        void TestArenaDocument();
+        void TestWriter();
+        void TestEventReader();
+        void BenchmarkLoad(); // prints to std::cerr
+        void BenchmarkObjects(); // prints to std::cerr
+        void BenchmarkArena(); // prints to std::cerr
+        void BenchmarkWriter(); // prints to std::cerr
+    }
 
 }  // namespace json
\ No newline at end of file
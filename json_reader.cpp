@@ -1,24 +1,102 @@
 #include "json_reader.h"
 #include "request_handler.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
 
 namespace transport {
 
 	void JsonReader::Input(std::istream & input) {
+		const Document doc = Load(input);
+		HandleDocument(doc.GetRoot().AsMap(), false);
+	}
+
+	void JsonReader::Input(std::string_view text) {
+		EventReader reader(text);
+		bool base_requests_handled = false;
+		const Dict root = ReadRoot(reader, base_requests_handled, nullptr);
+		HandleDocument(root, base_requests_handled);
+	}
 
-		Document doc = Load(input);
+	void JsonReader::Process(std::string_view text, std::ostream& output) {
+		// stat_requests are passed over first: they are answered with every setting applied, wherever the keys are
+		EventReader reader(text);
+		bool base_requests_handled = false;
+		std::optional<EventReader> stat_requests;
+		const Dict root = ReadRoot(reader, base_requests_handled, &stat_requests);
+		if (!stat_requests) {
+			throw std::out_of_range("no stat_requests");
+		}
+		HandleSettings(root, base_requests_handled);
+		StreamStatRequests(*stat_requests, output);
+	}
+
+	Dict JsonReader::ReadRoot(EventReader& reader, bool& base_requests_handled, std::optional<EventReader>* stat_requests) {
+		// nodes for everything but base_requests, by far the largest part: it goes to the catalogue request by request
+		if (reader.Next() != Event::START_OBJECT) {
+			throw std::logic_error("wrong type");
+		}
+		Dict root;
+		for (Event event = reader.Next(); event != Event::END_OBJECT; event = reader.Next()) {
+			std::string key(reader.GetString());
+			if (key == "base_requests"sv && !base_requests_handled && !root.count(key)) {
+				StreamBaseRequests(reader);
+				base_requests_handled = true;
+			}
+			else if (stat_requests && key == "stat_requests"sv && !*stat_requests) {
+				stat_requests->emplace(reader);
+				reader.SkipValue();
+			}
+			else {
+				// as with Load, the first of repeated keys wins
+				Node value = reader.ReadNode();
+				root.emplace(std::move(key), std::move(value));
+			}
+		}
+		reader.Next();
+		return root;
+	}
+
+	void JsonReader::HandleDocument(const Dict& root, bool base_requests_handled) {
 
 		// "base_requests": [...] , — массив с описанием автобусных маршрутов и остановок,
 		// "stat_requests" : [...] — массив с запросами к транспортному справочнику.
-		const Array& base_requests = doc.GetRoot().AsMap().at("base_requests").AsArray();
-		const Array& stat_requests = doc.GetRoot().AsMap().at("stat_requests").AsArray();
+		const Array& stat_requests = root.at("stat_requests").AsArray();
+		HandleSettings(root, base_requests_handled);
+		HandleStatRequests(stat_requests);
+
+	}
+
+	void JsonReader::HandleSettings(const Dict& root, bool base_requests_handled) {
+
 		// "render_settings": { ... }
-		const Dict& render_settings = doc.GetRoot().AsMap().at("render_settings").AsMap();
+		const Dict& render_settings = root.at("render_settings").AsMap();
 
-		HandleBaseRequests(base_requests);
+		if (!base_requests_handled) {
+			HandleBaseRequests(root.at("base_requests").AsArray());
+		}
 		HandleRenderSettings(render_settings);
-		HandleStatRequests(stat_requests);
+		// "routing_settings": { ... }, только если есть запросы Route, Isochrone и Matrix
+		if (const auto it = root.find("routing_settings"); it != root.end()) {
+			HandleRoutingSettings(it->second.AsMap());
+		}
+		// "distance_settings": { "mode": "exact" / "haversine" / "equirectangular" }, необязательно
+		if (const auto it = root.find("distance_settings"); it != root.end()) {
+			HandleDistanceSettings(it->second.AsMap());
+		}
+		// "cache_settings": { "max_bytes": 33554432 }, необязательно; 0 отключает кэш ответов
+		if (const auto it = root.find("cache_settings"); it != root.end()) {
+			HandleCacheSettings(it->second.AsMap());
+		}
 
 	}
 
@@ -30,13 +108,45 @@ namespace transport {
 
 	void JsonReader::HandleBaseRequests(const Array& base_requests) {
 
-		std::vector<const Dict*> bus_requests;
-		std::unordered_map<std::string_view, std::vector<DistanceToStop> > stop_distances;
+		std::vector<StopDescription> stops;
+		std::vector<BusDescription> buses;
+		std::vector<DistanceDescription> distances;
+		std::vector<std::pair<std::string_view, const Array*>> trips;
 
 		for (const Node& request_node : base_requests) {
 			const Dict& request = request_node.AsMap();
 			if (request.at("type").AsString() == "Bus"sv) {
-				bus_requests.push_back(&request);
+				/*
+				{
+					"type": "Bus",
+					"name" : "14",
+					"stops" : [ // массив с названиями остановок, через которые проходит маршрут.
+								// У кольцевого маршрута название последней остановки дублирует название первой.
+								// Например: ["stop1", "stop2", "stop3", "stop1"]
+						"Улица Лизы Чайкиной",
+						"Электросети",
+						"Улица Докучаева",
+						"Улица Лизы Чайкиной"
+					] ,
+					"is_roundtrip": true, // значение типа bool. true, если маршрут кольцевой
+					"trips": [ // необязательно: рейсы, время на каждой остановке полной последовательности
+							   // (у некольцевого маршрута — туда и обратно)
+						["6:00", "6:04", "6:09", "6:15"],
+						["6:20", "6:24", "6:29:30", "6:36"]
+					]
+				}
+				*/
+				BusDescription& bus = buses.emplace_back();
+				bus.name = request.at("name").AsString();
+				bus.isRing = request.at("is_roundtrip").AsBool();
+				for (const auto& busstop : request.at("stops").AsArray()) {
+					bus.stopnames.push_back(busstop.AsString());
+				}
+				if (const auto it = request.find("trips"); it != request.end()) {
+					for (const Node& trip : it->second.AsArray()) {
+						trips.push_back({ bus.name, &trip.AsArray() });
+					}
+				}
 			}
 			else if (request.at("type").AsString() == "Stop"sv) {
 				/*
@@ -55,46 +165,167 @@ namespace transport {
 				*/
 
 				std::string_view stopname = request.at("name").AsString();
-				catalogue_.AddStop(std::string(stopname),
-					{ request.at("latitude").AsDouble(), request.at("longitude").AsDouble() });
+				stops.push_back({ stopname, { request.at("latitude").AsDouble(), request.at("longitude").AsDouble() } });
 
-				const Dict& distances = request.at("road_distances").AsMap();
-				for (const auto& [key_stopname, value_distance] : distances) {
-					DistanceToStop dist{ key_stopname, static_cast<unsigned int>(value_distance.AsInt()) };
-					stop_distances[catalogue_.GetStop(stopname)->name].push_back(std::move(dist));
+				for (const auto& [key_stopname, value_distance] : request.at("road_distances").AsMap()) {
+					distances.push_back({ stopname, key_stopname, static_cast<unsigned int>(value_distance.AsInt()) });
 				}
 			}
 		}
 
-		for (auto& query : bus_requests) {
-			/*
-			{
-				"type": "Bus",
-				"name" : "14",
-				"stops" : [ // массив с названиями остановок, через которые проходит маршрут.
-							// У кольцевого маршрута название последней остановки дублирует название первой.
-							// Например: ["stop1", "stop2", "stop3", "stop1"]
-					"Улица Лизы Чайкиной",
-					"Электросети",
-					"Улица Докучаева",
-					"Улица Лизы Чайкиной"
-				] ,
-				"is_roundtrip": true // значение типа bool. true, если маршрут кольцевой
+		// names stay in base_requests, so the descriptions may refer to them
+		catalogue_.AddBulk(stops, buses, distances);
+
+		std::vector<uint32_t> times;
+		for (const auto& [busname, trip] : trips) {
+			times.clear();
+			for (const Node& time : *trip) {
+				times.push_back(ParseTime(time));
 			}
-			*/
-			std::vector<std::string> bus_stopnames;
-			for (const auto& busstop : query->at("stops").AsArray()) {
-				bus_stopnames.push_back(busstop.AsString());
+			catalogue_.AddTrip(busname, times);
+		}
+
+	}
+
+	void JsonReader::StreamBaseRequests(EventReader& reader) {
+
+		// Stops go to the catalogue as they come. Buses, distances and trips may name stops further down
+		// the array, so they wait for its end and go to AddBulk the way HandleBaseRequests passes them:
+		// a stop named twice serves by its last definition, and buses keep their order. Adding them any
+		// earlier would change either. Until the end, besides the catalogue, the memory is 16 bytes per
+		// stop of a bus and 40 per distance, the trip times, and every bus name and every name used
+		// before its stop once; only one request is a node at a time.
+		std::deque<std::string> names; // of buses and of stops not added yet
+		std::unordered_set<std::string_view> forward_names; // in names
+		const auto stop_name = [&](std::string_view stopname) {
+			if (const Stop* stop = catalogue_.GetStop(stopname)) {
+				return std::string_view(stop->name);
 			}
-			catalogue_.AddRoute(query->at("name").AsString(), bus_stopnames, query->at("is_roundtrip").AsBool());
+			const auto it = forward_names.find(stopname);
+			return it != forward_names.end() ? *it : *forward_names.insert(names.emplace_back(stopname)).first;
+		};
+		std::vector<BusDescription> buses;
+		std::vector<DistanceDescription> distances;
+		std::vector<std::pair<size_t, std::vector<uint32_t>>> trips; // index in buses, times
+
+		if (reader.Next() != Event::START_ARRAY) {
+			throw std::logic_error("wrong type");
 		}
+		for (Event event = reader.Next(); event != Event::END_ARRAY; event = reader.Next()) {
+			const Node request_node = reader.ReadNode(event);
+			const Dict& request = request_node.AsMap();
+			if (request.at("type").AsString() == "Bus"sv) {
+				BusDescription& bus = buses.emplace_back();
+				bus.name = names.emplace_back(request.at("name").AsString());
+				bus.isRing = request.at("is_roundtrip").AsBool();
+				const Array& stops = request.at("stops").AsArray();
+				bus.stopnames.reserve(stops.size());
+				for (const auto& busstop : stops) {
+					bus.stopnames.push_back(stop_name(busstop.AsString()));
+				}
+				if (const auto it = request.find("trips"); it != request.end()) {
+					for (const Node& trip : it->second.AsArray()) {
+						std::vector<uint32_t>& times = trips.emplace_back(buses.size() - 1, std::vector<uint32_t>{}).second;
+						for (const Node& time : trip.AsArray()) {
+							times.push_back(ParseTime(time));
+						}
+					}
+				}
+			}
+			else if (request.at("type").AsString() == "Stop"sv) {
+				catalogue_.AddStop(request.at("name").AsString(), { request.at("latitude").AsDouble(), request.at("longitude").AsDouble() });
+				const std::string_view stopname = catalogue_.GetStop(static_cast<StopId>(catalogue_.GetStopCount() - 1))->name;
 
-		for (auto& [stopname, dest_info_vector] : stop_distances) {
-			for (auto& dest_info : dest_info_vector) {
-				catalogue_.SetDistance(stopname, dest_info.dest_stopname, dest_info.distance);
+				for (const auto& [key_stopname, value_distance] : request.at("road_distances").AsMap()) {
+					distances.push_back({ stopname, stop_name(key_stopname), static_cast<unsigned int>(value_distance.AsInt()) });
+				}
 			}
 		}
 
+		catalogue_.AddBulk({}, buses, distances);
+
+		for (const auto& [bus, times] : trips) {
+			catalogue_.AddTrip(buses[bus].name, times);
+		}
+	}
+
+	void JsonReader::HandleRoutingSettings(const Dict& routing_settings) {
+		/*
+		{
+			"bus_wait_time": 6, // минут
+			"bus_velocity": 40  // км/ч
+		}*/
+		const router::RoutingSettings settings{ routing_settings.at("bus_wait_time").AsDouble(), routing_settings.at("bus_velocity").AsDouble() };
+		if (settings.bus_wait_time != routing_settings_.bus_wait_time || settings.bus_velocity != routing_settings_.bus_velocity) {
+			cache_.Clear();
+		}
+		routing_settings_ = settings;
+		router_.reset();
+	}
+
+	void JsonReader::HandleDistanceSettings(const Dict& distance_settings) {
+		// точность прямых расстояний (длина маршрута по прямой, извилистость, ближайшие остановки): см. geo::DistanceMode
+		const std::string_view mode = distance_settings.at("mode").AsString();
+		if (mode == "exact"sv) {
+			catalogue_.SetDistanceMode(::geo::DistanceMode::EXACT);
+		}
+		else if (mode == "haversine"sv) {
+			catalogue_.SetDistanceMode(::geo::DistanceMode::HAVERSINE);
+		}
+		else if (mode == "equirectangular"sv) {
+			catalogue_.SetDistanceMode(::geo::DistanceMode::EQUIRECTANGULAR);
+		}
+		else {
+			throw std::invalid_argument("unknown distance mode "s + std::string(mode));
+		}
+	}
+
+	void JsonReader::HandleCacheSettings(const Dict& cache_settings) {
+		// целое неотрицательное число байт; за пределами int оно читается как double
+		const double value = cache_settings.at("max_bytes").AsDouble();
+		if (!(value >= 0) || value != std::floor(value) || value >= 9007199254740992.0
+			|| value > static_cast<double>(std::numeric_limits<size_t>::max())) {
+			throw std::invalid_argument("bad cache max_bytes "s + std::to_string(value));
+		}
+		SetCacheMaxBytes(static_cast<size_t>(value));
+	}
+
+	void JsonReader::SetCacheMaxBytes(size_t max_bytes) {
+		cache_.SetMaxBytes(max_bytes);
+	}
+
+	ResultCache::Stats JsonReader::GetCacheStats() const {
+		return cache_.GetStats();
+	}
+
+	const router::TransportRouter& JsonReader::GetRouter() {
+		if (!router_ || router_->GetCatalogueVersion() != catalogue_.GetVersion()) {
+			router_ = std::make_unique<router::TransportRouter>(catalogue_, routing_settings_);
+		}
+		return *router_;
+	}
+
+	void JsonReader::StreamStatRequests(EventReader& reader, std::ostream& output) {
+		if (reader.Next() != Event::START_ARRAY) {
+			throw std::logic_error("wrong type");
+		}
+		// answers are not kept: each one leaves as soon as it is given; those pending from Input stay
+		// for Output
+		const size_t pending = answers_.size();
+		Writer writer(output);
+		writer.StartArray();
+		Array request(1);
+		for (Event event = reader.Next(); event != Event::END_ARRAY; event = reader.Next()) {
+			request[0] = reader.ReadNode(event);
+			HandleStatRequests(request);
+			for (size_t i = pending; i < answers_.size(); ++i) {
+				writer.AddElement(answers_[i]);
+			}
+			answers_.resize(pending);
+			writer.Flush();
+			output.flush();
+		}
+		writer.EndArray();
 	}
 
 	void JsonReader::HandleStatRequests(const Array& stat_requests) {
@@ -107,6 +338,20 @@ namespace transport {
 		}*/
 		for (const Node& request_node : stat_requests) {
 			const Dict& request = request_node.AsMap();
+
+			// the same question about the same catalogue gets the answer given before
+			std::string cache_key;
+			if (cache_.GetMaxBytes() > 0) {
+				cache_key = ResultCache::MakeKey(request);
+				if (const Dict* cached = cache_.Find(cache_key, catalogue_.GetVersion())) {
+					Dict answer = *cached;
+					answer.emplace("request_id"s, request.at("id").AsInt());
+					answers_.push_back(std::move(answer));
+					continue;
+				}
+			}
+			const size_t answer_count = answers_.size();
+
 			if (request.at("type").AsString() == "Bus"sv) {
 				
 				const auto route_ptr = catalogue_.GetRoute(request.at("name").AsString());
@@ -158,10 +403,10 @@ namespace transport {
 
 					if (stop_info.buses.has_value()) {
 
-						buses.reserve(stop_info.buses.value().get().size());
+						buses.reserve(stop_info.buses->size());
 
-						for (auto it = stop_info.buses.value().get().cbegin(); it != stop_info.buses.value().get().cend(); ++it) {
-							buses.push_back((*it)->name);
+						for (const Bus* bus : *stop_info.buses) {
+							buses.push_back(std::string(bus->name));
 						}
 
 					}
@@ -182,21 +427,19 @@ namespace transport {
 			}
 			else if (request.at("type").AsString() == "Map"sv) {
 
-				RequestHandler handler(catalogue_, renderer_);
+				// every map is drawn from scratch, so a repeated request (cached or not) gets the same map
+				MapRenderer renderer(renderer_);
+				RequestHandler handler(catalogue_, renderer);
 
-				for (const std::string& name : catalogue_.GetStopNames()) {
-					const auto& stop_info = catalogue_.GetStopInfo(name);
-					if (stop_info.buses.has_value()) {
-						const auto stop = handler.GetStopStat(name);
-						renderer_.AddStop(*stop);
+				// the renderer keeps pointers into the catalogue: nothing is copied
+				for (const Stop* stop : catalogue_.GetStopsByName()) {
+					if (catalogue_.GetStopInfo(stop->id).buses.has_value()) {
+						renderer.AddStop(*stop);
 					}
 				}
 
-				for (const std::string& name : catalogue_.GetRouteNames()) {
-					const auto bus = handler.GetBusStat(name);
-					if (bus.has_value()) {
-						renderer_.AddRoute(*bus);
-					}
+				for (const Bus* bus : catalogue_.GetRoutesByName()) {
+					renderer.AddRoute(*bus);
 				}
 
 				std::stringstream ss;
@@ -208,6 +451,312 @@ namespace transport {
 				};
 				answers_.push_back(std::move(answer));
 			}
+			else if (request.at("type").AsString() == "Route"sv) {
+				/*
+				{
+					"id": 4,
+					"type": "Route",
+					"from": "Biryulyovo Zapadnoye",
+					"to": "Universam"
+				}*/
+				const auto route = GetRouter().FindRoute(request.at("from").AsString(), request.at("to").AsString());
+
+				if (route) {
+					/*
+					{
+						"request_id": 4,
+						"total_time": 11.235,
+						"items": [
+							{ "type": "Wait", "stop_name": "Biryulyovo", "time": 6 },
+							{ "type": "Bus", "bus": "297", "span_count": 2, "time": 5.235 }
+						]
+					}*/
+					Array items;
+					items.reserve(route->items.size());
+					for (const router::RouteItem& item : route->items) {
+						if (item.type == router::RouteItem::Type::WAIT) {
+							items.push_back(Dict{
+								{"type"s, "Wait"s},
+								{"stop_name"s, std::string(item.name)},
+								{"time"s, item.time},
+							});
+						}
+						else {
+							items.push_back(Dict{
+								{"type"s, "Bus"s},
+								{"bus"s, std::string(item.name)},
+								{"span_count"s, item.span_count},
+								{"time"s, item.time},
+							});
+						}
+					}
+
+					Dict answer{
+						{"items"s, std::move(items)},
+						{"request_id", request.at("id").AsInt()},
+						{"total_time"s, route->total_time},
+					};
+					answers_.push_back(std::move(answer));
+				}
+				else {
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"error_message"s, "not found"s},
+					};
+					answers_.push_back(std::move(answer));
+				}
+			}
+			else if (request.at("type").AsString() == "NearbyStops"sv) {
+				/*
+				{
+					"id": 12345,
+					"type": "NearbyStops",
+					"latitude": 43.598701,
+					"longitude": 39.730623,
+					"radius": 500, // метров; и/или
+					"count": 3     // ближайших остановок
+				}*/
+				const geo::Coordinates center{ request.at("latitude").AsDouble(), request.at("longitude").AsDouble() };
+				const auto radius_it = request.find("radius");
+				const auto count_it = request.find("count");
+
+				std::vector<NearbyStop> nearby;
+				if (count_it != request.end()) {
+					nearby = catalogue_.FindNearestStops(center, static_cast<size_t>(std::max(count_it->second.AsInt(), 0)));
+					if (radius_it != request.end()) {
+						const double radius = radius_it->second.AsDouble();
+						nearby.erase(std::find_if(nearby.begin(), nearby.end(), [radius](const NearbyStop& stop) {
+							return stop.distance > radius;
+							}), nearby.end());
+					}
+				}
+				else {
+					nearby = catalogue_.FindStopsWithinRadius(center, request.at("radius").AsDouble());
+				}
+
+				/*
+				{
+				  "stops": [
+					  { "name": "Электросети", "distance": 120.5 }
+				  ],
+				  "request_id": 12345
+				}*/
+				Array stops;
+				stops.reserve(nearby.size());
+				for (const NearbyStop& stop : nearby) {
+					stops.push_back(Dict{
+						{"name"s, std::string(catalogue_.GetStop(stop.id)->name)},
+						{"distance"s, stop.distance},
+					});
+				}
+
+				Dict answer{
+					{"request_id", request.at("id").AsInt()},
+					{"stops"s, std::move(stops)},
+				};
+				answers_.push_back(std::move(answer));
+			}
+			else if (request.at("type").AsString() == "NearbyBuses"sv) {
+				/*
+				{
+					"id": 12346,
+					"type": "NearbyBuses",
+					"latitude": 43.598701,
+					"longitude": 39.730623,
+					"radius": 300 // метров
+				}
+				или прямоугольник (west > east — через 180-й меридиан)
+				{
+					"id": 12347,
+					"type": "NearbyBuses",
+					"south": 43.58, "west": 39.71, "north": 43.60, "east": 39.74
+				}*/
+				std::vector<const Bus*> buses;
+				if (request.count("radius")) {
+					buses = catalogue_.FindBusesNear({ request.at("latitude").AsDouble(), request.at("longitude").AsDouble() },
+						request.at("radius").AsDouble());
+				}
+				else {
+					buses = catalogue_.FindBusesInBox({ request.at("south").AsDouble(), request.at("west").AsDouble() },
+						{ request.at("north").AsDouble(), request.at("east").AsDouble() });
+				}
+
+				/*
+				{
+				  "buses": ["14", "22к"],
+				  "request_id": 12346
+				}*/
+				Array names;
+				names.reserve(buses.size());
+				for (const Bus* bus : buses) {
+					names.push_back(std::string(bus->name));
+				}
+
+				Dict answer{
+					{"buses"s, std::move(names)},
+					{"request_id", request.at("id").AsInt()},
+				};
+				answers_.push_back(std::move(answer));
+			}
+			else if (request.at("type").AsString() == "Isochrone"sv) {
+				/*
+				{
+					"id": 5,
+					"type": "Isochrone",
+					"from": "Biryulyovo Zapadnoye",
+					"max_time": 15 // минут
+				}*/
+				const Stop* from = catalogue_.GetStop(request.at("from").AsString());
+
+				if (from) {
+					/*
+					{
+						"request_id": 5,
+						"stops": [
+							{ "name": "Biryulyovo Zapadnoye", "time": 0 },
+							{ "name": "Universam", "time": 11.235 }
+						]
+					}*/
+					const auto reachable = GetRouter().FindReachableStops(from->id, request.at("max_time").AsDouble());
+					Array stops;
+					stops.reserve(reachable.size());
+					for (const router::ReachableStop& stop : reachable) {
+						stops.push_back(Dict{
+							{"name"s, std::string(catalogue_.GetStop(stop.id)->name)},
+							{"time"s, stop.time},
+						});
+					}
+
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"stops"s, std::move(stops)},
+					};
+					answers_.push_back(std::move(answer));
+				}
+				else {
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"error_message"s, "not found"s},
+					};
+					answers_.push_back(std::move(answer));
+				}
+			}
+			else if (request.at("type").AsString() == "EarliestArrival"sv) {
+				/*
+				{
+					"id": 7,
+					"type": "EarliestArrival",
+					"from": "Biryulyovo Zapadnoye",
+					"to": "Universam",
+					"departure": "8:00"
+				}*/
+				const Stop* from = catalogue_.GetStop(request.at("from").AsString());
+				const Stop* to = catalogue_.GetStop(request.at("to").AsString());
+
+				const Timetable& timetable = catalogue_.GetTimetable();
+				if (!connection_scan_) {
+					connection_scan_ = std::make_unique<ConnectionScan>(timetable);
+				}
+				std::optional<uint32_t> arrival;
+				if (from && to) {
+					arrival = connection_scan_->Run(from->id, to->id, ParseTime(request.at("departure")));
+				}
+
+				if (arrival) {
+					/*
+					{
+						"request_id": 7,
+						"arrival": "8:17",
+						"legs": [
+							{ "bus": "297", "from": "Biryulyovo Zapadnoye", "to": "Universam", "departure": "8:05", "arrival": "8:17" }
+						]
+					}*/
+					Array legs;
+					for (const JourneyLeg& leg : connection_scan_->GetJourney(to->id)) {
+						legs.push_back(Dict{
+							{"bus"s, std::string(catalogue_.GetRoute(timetable.GetTripBus(leg.trip))->name)},
+							{"from"s, std::string(catalogue_.GetStop(leg.from)->name)},
+							{"to"s, std::string(catalogue_.GetStop(leg.to)->name)},
+							{"departure"s, FormatTime(leg.departure)},
+							{"arrival"s, FormatTime(leg.arrival)},
+						});
+					}
+
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"arrival"s, FormatTime(*arrival)},
+						{"legs"s, std::move(legs)},
+					};
+					answers_.push_back(std::move(answer));
+				}
+				else {
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"error_message"s, "not found"s},
+					};
+					answers_.push_back(std::move(answer));
+				}
+			}
+			else if (request.at("type").AsString() == "Matrix"sv) {
+				/*
+				{
+					"id": 6,
+					"type": "Matrix",
+					"from": ["Biryulyovo Zapadnoye", "Universam"],
+					"to": ["Universam", "Pokrovskaya", "Prazhskaya"]
+				}*/
+				const auto to_ids = [this](const Array& names) {
+					std::optional<std::vector<StopId>> ids(std::in_place);
+					ids->reserve(names.size());
+					for (const Node& name : names) {
+						const Stop* stop = catalogue_.GetStop(name.AsString());
+						if (!stop) {
+							return std::optional<std::vector<StopId>>{};
+						}
+						ids->push_back(stop->id);
+					}
+					return ids;
+				};
+				const auto sources = to_ids(request.at("from").AsArray());
+				const auto targets = to_ids(request.at("to").AsArray());
+
+				if (sources && targets) {
+					/*
+					{
+						"request_id": 6,
+						"rows": 2,
+						"columns": 3,
+						"times": [0, 11.235, 24.21, null, ...] // по строкам, null - нет маршрута
+					}*/
+					const auto matrix = GetRouter().ComputeTravelTimes(*sources, *targets);
+					Array times;
+					times.reserve(matrix.size());
+					for (double time : matrix) {
+						times.push_back(std::isinf(time) ? Node(nullptr) : Node(time));
+					}
+
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"rows"s, static_cast<int>(sources->size())},
+						{"columns"s, static_cast<int>(targets->size())},
+						{"times"s, std::move(times)},
+					};
+					answers_.push_back(std::move(answer));
+				}
+				else {
+					Dict answer{
+						{"request_id", request.at("id").AsInt()},
+						{"error_message"s, "not found"s},
+					};
+					answers_.push_back(std::move(answer));
+				}
+			}
+
+			if (!cache_key.empty() && answers_.size() > answer_count) {
+				Dict answer = answers_.back().AsMap();
+				answer.erase("request_id");
+				cache_.Insert(std::move(cache_key), catalogue_.GetVersion(), std::move(answer));
+			}
 		}
 	}
 
@@ -216,7 +765,7 @@ namespace transport {
 		svg::Color result;
 
 		if (color_node.IsString()) {
-			result = color_node.AsString();			
+			result = std::string(color_node.AsString());			
 		}
 		else if (color_node.IsArray()) {
 			
@@ -236,6 +785,41 @@ namespace transport {
 
 	}
 
+	uint32_t JsonReader::ParseTime(const Node& time_node) {
+
+		const std::string_view text = time_node.AsString();
+		uint32_t parts[3] = { 0, 0, 0 }; // hours, minutes, seconds
+		size_t part = 0;
+		size_t digits = 0;
+		for (char c : text) {
+			if (c >= '0' && c <= '9' && digits < 6) {
+				parts[part] = parts[part] * 10 + (c - '0');
+				++digits;
+			}
+			else if (c == ':' && digits > 0 && part < 2) {
+				++part;
+				digits = 0;
+			}
+			else {
+				throw std::invalid_argument("bad time "s + std::string(text));
+			}
+		}
+		if (part == 0 || digits == 0 || parts[1] >= 60 || parts[2] >= 60) {
+			throw std::invalid_argument("bad time "s + std::string(text));
+		}
+
+		return (parts[0] * 60 + parts[1]) * 60 + parts[2];
+	}
+
+	std::string JsonReader::FormatTime(uint32_t seconds) {
+		std::ostringstream out;
+		out << seconds / 3600 << ':' << std::setfill('0') << std::setw(2) << seconds / 60 % 60;
+		if (seconds % 60 != 0) {
+			out << ':' << std::setw(2) << seconds % 60;
+		}
+		return out.str();
+	}
+
 	void JsonReader::HandleRenderSettings(const Dict& render_settings) {
 		/*
 		{
@@ -278,11 +862,18 @@ namespace transport {
 				- в массиве из трёх целых чисел диапазона[0, 255]. Они определяют r, g и b компоненты цвета в формате svg::Rgb. Цвет[255, 16, 12] нужно вывести в SVG как rgb(255, 16, 12);
 				- в массиве из четырёх элементов: три целых числа в диапазоне от[0, 255] и одно вещественное число в диапазоне от[0.0, 1.0].Они задают составляющие red, green, blue и opacity цвета формата svg::Rgba.Цвет, заданный как[255, 200, 23, 0.85], должен быть выведен в SVG как rgba(255, 200, 23, 0.85).
 		*/
+		// maps cached with other settings are no longer valid
+		if (render_settings != render_settings_) {
+			cache_.Clear();
+			render_settings_ = render_settings;
+		}
+
 		using namespace renderer;
 
 		RendererSettings settings;
 
-		for (const auto& [key, val] : render_settings) {
+		for (const auto& [name, val] : render_settings) {
+			const std::string key(name);
 			
 			if (key == "underlayer_color"s) {
 				settings.SetSetting(key, ParseColor(val));
@@ -299,7 +890,7 @@ namespace transport {
 			} else if (val.IsDouble()) {
 				settings.SetSetting(key, val.AsDouble());
 			} else if (val.IsString()) {
-				settings.SetSetting(key, val.AsString());
+				settings.SetSetting(key, std::string(val.AsString()));
 			} else if (val.IsArray()) {
 				RendererSettings::ArrayDouble arr;
 				for (const auto& element : val.AsArray()) {
@@ -361,7 +952,80 @@ namespace transport {
 			json::Print(Document{ root }, strm);
 			reader.Input(strm);
 			reader.Output(std::cout);
-			
+
+			// the cache size is a whole non-negative number of bytes, possibly past the range of int
+			const auto with_cache = [](std::string_view max_bytes) {
+				return R"({"base_requests": [], "stat_requests": [], "render_settings": {}, "cache_settings": {"max_bytes": )"s
+					+ std::string(max_bytes) + "}}";
+			};
+			std::ostringstream out;
+			for (const std::string_view max_bytes : { "0"sv, "1000"sv, "4294967296"sv }) {
+				reader.Process(with_cache(max_bytes), out);
+			}
+			for (const std::string_view max_bytes : { "-1"sv, "0.5"sv, "-1e300"sv, "1e300"sv }) {
+				bool thrown = false;
+				try {
+					reader.Process(with_cache(max_bytes), out);
+				}
+				catch (const std::invalid_argument&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+		}
+
+		void TestStreamingOutput() {
+			// stat_requests before the settings they need, and a duplicate that must be ignored
+			const std::string text = R"({
+				"stat_requests": [
+					{"id": 1, "type": "Bus", "name": "14"},
+					{"id": 2, "type": "Route", "from": "A", "to": "C"},
+					{"id": 3, "type": "Stop", "name": "Nowhere"},
+					{"id": 4, "type": "Unknown"},
+					{"id": 5, "type": "Map"}
+				],
+				"base_requests": [
+					{"type": "Bus", "name": "14", "stops": ["A", "B", "C"], "is_roundtrip": false},
+					{"type": "Stop", "name": "A", "latitude": 43.59, "longitude": 39.72, "road_distances": {"B": 1000}},
+					{"type": "Stop", "name": "B", "latitude": 43.60, "longitude": 39.73, "road_distances": {"C": 1500}},
+					{"type": "Stop", "name": "C", "latitude": 43.61, "longitude": 39.74, "road_distances": {}},
+					{"type": "Stop", "name": "B", "latitude": 43.605, "longitude": 39.735, "road_distances": {"C": 1400}}
+				],
+				"render_settings": {"width": 600, "height": 400, "padding": 50, "line_width": 14, "stop_radius": 5,
+					"bus_label_font_size": 20, "bus_label_offset": [7, 15], "stop_label_font_size": 20, "stop_label_offset": [7, -3],
+					"underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3, "color_palette": ["green", [255, 160, 0]]},
+				"routing_settings": {"bus_wait_time": 6, "bus_velocity": 40},
+				"stat_requests": []
+			})";
+
+			TransportCatalogue whole_catalogue;
+			MapRenderer whole_renderer;
+			JsonReader whole_reader(whole_catalogue, whole_renderer);
+			std::istringstream input(text);
+			whole_reader.Input(input);
+			std::ostringstream whole;
+			whole_reader.Output(whole);
+
+			TransportCatalogue catalogue;
+			MapRenderer renderer;
+			JsonReader reader(catalogue, renderer);
+			std::ostringstream streamed;
+			reader.Process(text, streamed);
+
+			assert(streamed.str() == whole.str());
+			assert(Load(streamed.str()).GetRoot().AsArray().size() == 4);
+			// B is named before it is added, then added twice: the bus serves the last one
+			assert(catalogue.GetRoute("14")->stops[1] == catalogue.GetStop("B"));
+			assert(catalogue.GetStop("B") == catalogue.GetStop(static_cast<StopId>(catalogue.GetStopCount() - 1)));
+
+			bool thrown = false;
+			try {
+				reader.Process(R"({"base_requests": [], "render_settings": {}})", streamed);
+			}
+			catch (const std::out_of_range&) {
+				thrown = true;
+			}
+			assert(thrown);
 		}
 
 		void TestColorParsing() {
@@ -3,6 +3,11 @@
 #include "json.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "result_cache.h"
+#include "transport_router.h"
+
+#include <memory>
+#include <optional>
 
 using namespace json;
 using namespace transport;
@@ -17,30 +22,58 @@ namespace transport {
 			: catalogue_(catalogue), renderer_(renderer) {};
 	
 		void Input(std::istream& input);
+		// the whole document in memory, e.g. json::InputBuffer::GetText(); parses several times faster
+		void Input(std::string_view text);
 
 		void Output(std::ostream& output);
 
+		// Input and Output at once: each stat request is answered and printed as soon as it is read,
+		// so the first answer does not wait for the last request and answers are not kept
+		void Process(std::string_view text, std::ostream& output);
+
+		// bound of the stat answer cache, ResultCache::DEFAULT_MAX_BYTES by default; 0 turns it off
+		void SetCacheMaxBytes(size_t max_bytes);
+		ResultCache::Stats GetCacheStats() const;
+
 	private:
 		TransportCatalogue& catalogue_;
 		MapRenderer& renderer_;
 		Array answers_;
-
-		struct DistanceToStop {
-			std::string dest_stopname;
-			unsigned int distance;
-		};
+		router::RoutingSettings routing_settings_;
+		std::unique_ptr<router::TransportRouter> router_; // rebuilt when the catalogue version changes
+		std::unique_ptr<ConnectionScan> connection_scan_; // over the catalogue timetable, follows its growth
+		ResultCache cache_;
+		Dict render_settings_; // the cached answers were given with
 
 		void HandleBaseRequests(const Array& base_requests);
+		// the root object without base_requests, which go to the catalogue, and without stat_requests
+		// if a place is given for a reader at their value
+		Dict ReadRoot(EventReader& reader, bool& base_requests_handled, std::optional<EventReader>* stat_requests);
+		void HandleDocument(const Dict& root, bool base_requests_handled);
+		void HandleSettings(const Dict& root, bool base_requests_handled); // all but stat_requests
+		// base_requests from the reader, just after its key; the same catalogue as HandleBaseRequests builds.
+		// Buses, distances and trips are kept until the end of the array, linear in their stop count
+		void StreamBaseRequests(EventReader& reader);
 		void HandleRenderSettings(const Dict& render_settings);
+		void HandleRoutingSettings(const Dict& routing_settings);
+		void HandleDistanceSettings(const Dict& distance_settings);
+		void HandleCacheSettings(const Dict& cache_settings); // throws std::invalid_argument unless max_bytes is a byte count
 		void HandleStatRequests(const Array& stat_requests);
+		void StreamStatRequests(EventReader& reader, std::ostream& output);
+
+		const router::TransportRouter& GetRouter();
 
 		svg::Color ParseColor(const Node& color_node);
+		// "H:MM" or "H:MM:SS" <-> seconds from the start of the service day, hours may go past 24
+		uint32_t ParseTime(const Node& time_node);
+		std::string FormatTime(uint32_t seconds);
 
 	};
 
 	namespace jsonreader_tests {
 		void TestCornerCases();
 		void TestColorParsing();
+		void TestStreamingOutput();
 	}
 
 }
\ No newline at end of file
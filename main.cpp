@@ -1,20 +1,54 @@
 #include "json_reader.h"
 #include "request_handler.h"
+#include "input_buffer.h"
+#include "catalogue_snapshot.h"
+#include "catalogue_image.h"
 
 using namespace std;
 
 int main() {
     
-    /*jsonreader_tests::TestCornerCases();
-    jsonreader_tests::TestColorParsing();*/
-    /*tests::TestCommonCases();
-    tests::TestCornerCases();*/
+    /*transport::jsonreader_tests::TestCornerCases();
+    transport::jsonreader_tests::TestColorParsing();
+    transport::jsonreader_tests::TestStreamingOutput();*/
+    /*transport::tests::TestCommonCases();
+    transport::tests::TestCornerCases();
+    transport::tests::TestBulkLoad();
+    transport::tests::TestDistanceTable();
+    transport::tests::TestStopBusIndex();
+    transport::tests::TestStopSpatialIndex();
+    transport::tests::TestRouteSegmentIndex();
+    transport::tests::TestConnectionScan();
+    transport::tests::TestResultCache();
+    transport::graph::tests::TestDijkstraSearch();
+    transport::graph::tests::TestContractionHierarchy();
+    transport::router::tests::TestTransportRouter();
+    transport::tests::TestCataloguePublisher();
+    transport::image::tests::TestImageRoundTrip();
+    geo::tests::TestPreparedPoints();
+    geo::tests::TestDistanceModes();
+    json::tests::TestLoadBuffer();
+    json::tests::TestInputBuffer();
+    json::tests::TestEventReader();
+    json::tests::TestDict();
+    json::tests::TestArenaDocument();
+    json::tests::TestWriter();*/
+    //transport::router::tests::BenchmarkTransportRouter();
+    //transport::tests::BenchmarkConnectionScan();
+    //transport::tests::BenchmarkStopSpatialIndex();
+    //transport::tests::BenchmarkBulkLoad();
+    //geo::tests::BenchmarkPreparedPoints();
+    //geo::tests::BenchmarkDistanceModes();
+    //json::tests::BenchmarkLoad();
+    //json::tests::BenchmarkObjects();
+    //json::tests::BenchmarkArena();
+    //json::tests::BenchmarkWriter();
 
-    TransportCatalogue catalogue;
+    TransportCatalogue catalogue(AllocationMode::ARENA);
     MapRenderer renderer;
 
     JsonReader reader(catalogue, renderer);
-    reader.Input(std::cin);
-    reader.Output(std::cout);
+    const json::InputBuffer input = json::InputBuffer::FromStdin();
+    reader.Process(input.GetText(), std::cout);
 
 }
\ No newline at end of file
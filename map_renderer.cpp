@@ -6,12 +6,12 @@ namespace transport::renderer {
 		settings_ = std::move(settings);
 	}
 
-	void MapRenderer::AddStop(Stop stop) {
-		stops_.push_back(stop);
+	void MapRenderer::AddStop(const Stop& stop) {
+		stops_.push_back(&stop);
 	}
 
-	void MapRenderer::AddRoute(Bus route) {
-		buses_.push_back(route);
+	void MapRenderer::AddRoute(const Bus& route) {
+		buses_.push_back(&route);
 	}
 
 	size_t NextColorIndex(size_t current_index, const RendererSettings::ArrayColor& palette) {
@@ -29,9 +29,9 @@ namespace transport::renderer {
 		
 		size_t color_index = 0;
 		const auto& palette = std::get<RendererSettings::ArrayColor>(settings_.GetSetting("color_palette"));
-		for (const auto& route : buses_) {
+		for (const Bus* route : buses_) {
 
-			if (!route.stops.size()) continue;
+			if (!route->stops.size()) continue;
 
 			Polyline line;
 
@@ -43,7 +43,7 @@ namespace transport::renderer {
 			line.SetStrokeColor(palette[color_index]);
 			color_index = NextColorIndex(color_index, palette);
 
-			for (const auto stop_ptr : route.stops) {
+			for (const auto stop_ptr : route->stops) {
 				const svg::Point screen_coord = proj(stop_ptr->coords);
 				line.AddPoint({ screen_coord.x, screen_coord.y });
 			}
@@ -54,7 +54,7 @@ namespace transport::renderer {
 
 	}
 
-	svg::Text MapRenderer::GetRouteLabel(svg::Point pos, std::string name) const {
+	svg::Text MapRenderer::GetRouteLabel(svg::Point pos, std::string_view name) const {
 
 		using namespace svg;
 
@@ -66,12 +66,12 @@ namespace transport::renderer {
 		text.SetFontSize(static_cast<int>(std::get<double>(settings_.GetSetting("bus_label_font_size"))));
 		text.SetFontFamily("Verdana");
 		text.SetFontWeight("bold");
-		text.SetData(std::move(name));
+		text.SetData(std::string(name));
 
 		return text;
 	}
 
-	svg::Text MapRenderer::GetStopLabel(svg::Point pos, std::string name) const {
+	svg::Text MapRenderer::GetStopLabel(svg::Point pos, std::string_view name) const {
 
 		using namespace svg;
 
@@ -82,7 +82,7 @@ namespace transport::renderer {
 		text.SetOffset({ offset_arr[0], offset_arr[1] });
 		text.SetFontSize(static_cast<int>(std::get<double>(settings_.GetSetting("stop_label_font_size"))));
 		text.SetFontFamily("Verdana");
-		text.SetData(std::move(name));
+		text.SetData(std::string(name));
 
 		return text;
 	}
@@ -93,21 +93,21 @@ namespace transport::renderer {
 
 		size_t color_index = 0;
 		const auto& palette = std::get<RendererSettings::ArrayColor>(settings_.GetSetting("color_palette"));
-		for (const auto& route : buses_) {
+		for (const Bus* route : buses_) {
 
 			std::vector<const Stop*> labeled_stops;
-			if (route.stops.size()) {
-				const auto start_stop = route.stops[0];
+			if (route->stops.size()) {
+				const auto start_stop = route->stops[0];
 				labeled_stops.push_back(start_stop);
 				
 				size_t final_stop_index = 0;
-				if (route.isRing) {
-					final_stop_index = route.stops.size() - 1;
+				if (route->isRing) {
+					final_stop_index = route->stops.size() - 1;
 				}
 				else {
-					final_stop_index = route.stops.size()/2;
+					final_stop_index = route->stops.size()/2;
 				}
-				const auto final_stop = route.stops[final_stop_index];
+				const auto final_stop = route->stops[final_stop_index];
 				if (start_stop->name != final_stop->name) {
 					labeled_stops.push_back(final_stop);
 				}
@@ -117,7 +117,7 @@ namespace transport::renderer {
 				const svg::Point screen_coord = proj(stop_ptr->coords);
 				
 				// underlayer:
-				Text underlayer = GetRouteLabel(screen_coord, route.name);
+				Text underlayer = GetRouteLabel(screen_coord, route->name);
 				underlayer.SetFillColor(std::get<Color>(settings_.GetSetting("underlayer_color")));
 				underlayer.SetStrokeColor(std::get<Color>(settings_.GetSetting("underlayer_color")));
 				underlayer.SetStrokeWidth(std::get<double>(settings_.GetSetting("underlayer_width")));
@@ -125,7 +125,7 @@ namespace transport::renderer {
 				underlayer.SetStrokeLineJoin(StrokeLineJoin::ROUND);
 
 				// label
-				Text label = GetRouteLabel(screen_coord, route.name);
+				Text label = GetRouteLabel(screen_coord, route->name);
 				label.SetFillColor(palette[color_index]);
 
 				doc.Add(std::move(underlayer));
@@ -141,8 +141,8 @@ namespace transport::renderer {
 
 		using namespace svg;
 		
-		for (const auto& stop : stops_) {
-			const svg::Point screen_coord = proj(stop.coords);
+		for (const Stop* stop : stops_) {
+			const svg::Point screen_coord = proj(stop->coords);
 
 			Circle stop_shape;
 			stop_shape.SetCenter(screen_coord).SetRadius(std::get<double>(settings_.GetSetting("stop_radius")));
@@ -156,12 +156,12 @@ namespace transport::renderer {
 
 		using namespace svg;
 
-		for (const auto& stop : stops_) {
+		for (const Stop* stop : stops_) {
 
-			const svg::Point screen_coord = proj(stop.coords);
+			const svg::Point screen_coord = proj(stop->coords);
 
 			// underlayer:
-			Text underlayer = GetStopLabel(screen_coord, stop.name);
+			Text underlayer = GetStopLabel(screen_coord, stop->name);
 			underlayer.SetFillColor(std::get<Color>(settings_.GetSetting("underlayer_color")));
 			underlayer.SetStrokeColor(std::get<Color>(settings_.GetSetting("underlayer_color")));
 			underlayer.SetStrokeWidth(std::get<double>(settings_.GetSetting("underlayer_width")));
@@ -169,7 +169,7 @@ namespace transport::renderer {
 			underlayer.SetStrokeLineJoin(StrokeLineJoin::ROUND);
 
 			// label
-			Text label = GetStopLabel(screen_coord, stop.name);
+			Text label = GetStopLabel(screen_coord, stop->name);
 			label.SetFillColor("black");
 
 			doc.Add(std::move(underlayer));
@@ -184,9 +184,9 @@ namespace transport::renderer {
 
 		std::vector<geo::Coordinates> geo_coords;
 		
-		for (const auto& route : buses_) {
-			if (!route.stops.size()) continue;
-			for (const auto stop_ptr : route.stops) {
+		for (const Bus* route : buses_) {
+			if (!route->stops.size()) continue;
+			for (const auto stop_ptr : route->stops) {
 				geo_coords.push_back(stop_ptr->coords);
 			}
 		}
@@ -51,20 +51,21 @@ namespace transport {
         class MapRenderer {
 		public:
 			void SetSettings(RendererSettings settings);
-            void AddStop(Stop stop);
-			void AddRoute(Bus route);
+            // kept by pointer: stops and routes must outlive the renderer and its copies
+            void AddStop(const Stop& stop);
+			void AddRoute(const Bus& route);
 			svg::Document Render() const;
 		private:
 			RendererSettings settings_;
-            std::vector<Stop> stops_;
-            std::vector<Bus> buses_;
+            std::vector<const Stop*> stops_;
+            std::vector<const Bus*> buses_;
 
             void DrawRouteLines(svg::Document& doc, const SphereProjector& proj) const;
             void DrawRouteLabels(svg::Document& doc, const SphereProjector& proj) const;
             void DrawStopShapes(svg::Document& doc, const SphereProjector& proj) const;
             void DrawStopLabels(svg::Document& doc, const SphereProjector& proj) const;
-            svg::Text GetStopLabel(svg::Point pos, std::string name) const;
-            svg::Text GetRouteLabel(svg::Point stop_pos, std::string stop_name) const;
+            svg::Text GetStopLabel(svg::Point pos, std::string_view name) const;
+            svg::Text GetRouteLabel(svg::Point stop_pos, std::string_view stop_name) const;
 		};
 
 
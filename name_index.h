@@ -0,0 +1,114 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <deque>
+#include <vector>
+
+namespace transport {
+
+	// Items (Stop / Bus) in name order, without copying the names
+	template <typename Item>
+	class NameRange {
+	public:
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = const Item*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Item* const*;
+			using reference = const Item*;
+
+			Iterator(const uint32_t* pos, const std::pmr::deque<Item>* items)
+				: pos_(pos), items_(items) {}
+
+			const Item* operator*() const { return &(*items_)[*pos_]; }
+			Iterator& operator++() { ++pos_; return *this; }
+			Iterator operator++(int) { Iterator prev = *this; ++pos_; return prev; }
+			bool operator==(const Iterator& other) const { return pos_ == other.pos_; }
+			bool operator!=(const Iterator& other) const { return pos_ != other.pos_; }
+
+		private:
+			const uint32_t* pos_;
+			const std::pmr::deque<Item>* items_;
+		};
+
+		NameRange(const uint32_t* begin, const uint32_t* end, const std::pmr::deque<Item>& items)
+			: begin_(begin), end_(end), items_(&items) {}
+
+		Iterator begin() const { return { begin_, items_ }; }
+		Iterator end() const { return { end_, items_ }; }
+
+		size_t size() const { return end_ - begin_; }
+		bool empty() const { return begin_ == end_; }
+
+	private:
+		const uint32_t* begin_;
+		const uint32_t* end_;
+		const std::pmr::deque<Item>* items_;
+	};
+
+	// Ids sorted by the name of the item. New ids are sorted on their own by the next Build()
+	// and merged into the built order, so a build costs O(k log k + n) for k new items.
+	// A name added again keeps only its latest id, the one a lookup by name resolves to.
+	template <typename Item>
+	class NameIndex {
+	public:
+		void Add(uint32_t id) {
+			pending_.push_back(id);
+		}
+
+		bool HasPending() const {
+			return !pending_.empty();
+		}
+
+		// items: indexed by id
+		void Build(const std::pmr::deque<Item>& items, unsigned threads = 1) {
+
+			if (pending_.empty()) {
+				return;
+			}
+
+			const auto name_less = [&items](uint32_t lhs, uint32_t rhs) {
+				return items[lhs].name < items[rhs].name;
+			};
+
+			// ties keep the order of addition
+			utils::ParallelSort(pending_.begin(), pending_.end(), [&name_less](uint32_t lhs, uint32_t rhs) {
+				return name_less(lhs, rhs) || (!name_less(rhs, lhs) && lhs < rhs);
+				}, threads);
+
+			const size_t built = ids_.size();
+			ids_.insert(ids_.end(), pending_.begin(), pending_.end());
+			std::inplace_merge(ids_.begin(), ids_.begin() + built, ids_.end(), name_less);
+			pending_.clear();
+
+			// the last of equal names is the latest
+			size_t out = 0;
+			for (size_t i = 0; i < ids_.size(); ++i) {
+				if (out > 0 && items[ids_[out - 1]].name == items[ids_[i]].name) {
+					ids_[out - 1] = ids_[i];
+				}
+				else {
+					ids_[out++] = ids_[i];
+				}
+			}
+			ids_.resize(out);
+		}
+
+		// requires a build after the last Add
+		NameRange<Item> GetRange(const std::pmr::deque<Item>& items) const {
+			return { ids_.data(), ids_.data() + ids_.size(), items };
+		}
+
+	private:
+		std::vector<uint32_t> ids_;
+		std::vector<uint32_t> pending_;
+	};
+
+}
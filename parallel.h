@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace transport::utils {
+
+	inline unsigned DefaultThreadCount() {
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Splits [0, count) into at most "threads" contiguous chunks and calls func(begin, end)
+	// for each of them concurrently; the calling thread takes the first chunk
+	template <typename Func>
+	void ParallelFor(size_t count, unsigned threads, Func func) {
+
+		threads = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), count));
+		if (threads <= 1) {
+			func(size_t{ 0 }, count);
+			return;
+		}
+
+		const size_t chunk = (count + threads - 1) / threads;
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (size_t begin = chunk; begin < count; begin += chunk) {
+			workers.emplace_back(func, begin, std::min(begin + chunk, count));
+		}
+		func(size_t{ 0 }, chunk);
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	// Sorts chunks concurrently, then merges them pairwise; not stable
+	template <typename RandomIt, typename Compare>
+	void ParallelSort(RandomIt first, RandomIt last, Compare comp, unsigned threads) {
+
+		const size_t size = std::distance(first, last);
+		constexpr size_t MIN_CHUNK = 1 << 14;
+		threads = static_cast<unsigned>(std::min<size_t>(threads, size / MIN_CHUNK));
+		if (threads <= 1) {
+			std::sort(first, last, comp);
+			return;
+		}
+
+		std::vector<RandomIt> bounds(threads + 1);
+		for (unsigned i = 0; i <= threads; ++i) {
+			bounds[i] = first + size * i / threads;
+		}
+
+		ParallelFor(threads, threads, [&bounds, &comp](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				std::sort(bounds[i], bounds[i + 1], comp);
+			}
+			});
+
+		for (size_t width = 1; width < threads; width *= 2) {
+			const size_t merges = (threads + 2 * width - 1) / (2 * width);
+			ParallelFor(merges, threads, [&bounds, &comp, width, threads](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					const size_t left = 2 * width * i;
+					const size_t middle = std::min<size_t>(left + width, threads);
+					const size_t right = std::min<size_t>(left + 2 * width, threads);
+					std::inplace_merge(bounds[left], bounds[middle], bounds[right], comp);
+				}
+				});
+		}
+	}
+
+	// Objects kept for reuse by concurrent callers, e.g. search buffers: every Acquire hands out
+	// one nobody else holds, creating it only when all are taken. So each thread ends up with
+	// its own and repeated calls do not allocate.
+	template <typename T>
+	class ObjectPool {
+	public:
+		class Handle {
+		public:
+			Handle(ObjectPool& pool, std::unique_ptr<T> object)
+				: pool_(pool)
+				, object_(std::move(object))
+			{
+			}
+			Handle(const Handle&) = delete;
+			Handle& operator=(const Handle&) = delete;
+			~Handle() {
+				pool_.Release(std::move(object_));
+			}
+
+			T& operator*() const { return *object_; }
+			T* operator->() const { return object_.get(); }
+
+		private:
+			ObjectPool& pool_;
+			std::unique_ptr<T> object_;
+		};
+
+		// make() creates an object if none is free
+		template <typename Factory>
+		Handle Acquire(Factory make) {
+			{
+				std::lock_guard guard(mutex_);
+				if (!free_.empty()) {
+					std::unique_ptr<T> object = std::move(free_.back());
+					free_.pop_back();
+					return Handle(*this, std::move(object));
+				}
+			}
+			return Handle(*this, make());
+		}
+
+		// drops the free objects; none may be held at the time
+		void Clear() {
+			std::lock_guard guard(mutex_);
+			free_.clear();
+		}
+
+	private:
+		void Release(std::unique_ptr<T> object) {
+			std::lock_guard guard(mutex_);
+			free_.push_back(std::move(object));
+		}
+
+	private:
+		std::mutex mutex_;
+		std::vector<std::unique_ptr<T>> free_;
+	};
+
+}
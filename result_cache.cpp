@@ -0,0 +1,225 @@
+#include "result_cache.h"
+
+#include <cassert>
+#include <cstdio>
+
+namespace transport {
+
+	using namespace std;
+
+	namespace {
+		// a std::string keeps up to 15 chars inline
+		constexpr size_t SSO_CAPACITY = 15;
+		// heap node of std::unordered_map / std::list besides the value
+		constexpr size_t NODE_OVERHEAD = 4 * sizeof(void*);
+
+		template <typename Allocator>
+		size_t StringHeap(const basic_string<char, char_traits<char>, Allocator>& text) {
+			return text.capacity() > SSO_CAPACITY ? text.capacity() + 1 : 0;
+		}
+
+		void AppendKey(const json::Node& node, string& key) {
+			if (node.IsNull()) {
+				key += 'n';
+			}
+			else if (node.IsBool()) {
+				key += node.AsBool() ? 't' : 'f';
+			}
+			else if (node.IsDouble()) {
+				// 500 and 500.0 are the same number
+				char buffer[32];
+				key += '#';
+				key.append(buffer, snprintf(buffer, sizeof(buffer), "%.17g", node.AsDouble()));
+				key += ';';
+			}
+			else if (node.IsString()) {
+				// length prefixed, so no escaping is needed
+				key += '"';
+				key += to_string(node.AsString().size());
+				key += ':';
+				key += node.AsString();
+			}
+			else if (node.IsArray()) {
+				key += '[';
+				for (const json::Node& item : node.AsArray()) {
+					AppendKey(item, key);
+				}
+				key += ']';
+			}
+			else {
+				key += '{';
+				for (const auto& [name, value] : node.AsMap()) {
+					AppendKey(name, key);
+					AppendKey(value, key);
+				}
+				key += '}';
+			}
+		}
+	}
+
+	ResultCache::ResultCache(size_t max_bytes)
+		: max_bytes_(max_bytes)
+	{
+	}
+
+	void ResultCache::SetMaxBytes(size_t max_bytes) {
+		max_bytes_ = max_bytes;
+		EvictTo(max_bytes_);
+	}
+
+	size_t ResultCache::GetMaxBytes() const {
+		return max_bytes_;
+	}
+
+	std::string ResultCache::MakeKey(const json::Dict& request) {
+		string key;
+		key += '{';
+		for (const auto& [name, value] : request) {
+			if (name != "id") {
+				AppendKey(name, key);
+				AppendKey(value, key);
+			}
+		}
+		key += '}';
+		return key;
+	}
+
+	const json::Dict* ResultCache::Find(const std::string& key, uint64_t version) {
+		SetVersion(version);
+
+		const auto it = index_.find(key);
+		if (it == index_.end()) {
+			++stats_.misses;
+			return nullptr;
+		}
+		++stats_.hits;
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return &it->second->answer;
+	}
+
+	void ResultCache::Insert(std::string key, uint64_t version, json::Dict answer) {
+		SetVersion(version);
+
+		if (const auto it = index_.find(key); it != index_.end()) {
+			stats_.bytes -= it->second->bytes;
+			entries_.erase(it->second);
+			index_.erase(it);
+		}
+
+		const size_t bytes = sizeof(Entry) + NODE_OVERHEAD + StringHeap(key) + EstimateSize(answer)
+			+ sizeof(pair<string_view, list<Entry>::iterator>) + NODE_OVERHEAD;
+		if (bytes > max_bytes_) {
+			return;
+		}
+		EvictTo(max_bytes_ - bytes);
+
+		entries_.push_front({ move(key), move(answer), bytes });
+		index_.emplace(entries_.front().key, entries_.begin());
+		stats_.bytes += bytes;
+		stats_.entries = entries_.size();
+	}
+
+	void ResultCache::Clear() {
+		index_.clear();
+		entries_.clear();
+		stats_.bytes = 0;
+		stats_.entries = 0;
+	}
+
+	ResultCache::Stats ResultCache::GetStats() const {
+		return stats_;
+	}
+
+	size_t ResultCache::EstimateSize(const json::Node& node) {
+		size_t bytes = sizeof(json::Node);
+		if (node.IsString()) {
+			bytes += StringHeap(node.AsString());
+		}
+		else if (node.IsArray()) {
+			const json::Array& array = node.AsArray();
+			bytes += (array.capacity() - array.size()) * sizeof(json::Node);
+			for (const json::Node& item : array) {
+				bytes += EstimateSize(item);
+			}
+		}
+		else if (node.IsMap()) {
+			const json::Dict& dict = node.AsMap();
+			bytes += (dict.capacity() - dict.size()) * sizeof(json::Dict::value_type);
+			for (const auto& [key, value] : dict) {
+				bytes += sizeof(string) + StringHeap(key) + EstimateSize(value);
+			}
+		}
+		return bytes;
+	}
+
+	void ResultCache::SetVersion(uint64_t version) {
+		if (version != version_) {
+			Clear();
+			version_ = version;
+		}
+	}
+
+	void ResultCache::EvictTo(size_t max_bytes) {
+		while (stats_.bytes > max_bytes) {
+			const Entry& last = entries_.back();
+			stats_.bytes -= last.bytes;
+			index_.erase(last.key);
+			entries_.pop_back();
+			++stats_.evictions;
+		}
+		stats_.entries = entries_.size();
+	}
+
+	namespace tests {
+		void TestResultCache()
+		{
+			using namespace std::literals;
+
+			// keys ignore the id and the way a number is written
+			const json::Dict bus{ { "id"s, 1 }, { "type"s, "Bus"s }, { "name"s, "14"s } };
+			assert(ResultCache::MakeKey(bus) == ResultCache::MakeKey({ { "id"s, 2 }, { "type"s, "Bus"s }, { "name"s, "14"s } }));
+			assert(ResultCache::MakeKey(bus) != ResultCache::MakeKey({ { "type"s, "Stop"s }, { "name"s, "14"s } }));
+			assert(ResultCache::MakeKey({ { "radius"s, 500 } }) == ResultCache::MakeKey({ { "radius"s, 500.0 } }));
+			assert(ResultCache::MakeKey({ { "a"s, "b"s } }) != ResultCache::MakeKey({ { "a"s, json::Array{ "b"s } } }));
+
+			const json::Dict answer{ { "route_length"s, 9300 }, { "stop_count"s, 4 } };
+			const size_t entry_bytes = [&answer] {
+				ResultCache probe(1 << 20);
+				probe.Insert("k1", 0, answer);
+				return probe.GetStats().bytes;
+			}();
+
+			// room for exactly two entries
+			ResultCache cache(entry_bytes * 2);
+			assert(!cache.Find("k1", 7));
+			cache.Insert("k1", 7, answer);
+			cache.Insert("k2", 7, answer);
+			assert(cache.Find("k1", 7) && *cache.Find("k1", 7) == answer); // k1 is now the most recent
+			cache.Insert("k3", 7, answer); // evicts k2
+			assert(!cache.Find("k2", 7) && cache.Find("k1", 7) && cache.Find("k3", 7));
+
+			ResultCache::Stats stats = cache.GetStats();
+			assert(stats.hits == 4 && stats.misses == 2 && stats.evictions == 1);
+			assert(stats.entries == 2 && stats.bytes == entry_bytes * 2);
+
+			// re-inserting a key replaces the answer
+			cache.Insert("k3", 7, json::Dict{ { "x"s, 1 } });
+			assert(cache.Find("k3", 7)->count("x") && cache.GetStats().entries == 2);
+
+			// an answer bigger than the bound is not kept
+			cache.Insert("huge", 7, json::Dict{ { "map"s, std::string(entry_bytes * 4, 'x') } });
+			assert(!cache.Find("huge", 7) && cache.GetStats().entries == 2);
+
+			// a new catalogue version drops everything
+			assert(!cache.Find("k1", 8));
+			assert(cache.GetStats().entries == 0 && cache.GetStats().bytes == 0);
+
+			cache.Insert("k1", 8, answer);
+			cache.SetMaxBytes(0);
+			assert(!cache.Find("k1", 8) && cache.GetStats().evictions == 2);
+			cache.Insert("k1", 8, answer);
+			assert(cache.GetStats().entries == 0);
+		}
+	}
+
+}
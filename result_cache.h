@@ -0,0 +1,70 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace transport {
+
+	// Least recently used answers to stat requests, ready to be printed, bounded by the memory
+	// they take (estimated). Answers belong to one catalogue version: a lookup or insertion
+	// with another version drops them all.
+	class ResultCache {
+	public:
+		static constexpr size_t DEFAULT_MAX_BYTES = 32 << 20;
+
+		struct Stats {
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0; // to fit the bound; dropping on a version change or Clear is not counted
+			size_t entries = 0;
+			size_t bytes = 0;
+		};
+
+		explicit ResultCache(size_t max_bytes = DEFAULT_MAX_BYTES);
+
+		// 0 turns the cache off; evicts down to the new bound
+		void SetMaxBytes(size_t max_bytes);
+		size_t GetMaxBytes() const;
+
+		// every field of the request but "id", in a canonical form
+		static std::string MakeKey(const json::Dict& request);
+
+		// nullptr on a miss; valid until the next non-const call
+		const json::Dict* Find(const std::string& key, uint64_t version);
+		// an answer larger than the whole bound is not kept
+		void Insert(std::string key, uint64_t version, json::Dict answer);
+		void Clear();
+
+		Stats GetStats() const;
+
+		// heap and inline bytes of the node, roughly as libstdc++ and MSVC lay them out
+		static size_t EstimateSize(const json::Node& node);
+
+	private:
+		struct Entry {
+			std::string key;
+			json::Dict answer;
+			size_t bytes;
+		};
+
+		void SetVersion(uint64_t version);
+		void EvictTo(size_t max_bytes);
+
+	private:
+		size_t max_bytes_;
+		uint64_t version_ = 0;
+		std::list<Entry> entries_; // most recently used first
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index_; // keys refer to entries_
+		Stats stats_;
+	};
+
+	namespace tests {
+		void TestResultCache();
+	}
+
+}
@@ -0,0 +1,328 @@
+#include "route_segment_index.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+namespace transport {
+
+	using namespace std;
+
+	namespace {
+		constexpr double EARTH_RADIUS = 6371000;
+		constexpr double DEG_TO_RAD = 3.14159265358979323846 / 180.;
+		constexpr double FULL_CIRCLE = 360;
+
+		double WrapLng(double lng) {
+			lng = fmod(lng + 180, FULL_CIRCLE);
+			return (lng < 0 ? lng + FULL_CIRCLE : lng) - 180;
+		}
+
+		// on the plane tangent at the center, in meters
+		double PlanarDistance(::geo::Coordinates center, ::geo::Coordinates from, ::geo::Coordinates to) {
+			const double lng_scale = cos(center.lat * DEG_TO_RAD) * EARTH_RADIUS * DEG_TO_RAD;
+			const double lat_scale = EARTH_RADIUS * DEG_TO_RAD;
+			const double ax = WrapLng(from.lng - center.lng) * lng_scale;
+			const double ay = (from.lat - center.lat) * lat_scale;
+			const double dx = (to.lng - from.lng) * lng_scale;
+			const double dy = (to.lat - from.lat) * lat_scale;
+			const double length2 = dx * dx + dy * dy;
+			const double t = length2 > 0 ? clamp(-(ax * dx + ay * dy) / length2, 0., 1.) : 0.;
+			return hypot(ax + t * dx, ay + t * dy);
+		}
+
+		// Liang-Barsky clipping of the segment by the box, lng as x and lat as y
+		bool SegmentMeetsBox(::geo::Coordinates from, ::geo::Coordinates to, double lat_lo, double lat_hi, double lng_lo, double lng_hi) {
+			double t_lo = 0;
+			double t_hi = 1;
+			const auto clip = [&](double start, double delta, double lo, double hi) {
+				if (delta == 0) {
+					return start >= lo && start <= hi;
+				}
+				double t1 = (lo - start) / delta;
+				double t2 = (hi - start) / delta;
+				if (t1 > t2) {
+					swap(t1, t2);
+				}
+				t_lo = max(t_lo, t1);
+				t_hi = min(t_hi, t2);
+				return t_lo <= t_hi;
+			};
+			return clip(from.lng, to.lng - from.lng, lng_lo, lng_hi) && clip(from.lat, to.lat - from.lat, lat_lo, lat_hi);
+		}
+	}
+
+	void RouteSegmentIndex::Build(const std::pmr::deque<Bus>& routes, unsigned threads) {
+
+		route_count_ = routes.size();
+		segments_.clear();
+		levels_.clear();
+
+		// a non-ring route comes back the same way, so only its way there is indexed;
+		// a route of a single stop is a segment of zero length
+		const auto segment_count = [](const Bus& route) {
+			const size_t stops = route.stops.size();
+			if (stops <= 1) {
+				return stops;
+			}
+			return route.isRing ? stops - 1 : stops / 2;
+		};
+		vector<size_t> offsets(routes.size() + 1, 0);
+		for (size_t id = 0; id < routes.size(); ++id) {
+			offsets[id + 1] = offsets[id] + segment_count(routes[id]);
+		}
+		if (offsets.back() == 0) {
+			return;
+		}
+
+		segments_.resize(offsets.back());
+		utils::ParallelFor(routes.size(), threads, [&](size_t begin, size_t end) {
+			for (size_t id = begin; id < end; ++id) {
+				const auto& stops = routes[id].stops;
+				for (size_t i = 0; i < offsets[id + 1] - offsets[id]; ++i) {
+					const ::geo::Coordinates from = stops[i]->coords;
+					::geo::Coordinates to = stops[min(i + 1, stops.size() - 1)]->coords;
+					to.lng = from.lng + WrapLng(to.lng - from.lng); // the short way round
+					segments_[offsets[id] + i] = { from, to, static_cast<BusId>(id) };
+				}
+			}
+			});
+
+		// slices of about sqrt(leaves) leaves each, by longitude, then every slice by latitude
+		const auto center_lng = [](const Segment& segment) { return segment.from.lng + segment.to.lng; };
+		const auto center_lat = [](const Segment& segment) { return segment.from.lat + segment.to.lat; };
+		utils::ParallelSort(segments_.begin(), segments_.end(), [&center_lng](const Segment& lhs, const Segment& rhs) {
+			return center_lng(lhs) < center_lng(rhs);
+			}, threads);
+
+		const size_t leaves = (segments_.size() + NODE_SIZE - 1) / NODE_SIZE;
+		const size_t slice = static_cast<size_t>(ceil(sqrt(static_cast<double>(leaves)))) * NODE_SIZE;
+		const size_t slices = (segments_.size() + slice - 1) / slice;
+		utils::ParallelFor(slices, threads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				sort(segments_.begin() + i * slice, segments_.begin() + min((i + 1) * slice, segments_.size()),
+					[&center_lat](const Segment& lhs, const Segment& rhs) {
+						return center_lat(lhs) < center_lat(rhs);
+					});
+			}
+			});
+
+		const auto merge = [](Box& box, const Box& other) {
+			box.lat_lo = min(box.lat_lo, other.lat_lo);
+			box.lat_hi = max(box.lat_hi, other.lat_hi);
+			box.lng_lo = min(box.lng_lo, other.lng_lo);
+			box.lng_hi = max(box.lng_hi, other.lng_hi);
+		};
+
+		levels_.emplace_back(leaves);
+		utils::ParallelFor(leaves, threads, [&](size_t begin, size_t end) {
+			for (size_t node = begin; node < end; ++node) {
+				Box& box = levels_[0][node];
+				box = BoxOf(segments_[node * NODE_SIZE]);
+				for (size_t i = node * NODE_SIZE + 1; i < min((node + 1) * NODE_SIZE, segments_.size()); ++i) {
+					merge(box, BoxOf(segments_[i]));
+				}
+			}
+			});
+
+		while (levels_.back().size() > 1) {
+			const vector<Box>& children = levels_.back();
+			vector<Box> parents((children.size() + NODE_SIZE - 1) / NODE_SIZE);
+			for (size_t node = 0; node < parents.size(); ++node) {
+				parents[node] = children[node * NODE_SIZE];
+				for (size_t i = node * NODE_SIZE + 1; i < min((node + 1) * NODE_SIZE, children.size()); ++i) {
+					merge(parents[node], children[i]);
+				}
+			}
+			levels_.push_back(move(parents));
+		}
+	}
+
+	size_t RouteSegmentIndex::GetRouteCount() const {
+		return route_count_;
+	}
+
+	RouteSegmentIndex::Box RouteSegmentIndex::BoxOf(const Segment& segment) {
+		return {
+			min(segment.from.lat, segment.to.lat), max(segment.from.lat, segment.to.lat),
+			min(segment.from.lng, segment.to.lng), max(segment.from.lng, segment.to.lng)
+		};
+	}
+
+	template <typename Visit>
+	void RouteSegmentIndex::Search(const Box& box, size_t level, size_t node, Visit& visit) const {
+
+		const auto meets = [&box](const Box& other) {
+			return other.lat_lo <= box.lat_hi && other.lat_hi >= box.lat_lo && other.lng_lo <= box.lng_hi && other.lng_hi >= box.lng_lo;
+		};
+		if (!meets(levels_[level][node])) {
+			return;
+		}
+
+		const size_t first = node * NODE_SIZE;
+		if (level == 0) {
+			for (size_t i = first; i < min(first + NODE_SIZE, segments_.size()); ++i) {
+				if (meets(BoxOf(segments_[i]))) {
+					visit(segments_[i]);
+				}
+			}
+			return;
+		}
+		for (size_t child = first; child < min(first + NODE_SIZE, levels_[level - 1].size()); ++child) {
+			Search(box, level - 1, child, visit);
+		}
+	}
+
+	template <typename Visit>
+	void RouteSegmentIndex::SearchWrapped(Box box, Visit visit) const {
+		if (levels_.empty()) {
+			return;
+		}
+		// stored segments stay within a half circle past +-180
+		box.lng_lo -= FULL_CIRCLE;
+		box.lng_hi -= FULL_CIRCLE;
+		for (int shift = -1; shift <= 1; ++shift) {
+			Search(box, levels_.size() - 1, 0, visit);
+			box.lng_lo += FULL_CIRCLE;
+			box.lng_hi += FULL_CIRCLE;
+		}
+	}
+
+	std::vector<BusId> RouteSegmentIndex::FindNear(::geo::Coordinates center, double meters) const {
+
+		const double dlat = meters / (EARTH_RADIUS * DEG_TO_RAD);
+		const double cos_lat = cos(min(abs(center.lat) + dlat, 90.) * DEG_TO_RAD);
+		const double dlng = cos_lat * 180 > dlat ? dlat / cos_lat : 180.;
+		const Box box{ center.lat - dlat, center.lat + dlat, center.lng - dlng, center.lng + dlng };
+
+		vector<BusId> result;
+		auto visit = [&](const Segment& segment) {
+			if (PlanarDistance(center, segment.from, segment.to) <= meters) {
+				result.push_back(segment.bus);
+			}
+		};
+		SearchWrapped(box, visit);
+
+		sort(result.begin(), result.end());
+		result.erase(unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+
+	std::vector<BusId> RouteSegmentIndex::FindInBox(::geo::Coordinates south_west, ::geo::Coordinates north_east) const {
+
+		Box box{ south_west.lat, north_east.lat, south_west.lng, north_east.lng };
+		if (box.lng_lo > box.lng_hi) {
+			box.lng_hi += FULL_CIRCLE;
+		}
+
+		vector<BusId> result;
+		auto visit = [&](const Segment& segment) {
+			// the box may be met in any of its shifted copies, so each is tried
+			for (double shift : { -FULL_CIRCLE, 0., FULL_CIRCLE }) {
+				if (SegmentMeetsBox(segment.from, segment.to, box.lat_lo, box.lat_hi, box.lng_lo + shift, box.lng_hi + shift)) {
+					result.push_back(segment.bus);
+					return;
+				}
+			}
+		};
+		SearchWrapped(box, visit);
+
+		sort(result.begin(), result.end());
+		result.erase(unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+
+	namespace tests {
+		void TestRouteSegmentIndex()
+		{
+			std::pmr::deque<Stop> stops;
+			std::pmr::deque<Bus> routes;
+			const auto add_route = [&](std::vector<::geo::Coordinates> coords, bool is_ring) {
+				Bus route{ {}, {}, is_ring, static_cast<BusId>(routes.size()) };
+				for (const auto& point : coords) {
+					stops.push_back({ {}, point, static_cast<StopId>(stops.size()) });
+					route.stops.push_back(&stops.back());
+				}
+				if (!is_ring && coords.size() > 1) {
+					for (size_t i = coords.size() - 1; i-- > 0; ) {
+						route.stops.push_back(route.stops[i]);
+					}
+				}
+				routes.push_back(std::move(route));
+			};
+
+			// 0: a line along the parallel 55 from 37.0 to 37.1, 1: a triangle, 2: a single stop,
+			// 3: across the antimeridian, 4: no stops
+			add_route({ { 55, 37.0 }, { 55, 37.1 } }, false);
+			add_route({ { 55.01, 37.05 }, { 55.02, 37.06 }, { 55.01, 37.07 }, { 55.01, 37.05 } }, true);
+			add_route({ { 55.005, 37.2 } }, true);
+			add_route({ { -17, 179.9 }, { -17, -179.9 } }, false);
+			add_route({}, true);
+
+			RouteSegmentIndex index;
+			index.Build(routes);
+			assert(index.GetRouteCount() == 5);
+
+			// the middle of the line is far from both of its stops
+			assert((index.FindNear({ 55.001, 37.05 }, 200) == std::vector<BusId>{ 0 }));
+			assert(index.FindNear({ 55.003, 37.05 }, 200).empty());
+			assert((index.FindNear({ 55.005, 37.05 }, 1200) == std::vector<BusId>{ 0, 1 }));
+			assert((index.FindNear({ 55.005, 37.2 }, 10) == std::vector<BusId>{ 2 }));
+			assert((index.FindNear({ -17, 180 }, 100) == std::vector<BusId>{ 3 }));
+			assert((index.FindNear({ -17.0005, -179.99 }, 100) == std::vector<BusId>{ 3 }));
+
+			// the box between the stops of the line still meets it
+			assert((index.FindInBox({ 54.99, 37.04 }, { 55.001, 37.06 }) == std::vector<BusId>{ 0 }));
+			assert((index.FindInBox({ 54.9, 36 }, { 56, 38 }) == std::vector<BusId>{ 0, 1, 2 }));
+			assert((index.FindInBox({ -18, 179.95 }, { -16, -179.95 }) == std::vector<BusId>{ 3 }));
+			assert(index.FindInBox({ 55.012, 37.059 }, { 55.013, 37.061 }).empty()); // inside the triangle, off its sides
+
+			// many routes agree with checking every segment
+			std::mt19937 generator(5);
+			std::uniform_real_distribution<double> lat(55.5, 56), lng(37.3, 38), step(-0.01, 0.01);
+			routes.clear();
+			for (int i = 0; i < 3000; ++i) {
+				std::vector<::geo::Coordinates> coords{ { lat(generator), lng(generator) } };
+				for (int j = 0; j < i % 9; ++j) {
+					coords.push_back({ coords.back().lat + step(generator), coords.back().lng + step(generator) });
+				}
+				if (i % 2 && coords.size() > 1) {
+					coords.push_back(coords.front());
+				}
+				add_route(coords, i % 2);
+			}
+			RouteSegmentIndex big_index;
+			big_index.Build(routes, 4);
+
+			for (int query = 0; query < 100; ++query) {
+				const ::geo::Coordinates center{ lat(generator), lng(generator) };
+				const double meters = 50 + query * 10;
+				const ::geo::Coordinates corner{ center.lat + step(generator), center.lng + step(generator) };
+				const ::geo::Coordinates south_west{ std::min(center.lat, corner.lat), std::min(center.lng, corner.lng) };
+				const ::geo::Coordinates north_east{ std::max(center.lat, corner.lat), std::max(center.lng, corner.lng) };
+
+				std::vector<BusId> near, in_box;
+				for (const Bus& route : routes) {
+					bool is_near = false, is_in_box = false;
+					for (size_t i = 0; i < route.stops.size(); ++i) {
+						const auto from = route.stops[i]->coords;
+						const auto to = route.stops[std::min(i + 1, route.stops.size() - 1)]->coords;
+						is_near = is_near || PlanarDistance(center, from, to) <= meters;
+						is_in_box = is_in_box || SegmentMeetsBox(from, to, south_west.lat, north_east.lat, south_west.lng, north_east.lng);
+					}
+					if (is_near) {
+						near.push_back(route.id);
+					}
+					if (is_in_box) {
+						in_box.push_back(route.id);
+					}
+				}
+				assert(big_index.FindNear(center, meters) == near);
+				assert(big_index.FindInBox(south_west, north_east) == in_box);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "domain.h"
+#include "geo.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <vector>
+
+namespace transport {
+
+	// Static R-tree over the segments between consecutive stops of every route, bulk loaded
+	// by Sort-Tile-Recursive: segments sorted into vertical slices, every slice by latitude,
+	// then packed NODE_SIZE to a node level by level. A segment is a straight line in lat/lng;
+	// one crossing the antimeridian is kept as going past +-180.
+	class RouteSegmentIndex {
+	public:
+		void Build(const std::pmr::deque<Bus>& routes, unsigned threads = 1); // routes: indexed by BusId
+		size_t GetRouteCount() const; // as of the last build
+
+		// Bus ids in ascending order, each once.
+		// Distance is measured on a plane tangent at the center, which is exact enough for city radii.
+		std::vector<BusId> FindNear(::geo::Coordinates center, double meters) const;
+		// west > east is a box across the antimeridian
+		std::vector<BusId> FindInBox(::geo::Coordinates south_west, ::geo::Coordinates north_east) const;
+
+	private:
+		static constexpr size_t NODE_SIZE = 16;
+
+		struct Box {
+			double lat_lo;
+			double lat_hi;
+			double lng_lo;
+			double lng_hi;
+		};
+
+		struct Segment {
+			::geo::Coordinates from;
+			::geo::Coordinates to;
+			BusId bus;
+		};
+
+		static Box BoxOf(const Segment& segment);
+		// calls visit(segment) for every segment whose box meets "box"
+		template <typename Visit>
+		void Search(const Box& box, size_t level, size_t node, Visit& visit) const;
+		// "box" and its copies shifted by 360 degrees, for segments stored past +-180
+		template <typename Visit>
+		void SearchWrapped(Box box, Visit visit) const;
+
+	private:
+		size_t route_count_ = 0;
+		std::vector<Segment> segments_; // in leaf order
+		std::vector<std::vector<Box>> levels_; // levels_[0]: a box per NODE_SIZE segments, ..., the root is last
+	};
+
+	namespace tests {
+		void TestRouteSegmentIndex();
+	}
+
+}
@@ -0,0 +1,386 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <utility>
+
+namespace transport {
+
+	using namespace std;
+
+	namespace {
+		constexpr double EARTH_RADIUS = 6371000;
+		constexpr double DEG_TO_RAD = 3.14159265358979323846 / 180.;
+		constexpr uint32_t LEAF_SIZE = 8; // stops
+		// geo::ComputeDistance goes through acos, which loses ~0.1 m near zero; bounds are lowered by this much
+		constexpr double BOUND_SLACK = 1;
+
+		double Distance(::geo::Coordinates from, ::geo::Coordinates to, ::geo::DistanceMode mode) {
+			const double distance = ::geo::ComputeDistance(from, to, mode);
+			return distance >= 0 ? distance : 0; // acos of a rounded 1 + eps
+		}
+
+		// angle between lng and the closest point of [lo, hi], in degrees, wrapped to [0, 180]
+		double LngGap(double lng, double lo, double hi) {
+			if (hi - lo >= 360 || (lng >= lo && lng <= hi)) {
+				return 0;
+			}
+			const auto wrap = [](double angle) {
+				angle = fmod(angle, 360.);
+				return angle < 0 ? angle + 360 : angle;
+			};
+			return min({ wrap(lo - lng), wrap(lng - hi), 180. });
+		}
+
+		// every term of the distance formula taken at its minimum over the box
+		double LowerBound(::geo::Coordinates point, double lat_lo, double lat_hi, double lng_lo, double lng_hi, ::geo::DistanceMode mode) {
+
+			const double dlat = max({ 0., lat_lo - point.lat, point.lat - lat_hi }) * DEG_TO_RAD;
+			const double dlng = LngGap(point.lng, lng_lo, lng_hi) * DEG_TO_RAD;
+			lat_lo = clamp(lat_lo, -90., 90.);
+			lat_hi = clamp(lat_hi, -90., 90.);
+
+			if (mode == ::geo::DistanceMode::EQUIRECTANGULAR) {
+				// d = R * sqrt(dlat^2 + (dlng * cos(mean lat))^2); cos of the mean is smallest at an end of the box
+				const double cos_mean = max(0., min(cos((point.lat + lat_lo) / 2 * DEG_TO_RAD), cos((point.lat + lat_hi) / 2 * DEG_TO_RAD)));
+				return EARTH_RADIUS * hypot(dlat, dlng * cos_mean) - BOUND_SLACK;
+			}
+
+			// hav(d) = hav(dlat) + cos(lat1) * cos(lat2) * hav(dlng); bounds the exact distance as well
+			const double cos_box = max(0., min(cos(lat_lo * DEG_TO_RAD), cos(lat_hi * DEG_TO_RAD)));
+			const double sin_lat = sin(dlat / 2);
+			const double sin_lng = sin(dlng / 2);
+			const double hav = sin_lat * sin_lat + cos(point.lat * DEG_TO_RAD) * cos_box * sin_lng * sin_lng;
+			return 2 * EARTH_RADIUS * asin(sqrt(min(1., hav))) - BOUND_SLACK;
+		}
+
+		bool NearbyLess(const NearbyStop& lhs, const NearbyStop& rhs) {
+			return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.id < rhs.id);
+		}
+	}
+
+	void StopSpatialIndex::Build(const std::vector<::geo::Coordinates>& coords, ::geo::DistanceMode mode) {
+
+		mode_ = mode;
+		nodes_.clear();
+		coords_.clear();
+		ids_.clear();
+		if (coords.empty()) {
+			return;
+		}
+
+		// partitioned as whole records, in place
+		vector<pair<::geo::Coordinates, StopId>> stops(coords.size());
+		constexpr double INF = numeric_limits<double>::infinity();
+		Box bounds{ INF, -INF, INF, -INF };
+		for (size_t id = 0; id < coords.size(); ++id) {
+			const auto& point = coords[id];
+			stops[id] = { point, static_cast<StopId>(id) };
+			bounds = { min(bounds.lat_lo, point.lat), max(bounds.lat_hi, point.lat), min(bounds.lng_lo, point.lng), max(bounds.lng_hi, point.lng) };
+		}
+
+		// bounds hold the stops of the node, not tightly: they are the bounds of the parent cut at
+		// the median, enough to choose the side to halve. The box of a node is that of its children.
+		nodes_.reserve(2 * (coords.size() / LEAF_SIZE) + 1);
+		const auto build = [&](const auto& self, uint32_t begin, uint32_t end, Box bounds) -> uint32_t {
+			const uint32_t node = static_cast<uint32_t>(nodes_.size());
+			nodes_.push_back({ { INF, -INF, INF, -INF }, begin, end, 0 });
+			if (end - begin <= LEAF_SIZE) {
+				Box& box = nodes_[node].box;
+				for (uint32_t pos = begin; pos < end; ++pos) {
+					const auto& point = stops[pos].first;
+					box = { min(box.lat_lo, point.lat), max(box.lat_hi, point.lat), min(box.lng_lo, point.lng), max(box.lng_hi, point.lng) };
+				}
+				return node;
+			}
+
+			// halved along the wider side in meters, so a long street or a thin cluster is cut across
+			const double lat_span = bounds.lat_hi - bounds.lat_lo;
+			const double lng_span = (bounds.lng_hi - bounds.lng_lo) * cos((bounds.lat_lo + bounds.lat_hi) / 2 * DEG_TO_RAD);
+			const bool by_lat = lat_span >= lng_span;
+			const uint32_t middle = begin + (end - begin) / 2;
+			if (by_lat) {
+				nth_element(stops.begin() + begin, stops.begin() + middle, stops.begin() + end, [](const auto& lhs, const auto& rhs) {
+					return lhs.first.lat < rhs.first.lat;
+					});
+			}
+			else {
+				nth_element(stops.begin() + begin, stops.begin() + middle, stops.begin() + end, [](const auto& lhs, const auto& rhs) {
+					return lhs.first.lng < rhs.first.lng;
+					});
+			}
+
+			Box left_bounds = bounds;
+			Box right_bounds = bounds;
+			if (by_lat) {
+				left_bounds.lat_hi = right_bounds.lat_lo = stops[middle].first.lat;
+			}
+			else {
+				left_bounds.lng_hi = right_bounds.lng_lo = stops[middle].first.lng;
+			}
+			const uint32_t left = self(self, begin, middle, left_bounds);
+			const uint32_t right = self(self, middle, end, right_bounds);
+
+			const Box& lhs = nodes_[left].box;
+			const Box& rhs = nodes_[right].box;
+			nodes_[node].box = { min(lhs.lat_lo, rhs.lat_lo), max(lhs.lat_hi, rhs.lat_hi), min(lhs.lng_lo, rhs.lng_lo), max(lhs.lng_hi, rhs.lng_hi) };
+			nodes_[node].right = right;
+			return node;
+		};
+		build(build, 0, static_cast<uint32_t>(stops.size()), bounds);
+
+		coords_.reserve(stops.size());
+		ids_.reserve(stops.size());
+		for (const auto& [point, id] : stops) {
+			coords_.push_back(point);
+			ids_.push_back(id);
+		}
+	}
+
+	size_t StopSpatialIndex::Size() const {
+		return ids_.size();
+	}
+
+	::geo::DistanceMode StopSpatialIndex::GetMode() const {
+		return mode_;
+	}
+
+	template <typename Limit, typename Visit>
+	void StopSpatialIndex::Search(::geo::Coordinates center, Limit limit, Visit visit) const {
+
+		if (nodes_.empty()) {
+			return;
+		}
+
+		const auto bound = [this, &center](uint32_t node) {
+			const Box& box = nodes_[node].box;
+			return LowerBound(center, box.lat_lo, box.lat_hi, box.lng_lo, box.lng_hi, mode_);
+		};
+
+		// depth first, the nearer child on top: by a planar gap in degrees, which only orders them,
+		// the bound itself is taken when a node comes off the stack
+		const double lng_scale = cos(center.lat * DEG_TO_RAD);
+		const auto gap = [this, &center, lng_scale](uint32_t node) {
+			const Box& box = nodes_[node].box;
+			const double dlat = max({ 0., box.lat_lo - center.lat, center.lat - box.lat_hi });
+			const double dlng = LngGap(center.lng, box.lng_lo, box.lng_hi) * lng_scale;
+			return dlat * dlat + dlng * dlng;
+		};
+
+		vector<uint32_t> pending;
+		pending.reserve(64);
+		pending.push_back(0);
+		while (!pending.empty()) {
+			const uint32_t index = pending.back();
+			const TreeNode& node = nodes_[index];
+			pending.pop_back();
+			// a box around the center or a limit not set yet can't rule anything out
+			const double node_limit = limit();
+			if (node_limit < numeric_limits<double>::infinity() && gap(index) > 0 && bound(index) > node_limit) {
+				continue;
+			}
+
+			if (node.right == 0) {
+				for (uint32_t pos = node.begin; pos < node.end; ++pos) {
+					visit(ids_[pos], Distance(center, coords_[pos], mode_));
+				}
+				continue;
+			}
+
+			const uint32_t left = index + 1;
+			if (gap(left) <= gap(node.right)) {
+				pending.push_back(node.right);
+				pending.push_back(left);
+			}
+			else {
+				pending.push_back(left);
+				pending.push_back(node.right);
+			}
+		}
+	}
+
+	std::vector<NearbyStop> StopSpatialIndex::FindWithinRadius(::geo::Coordinates center, double meters) const {
+
+		vector<NearbyStop> result;
+		Search(center, [meters]() { return meters; }, [&result, meters](StopId id, double distance) {
+			if (distance <= meters) {
+				result.push_back({ id, distance });
+			}
+			});
+
+		sort(result.begin(), result.end(), NearbyLess);
+		return result;
+	}
+
+	std::vector<NearbyStop> StopSpatialIndex::FindNearest(::geo::Coordinates center, size_t count) const {
+
+		if (count == 0) {
+			return {};
+		}
+
+		// max-heap of the best candidates so far
+		vector<NearbyStop> heap;
+		heap.reserve(min(count, ids_.size()));
+		const auto limit = [&heap, count]() {
+			return heap.size() < count ? numeric_limits<double>::infinity() : heap.front().distance;
+		};
+
+		Search(center, limit, [&heap, count](StopId id, double distance) {
+			const NearbyStop candidate{ id, distance };
+			if (heap.size() < count) {
+				heap.push_back(candidate);
+				push_heap(heap.begin(), heap.end(), NearbyLess);
+			}
+			else if (NearbyLess(candidate, heap.front())) {
+				pop_heap(heap.begin(), heap.end(), NearbyLess);
+				heap.back() = candidate;
+				push_heap(heap.begin(), heap.end(), NearbyLess);
+			}
+			});
+
+		sort_heap(heap.begin(), heap.end(), NearbyLess);
+		return heap;
+	}
+
+	namespace tests {
+		void TestStopSpatialIndex()
+		{
+			const auto brute_force = [](const vector<::geo::Coordinates>& coords, ::geo::Coordinates center, ::geo::DistanceMode mode) {
+				vector<NearbyStop> all;
+				for (size_t id = 0; id < coords.size(); ++id) {
+					all.push_back({ static_cast<StopId>(id), Distance(center, coords[id], mode) });
+				}
+				sort(all.begin(), all.end(), NearbyLess);
+				return all;
+			};
+			const auto same = [](const vector<NearbyStop>& lhs, const vector<NearbyStop>& rhs) {
+				return lhs.size() == rhs.size() && equal(lhs.begin(), lhs.end(), rhs.begin(), [](const auto& l, const auto& r) {
+					return l.id == r.id && l.distance == r.distance;
+					});
+			};
+
+			StopSpatialIndex index;
+			index.Build({});
+			assert(index.FindNearest({ 0, 0 }, 3).empty());
+			assert(index.FindWithinRadius({ 0, 0 }, 1e9).empty());
+
+			// a city, a few stops on both sides of the antimeridian and one near the pole
+			mt19937 generator(42);
+			uniform_real_distribution<double> city_lat(55.5, 56.), city_lng(37.3, 37.9);
+			vector<::geo::Coordinates> coords;
+			for (int i = 0; i < 2000; ++i) {
+				coords.push_back({ city_lat(generator), city_lng(generator) });
+			}
+			coords.push_back({ 10, 179.99 });
+			coords.push_back({ 10, -179.99 });
+			coords.push_back({ 89.9, 0 });
+			coords.push_back(coords.front()); // duplicate position
+			index.Build(coords);
+			assert(index.Size() == coords.size() && index.GetMode() == ::geo::DistanceMode::EXACT);
+
+			vector<::geo::Coordinates> queries{ coords.front(), { 55.75, 37.6 }, { 10, 179.995 }, { 10, -179.5 }, { 90, 100 }, { -50, 0 } };
+			for (int i = 0; i < 50; ++i) {
+				queries.push_back({ city_lat(generator), city_lng(generator) });
+			}
+
+			for (::geo::DistanceMode mode : { ::geo::DistanceMode::EXACT, ::geo::DistanceMode::HAVERSINE, ::geo::DistanceMode::EQUIRECTANGULAR }) {
+				index.Build(coords, mode);
+				for (const auto& center : queries) {
+					const auto all = brute_force(coords, center, mode);
+					for (size_t count : { size_t{ 1 }, size_t{ 5 }, size_t{ 40 }, coords.size() + 1 }) {
+						vector<NearbyStop> expected(all.begin(), all.begin() + min(count, all.size()));
+						assert(same(index.FindNearest(center, count), expected));
+					}
+					for (double meters : { 0., 300., 2500., 3e6, 3e7 }) {
+						vector<NearbyStop> expected;
+						for (const auto& stop : all) {
+							if (stop.distance <= meters) {
+								expected.push_back(stop);
+							}
+						}
+						assert(same(index.FindWithinRadius(center, meters), expected));
+					}
+				}
+			}
+
+			// neighbours across the antimeridian
+			const auto nearest = index.FindNearest({ 10, 179.995 }, 2);
+			assert(nearest[0].id == 2000 && nearest[1].id == 2001);
+
+			// skewed: nearly all stops within a few hundred meters, a few spread over the globe
+			uniform_real_distribution<double> block_lat(55.750, 55.752), block_lng(37.610, 37.613);
+			uniform_real_distribution<double> any_lat(-80., 80.), any_lng(-180., 180.);
+			vector<::geo::Coordinates> skewed;
+			for (int i = 0; i < 3000; ++i) {
+				skewed.push_back({ block_lat(generator), block_lng(generator) });
+			}
+			for (int i = 0; i < 30; ++i) {
+				skewed.push_back({ any_lat(generator), any_lng(generator) });
+			}
+			vector<::geo::Coordinates> skewed_queries{ { 55.751, 37.6115 }, { 55.76, 37.62 }, { 0, 0 } };
+			for (int i = 0; i < 20; ++i) {
+				skewed_queries.push_back(skewed[i * 150]);
+				skewed_queries.push_back({ any_lat(generator), any_lng(generator) });
+			}
+			for (::geo::DistanceMode mode : { ::geo::DistanceMode::EXACT, ::geo::DistanceMode::EQUIRECTANGULAR }) {
+				index.Build(skewed, mode);
+				for (const auto& center : skewed_queries) {
+					const auto all = brute_force(skewed, center, mode);
+					for (size_t count : { size_t{ 1 }, size_t{ 10 }, size_t{ 100 } }) {
+						assert(same(index.FindNearest(center, count), vector<NearbyStop>(all.begin(), all.begin() + count)));
+					}
+					for (double meters : { 0., 20., 150., 1e5, 3e7 }) {
+						const auto end = find_if(all.begin(), all.end(), [meters](const NearbyStop& stop) { return stop.distance > meters; });
+						assert(same(index.FindWithinRadius(center, meters), vector<NearbyStop>(all.begin(), end)));
+					}
+				}
+			}
+		}
+
+		void BenchmarkStopSpatialIndex() {
+			using Clock = std::chrono::steady_clock;
+			constexpr size_t STOPS = 1000000;
+			constexpr size_t QUERIES = 100000;
+
+			// a city spread evenly, and the same count with all but a thousand stops in 10 x 10 km
+			mt19937 generator(1);
+			uniform_real_distribution<double> city_lat(55.5, 56.), city_lng(37.3, 37.9);
+			uniform_real_distribution<double> block_lat(55.70, 55.79), block_lng(37.55, 37.71);
+			uniform_real_distribution<double> any_lat(-80., 80.), any_lng(-180., 180.);
+			vector<::geo::Coordinates> uniform(STOPS), skewed(STOPS);
+			for (size_t i = 0; i < STOPS; ++i) {
+				uniform[i] = { city_lat(generator), city_lng(generator) };
+				skewed[i] = i < 1000 ? ::geo::Coordinates{ any_lat(generator), any_lng(generator) } : ::geo::Coordinates{ block_lat(generator), block_lng(generator) };
+			}
+
+			for (const auto& [name, coords] : { pair{ "uniform", &uniform }, pair{ "skewed", &skewed } }) {
+				StopSpatialIndex index;
+				const auto build_start = Clock::now();
+				index.Build(*coords);
+				const auto build_time = Clock::now() - build_start;
+
+				uniform_int_distribution<size_t> stop(0, STOPS - 1);
+				size_t found = 0;
+				const auto nearest_start = Clock::now();
+				for (size_t i = 0; i < QUERIES; ++i) {
+					found += index.FindNearest((*coords)[stop(generator)], 10).size();
+				}
+				const auto nearest_time = Clock::now() - nearest_start;
+				const auto radius_start = Clock::now();
+				for (size_t i = 0; i < QUERIES; ++i) {
+					found += index.FindWithinRadius((*coords)[stop(generator)], 30).size();
+				}
+				const auto radius_time = Clock::now() - radius_start;
+
+				cerr << name << ": build " << chrono::duration<double, milli>(build_time).count() << " ms, nearest 10 "
+					<< chrono::duration<double, micro>(nearest_time).count() / QUERIES << " us, within 30 m "
+					<< chrono::duration<double, micro>(radius_time).count() / QUERIES << " us (" << found << " found)\n";
+			}
+		}
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "domain.h"
+#include "geo.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace transport {
+
+	struct NearbyStop {
+		StopId id;
+		double distance; // meters, in the DistanceMode of the index
+	};
+
+	// KD-tree over the stops: each node halves its stops along the wider side of their bounding
+	// box, leaves hold a few stops. Being split at medians, it stays balanced however the stops
+	// cluster. A query descends the nearer child first and skips every node whose box is, by a
+	// lower bound of the distance, farther than the current answer. Works across the antimeridian.
+	class StopSpatialIndex {
+	public:
+		// coords: index is StopId
+		void Build(const std::vector<::geo::Coordinates>& coords, ::geo::DistanceMode mode = ::geo::DistanceMode::EXACT);
+		size_t Size() const;
+		::geo::DistanceMode GetMode() const;
+
+		// sorted by distance, then by id
+		std::vector<NearbyStop> FindWithinRadius(::geo::Coordinates center, double meters) const;
+		std::vector<NearbyStop> FindNearest(::geo::Coordinates center, size_t count) const;
+
+	private:
+		struct Box {
+			double lat_lo;
+			double lat_hi;
+			double lng_lo;
+			double lng_hi;
+		};
+
+		struct TreeNode {
+			Box box; // of its stops
+			uint32_t begin; // its stops are [begin, end) of coords_
+			uint32_t end;
+			uint32_t right; // the left child follows the node; none for a leaf
+		};
+
+		// calls visit(id, distance) for every stop that may be closer than limit(); skips the
+		// nodes that can hold nothing closer than limit()
+		template <typename Limit, typename Visit>
+		void Search(::geo::Coordinates center, Limit limit, Visit visit) const;
+
+	private:
+		::geo::DistanceMode mode_ = ::geo::DistanceMode::EXACT;
+
+		std::vector<TreeNode> nodes_; // preorder, the root first
+		std::vector<::geo::Coordinates> coords_; // in tree order
+		std::vector<StopId> ids_; // parallel to coords_
+	};
+
+	namespace tests {
+		void TestStopSpatialIndex();
+		void BenchmarkStopSpatialIndex(); // prints to std::cerr
+	}
+
+}
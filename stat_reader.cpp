@@ -78,11 +78,11 @@ namespace transport::output {
 		}
 
 		os << "Stop "s << stop_info.name << ": buses "s;
-		for (auto it = stop_info.buses.value().get().cbegin(); it != stop_info.buses.value().get().cend(); ++it) {
+		for (auto it = stop_info.buses->cbegin(); it != stop_info.buses->cend(); ++it) {
 			os << (*it)->name;
 			auto next_it = it;
 			;
-			if (next(next_it) != stop_info.buses.value().get().cend()) {
+			if (next(next_it) != stop_info.buses->cend()) {
 				os << " "s;
 			}
 		}
@@ -0,0 +1,160 @@
+#include "stop_bus_index.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace transport {
+
+	using namespace std;
+
+	void StopBusIndex::Add(StopId stop, BusId bus) {
+		pending_.push_back({ stop, bus });
+	}
+
+	bool StopBusIndex::HasPending() const {
+		return !pending_.empty();
+	}
+
+	void StopBusIndex::Build(const std::pmr::deque<Bus>& routes, unsigned threads) {
+
+		if (pending_.empty()) {
+			return;
+		}
+
+		const auto name_less = [&routes](BusId lhs, BusId rhs) {
+			return routes[lhs].name < routes[rhs].name;
+		};
+
+		// names of the new buses are compared once, to rank them; ties keep the order of addition
+		vector<BusId> new_buses;
+		new_buses.reserve(pending_.size());
+		for (const auto& [stop, bus] : pending_) {
+			new_buses.push_back(bus);
+		}
+		utils::ParallelSort(new_buses.begin(), new_buses.end(), less<BusId>{}, threads);
+		new_buses.erase(unique(new_buses.begin(), new_buses.end()), new_buses.end());
+		utils::ParallelSort(new_buses.begin(), new_buses.end(), [&name_less](BusId lhs, BusId rhs) {
+			return name_less(lhs, rhs) || (!name_less(rhs, lhs) && lhs < rhs);
+			}, threads);
+
+		vector<uint32_t> rank(routes.size());
+		for (uint32_t i = 0; i < new_buses.size(); ++i) {
+			rank[new_buses[i]] = i;
+		}
+
+		utils::ParallelSort(pending_.begin(), pending_.end(), [&rank](const auto& lhs, const auto& rhs) {
+			if (lhs.first != rhs.first) {
+				return lhs.first < rhs.first;
+			}
+			return rank[lhs.second] < rank[rhs.second];
+			}, threads);
+
+		const size_t row_count = max(offsets_.empty() ? 0 : offsets_.size() - 1, size_t{ pending_.back().first } + 1);
+
+		vector<uint32_t> offsets(row_count + 1, 0);
+		vector<BusId> bus_ids;
+		bus_ids.reserve(bus_ids_.size() + pending_.size());
+
+		// row by row merge of the built index with the new (already sorted) entries
+		auto pending_it = pending_.cbegin();
+		for (size_t stop = 0; stop < row_count; ++stop) {
+
+			const auto row_begin = bus_ids.size();
+
+			auto old_it = bus_ids_.cbegin();
+			auto old_end = bus_ids_.cbegin();
+			if (stop + 1 < offsets_.size()) {
+				old_it += offsets_[stop];
+				old_end += offsets_[stop + 1];
+			}
+
+			while (old_it != old_end || (pending_it != pending_.cend() && pending_it->first == stop)) {
+
+				BusId next_bus = 0;
+				if (pending_it == pending_.cend() || pending_it->first != stop
+					|| (old_it != old_end && !name_less(pending_it->second, *old_it))) {
+					next_bus = *old_it++;
+				}
+				else {
+					next_bus = (pending_it++)->second;
+				}
+
+				// buses with the same name are stored once, the first added one wins
+				if (bus_ids.size() == row_begin || name_less(bus_ids.back(), next_bus)) {
+					bus_ids.push_back(next_bus);
+				}
+			}
+
+			offsets[stop + 1] = static_cast<uint32_t>(bus_ids.size());
+		}
+
+		offsets_ = move(offsets);
+		bus_ids_ = move(bus_ids);
+		pending_.clear();
+		pending_.shrink_to_fit();
+	}
+
+	BusRange StopBusIndex::GetBuses(StopId stop, const std::pmr::deque<Bus>& routes) const {
+		if (stop + size_t{ 1 } >= offsets_.size()) {
+			return { nullptr, nullptr, routes };
+		}
+		const BusId* data = bus_ids_.data();
+		return { data + offsets_[stop], data + offsets_[stop + 1], routes };
+	}
+
+	const std::vector<uint32_t>& StopBusIndex::GetOffsets() const {
+		return offsets_;
+	}
+
+	const std::vector<BusId>& StopBusIndex::GetBusIds() const {
+		return bus_ids_;
+	}
+
+	size_t StopBusIndex::GetMemoryUsage() const {
+		return offsets_.capacity() * sizeof(uint32_t)
+			+ bus_ids_.capacity() * sizeof(BusId)
+			+ pending_.capacity() * sizeof(pending_.front());
+	}
+
+	namespace tests {
+		void TestStopBusIndex()
+		{
+			std::pmr::deque<Bus> routes{
+				{ "b", {}, true, 0 },
+				{ "a", {}, true, 1 },
+				{ "c", {}, true, 2 },
+				{ "a", {}, true, 3 }, // same name as bus 1
+			};
+
+			StopBusIndex index;
+			index.Add(0, 0);
+			index.Add(0, 2);
+			index.Add(2, 1);
+			index.Add(0, 1);
+			index.Build(routes);
+
+			BusRange buses = index.GetBuses(0, routes);
+			assert(buses.size() == 3);
+			assert(std::vector<BusId>(buses.ids_begin(), buses.ids_end()) == (std::vector<BusId>{ 1, 0, 2 }));
+			assert((*buses.begin())->name == "a");
+			assert(index.GetBuses(1, routes).empty());
+			assert(index.GetBuses(2, routes).size() == 1);
+			assert(index.GetBuses(5, routes).empty());
+
+			// late additions are merged in name order
+			index.Add(1, 2);
+			index.Add(0, 3);
+			index.Add(4, 0);
+			assert(index.HasPending());
+			index.Build(routes);
+			buses = index.GetBuses(0, routes);
+			assert(std::vector<BusId>(buses.ids_begin(), buses.ids_end()) == (std::vector<BusId>{ 1, 0, 2 }));
+			assert(index.GetBuses(1, routes).size() == 1);
+			assert(index.GetBuses(2, routes).size() == 1);
+			assert(index.GetBuses(3, routes).empty());
+			assert((*index.GetBuses(4, routes).begin())->id == 0);
+		}
+	}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace transport {
+
+	// Buses of one stop in the order of their names; iterates as const Bus*
+	class BusRange {
+	public:
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = const Bus*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Bus* const*;
+			using reference = const Bus*;
+
+			Iterator(const BusId* pos, const std::pmr::deque<Bus>* routes)
+				: pos_(pos), routes_(routes) {}
+
+			const Bus* operator*() const { return &(*routes_)[*pos_]; }
+			Iterator& operator++() { ++pos_; return *this; }
+			Iterator operator++(int) { Iterator prev = *this; ++pos_; return prev; }
+			bool operator==(const Iterator& other) const { return pos_ == other.pos_; }
+			bool operator!=(const Iterator& other) const { return pos_ != other.pos_; }
+
+		private:
+			const BusId* pos_;
+			const std::pmr::deque<Bus>* routes_;
+		};
+
+		BusRange(const BusId* begin, const BusId* end, const std::pmr::deque<Bus>& routes)
+			: begin_(begin), end_(end), routes_(&routes) {}
+
+		Iterator begin() const { return { begin_, routes_ }; }
+		Iterator end() const { return { end_, routes_ }; }
+		Iterator cbegin() const { return begin(); }
+		Iterator cend() const { return end(); }
+
+		size_t size() const { return end_ - begin_; }
+		bool empty() const { return begin_ == end_; }
+
+		// ids of the buses, same order
+		const BusId* ids_begin() const { return begin_; }
+		const BusId* ids_end() const { return end_; }
+
+	private:
+		const BusId* begin_;
+		const BusId* end_;
+		const std::pmr::deque<Bus>* routes_;
+	};
+
+	// Stop -> buses index in CSR layout: bus ids of every stop lie in one contiguous
+	// row sorted by bus name. Buses added after a build are merged into the rows
+	// by the next Build().
+	class StopBusIndex {
+	public:
+		void Add(StopId stop, BusId bus);
+		void Build(const std::pmr::deque<Bus>& routes, unsigned threads = 1); // routes: indexed by BusId
+		bool HasPending() const;
+
+		// requires a build after the last Add
+		BusRange GetBuses(StopId stop, const std::pmr::deque<Bus>& routes) const;
+
+		size_t GetMemoryUsage() const; // bytes
+
+		// raw rows as of the last build: row of stop i is bus_ids[offsets[i]..offsets[i + 1]),
+		// offsets may be shorter than the number of stops
+		const std::vector<uint32_t>& GetOffsets() const;
+		const std::vector<BusId>& GetBusIds() const;
+
+	private:
+		std::vector<uint32_t> offsets_; // row of stop i is [offsets_[i], offsets_[i + 1])
+		std::vector<BusId> bus_ids_;
+		std::vector<std::pair<StopId, BusId>> pending_;
+	};
+
+	namespace tests {
+		void TestStopBusIndex();
+	}
+
+}
@@ -0,0 +1,304 @@
+#include "timetable.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace transport {
+
+	using namespace std;
+
+	TripId Timetable::AddTrip(BusId bus, const std::pmr::vector<StopId>& stops, const std::vector<uint32_t>& times) {
+		assert(stops.size() == times.size());
+
+		const auto trip = static_cast<TripId>(trip_bus_.size());
+		trip_bus_.push_back(bus);
+		for (size_t i = 0; i + 1 < stops.size(); ++i) {
+			assert(times[i] <= times[i + 1]);
+			pending_.push_back({ times[i], times[i + 1], stops[i], stops[i + 1], trip });
+			stop_bound_ = max({ stop_bound_, stops[i] + 1, stops[i + 1] + 1 });
+		}
+		return trip;
+	}
+
+	void Timetable::Build() {
+		// stable, so connections of a trip with equal times keep their order along the route
+		const auto earlier = [](const Connection& lhs, const Connection& rhs) {
+			return lhs.departure < rhs.departure || (lhs.departure == rhs.departure && lhs.arrival < rhs.arrival);
+		};
+		stable_sort(pending_.begin(), pending_.end(), earlier);
+
+		const size_t old_size = connections_.size();
+		connections_.insert(connections_.end(), pending_.begin(), pending_.end());
+		inplace_merge(connections_.begin(), connections_.begin() + old_size, connections_.end(), earlier);
+
+		pending_.clear();
+		pending_.shrink_to_fit();
+	}
+
+	bool Timetable::HasPending() const {
+		return !pending_.empty();
+	}
+
+	size_t Timetable::GetTripCount() const {
+		return trip_bus_.size();
+	}
+
+	BusId Timetable::GetTripBus(TripId trip) const {
+		return trip_bus_[trip];
+	}
+
+	StopId Timetable::GetStopBound() const {
+		return stop_bound_;
+	}
+
+	const std::vector<Connection>& Timetable::GetConnections() const {
+		return connections_;
+	}
+
+	ConnectionScan::ConnectionScan(const Timetable& timetable)
+		: timetable_(timetable)
+	{
+	}
+
+	void ConnectionScan::Reset() {
+		for (StopId stop : touched_stops_) {
+			arrival_[stop] = NONE;
+		}
+		for (TripId trip : touched_trips_) {
+			trip_enter_[trip] = NONE;
+		}
+		touched_stops_.clear();
+		touched_trips_.clear();
+
+		// the timetable may have grown since the last run
+		if (arrival_.size() < timetable_.GetStopBound()) {
+			arrival_.resize(timetable_.GetStopBound(), NONE);
+			reached_by_.resize(timetable_.GetStopBound());
+		}
+		if (trip_enter_.size() < timetable_.GetTripCount()) {
+			trip_enter_.resize(timetable_.GetTripCount(), NONE);
+		}
+	}
+
+	std::optional<uint32_t> ConnectionScan::Run(StopId from, StopId to, uint32_t departure) {
+
+		Reset();
+		source_ = from;
+
+		if (from == to) {
+			return departure;
+		}
+		if (from >= arrival_.size() || to >= arrival_.size()) {
+			return nullopt; // no trips at one of the stops
+		}
+
+		arrival_[from] = departure;
+		touched_stops_.push_back(from);
+
+		const vector<Connection>& connections = timetable_.GetConnections();
+		const auto first = lower_bound(connections.begin(), connections.end(), departure, [](const Connection& connection, uint32_t time) {
+			return connection.departure < time;
+			});
+
+		for (auto it = first; it != connections.end(); ++it) {
+			const Connection& connection = *it;
+			if (arrival_[to] <= connection.departure) {
+				break; // nothing left can arrive earlier
+			}
+
+			uint32_t& enter = trip_enter_[connection.trip];
+			if (enter == NONE) {
+				if (arrival_[connection.from] > connection.departure) {
+					continue; // neither on the trip nor at the stop in time
+				}
+				enter = static_cast<uint32_t>(it - connections.begin());
+				touched_trips_.push_back(connection.trip);
+			}
+
+			if (connection.arrival < arrival_[connection.to]) {
+				if (arrival_[connection.to] == NONE) {
+					touched_stops_.push_back(connection.to);
+				}
+				arrival_[connection.to] = connection.arrival;
+				reached_by_[connection.to] = { enter, static_cast<uint32_t>(it - connections.begin()) };
+			}
+		}
+
+		if (arrival_[to] == NONE) {
+			return nullopt;
+		}
+		return arrival_[to];
+	}
+
+	std::vector<JourneyLeg> ConnectionScan::GetJourney(StopId to) const {
+		vector<JourneyLeg> journey;
+		if (to >= arrival_.size() || arrival_[to] == NONE) {
+			return journey;
+		}
+
+		const vector<Connection>& connections = timetable_.GetConnections();
+		// every leg is taken from a reached stop, so there are no more legs than those
+		for (StopId stop = to; stop != source_ && journey.size() < touched_stops_.size(); ) {
+			const Connection& enter = connections[reached_by_[stop].enter];
+			const Connection& exit = connections[reached_by_[stop].exit];
+			journey.push_back({ enter.trip, enter.from, exit.to, enter.departure, exit.arrival });
+			stop = enter.from;
+		}
+		reverse(journey.begin(), journey.end());
+		return journey;
+	}
+
+	namespace tests {
+		void TestConnectionScan()
+		{
+			// stops 0..3; bus 0 goes 0 -> 1 -> 2, bus 1 goes 1 -> 3 and bus 2 goes 0 -> 3 directly but late
+			Timetable timetable;
+			const std::pmr::vector<StopId> line{ 0, 1, 2 };
+			const std::pmr::vector<StopId> branch{ 1, 3 };
+			const std::pmr::vector<StopId> express{ 0, 3 };
+			timetable.AddTrip(0, line, { 600, 700, 800 });
+			timetable.AddTrip(0, line, { 1200, 1300, 1400 });
+			timetable.AddTrip(1, branch, { 700, 900 });
+			timetable.AddTrip(1, branch, { 1000, 1100 });
+			const TripId late = timetable.AddTrip(2, express, { 1000, 1050 });
+			assert(timetable.HasPending());
+			timetable.Build();
+			assert(!timetable.HasPending() && timetable.GetConnections().size() == 7);
+			assert(is_sorted(timetable.GetConnections().begin(), timetable.GetConnections().end(), [](const Connection& lhs, const Connection& rhs) {
+				return lhs.departure < rhs.departure;
+				}));
+
+			ConnectionScan scan(timetable);
+			assert(*scan.Run(0, 2, 0) == 800);
+			assert(*scan.Run(0, 3, 0) == 900); // changing at 1 right on arrival
+			const auto journey = scan.GetJourney(3);
+			assert(journey.size() == 2);
+			assert(journey[0].from == 0 && journey[0].to == 1 && journey[0].departure == 600 && journey[0].arrival == 700);
+			assert(journey[1].from == 1 && journey[1].to == 3 && timetable.GetTripBus(journey[1].trip) == 1);
+
+			assert(*scan.Run(0, 3, 601) == 1050);
+			assert(scan.GetJourney(3).size() == 1 && scan.GetJourney(3)[0].trip == late);
+			assert(*scan.Run(0, 2, 601) == 1400);
+			assert(!scan.Run(0, 2, 1201));
+			assert(!scan.Run(2, 0, 0));
+			assert(*scan.Run(2, 2, 5) == 5 && scan.GetJourney(2).empty());
+			assert(!scan.Run(0, 7, 0)); // a stop without trips
+
+			// a trip added later is merged in
+			timetable.AddTrip(0, line, { 650, 660, 670 });
+			timetable.Build();
+			assert(*scan.Run(0, 2, 0) == 670);
+
+			// agrees with relaxing the connections until nothing changes
+			mt19937 generator(3);
+			constexpr StopId STOPS = 30;
+			Timetable random_timetable;
+			uniform_int_distribution<StopId> stop(0, STOPS - 1);
+			uniform_int_distribution<uint32_t> start(0, 5000), hop(1, 300);
+			for (int trip = 0; trip < 200; ++trip) {
+				std::pmr::vector<StopId> stops(2 + trip % 5);
+				vector<uint32_t> times(stops.size());
+				times[0] = start(generator);
+				for (size_t i = 0; i < stops.size(); ++i) {
+					stops[i] = stop(generator);
+					if (i > 0) {
+						times[i] = times[i - 1] + hop(generator);
+					}
+				}
+				random_timetable.AddTrip(0, stops, times);
+				if (trip == 100) {
+					random_timetable.Build();
+				}
+			}
+			random_timetable.Build();
+
+			ConnectionScan random_scan(random_timetable);
+			for (int query = 0; query < 200; ++query) {
+				const StopId from = stop(generator);
+				const uint32_t departure = start(generator);
+
+				vector<uint32_t> expected(STOPS, ~uint32_t{ 0 });
+				expected[from] = departure;
+				for (bool changed = true; changed; ) {
+					changed = false;
+					for (const Connection& connection : random_timetable.GetConnections()) {
+						if (expected[connection.from] <= connection.departure && connection.arrival < expected[connection.to]) {
+							expected[connection.to] = connection.arrival;
+							changed = true;
+						}
+					}
+				}
+
+				for (StopId to = 0; to < STOPS; ++to) {
+					const auto arrival = random_scan.Run(from, to, departure);
+					assert(arrival.value_or(~uint32_t{ 0 }) == expected[to]);
+					if (arrival && to != from) {
+						const auto legs = random_scan.GetJourney(to);
+						assert(!legs.empty() && legs.front().from == from && legs.back().to == to && legs.back().arrival == *arrival);
+						assert(legs.front().departure >= departure);
+						for (size_t i = 1; i < legs.size(); ++i) {
+							assert(legs[i].from == legs[i - 1].to && legs[i].departure >= legs[i - 1].arrival);
+						}
+					}
+				}
+			}
+		}
+
+		void BenchmarkConnectionScan()
+		{
+			using Clock = std::chrono::steady_clock;
+			const auto ms = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+			// a city of 10000 stops and 1000 routes of 30 stops, every route runs every 6 to 15 minutes from 5:00 to 24:00
+			constexpr StopId STOPS = 10000;
+			constexpr int ROUTES = 1000;
+			constexpr size_t ROUTE_LENGTH = 30;
+			constexpr uint32_t DAY_START = 5 * 3600, DAY_END = 24 * 3600;
+			mt19937 generator(1);
+			uniform_int_distribution<StopId> stop(0, STOPS - 1);
+			uniform_int_distribution<uint32_t> headway(360, 900), hop(60, 240);
+
+			const auto build_start = Clock::now();
+			Timetable timetable;
+			for (int route = 0; route < ROUTES; ++route) {
+				std::pmr::vector<StopId> stops(ROUTE_LENGTH);
+				vector<uint32_t> hops(ROUTE_LENGTH - 1);
+				for (StopId& id : stops) {
+					id = stop(generator);
+				}
+				for (uint32_t& time : hops) {
+					time = hop(generator);
+				}
+				const uint32_t interval = headway(generator);
+				vector<uint32_t> times(ROUTE_LENGTH);
+				for (uint32_t departure = DAY_START + interval % 300; departure < DAY_END; departure += interval) {
+					times[0] = departure;
+					for (size_t i = 1; i < ROUTE_LENGTH; ++i) {
+						times[i] = times[i - 1] + hops[i - 1];
+					}
+					timetable.AddTrip(static_cast<BusId>(route), stops, times);
+				}
+			}
+			timetable.Build();
+			const auto build_time = Clock::now() - build_start;
+
+			constexpr int QUERIES = 300;
+			uniform_int_distribution<uint32_t> departure(7 * 3600, 20 * 3600);
+			ConnectionScan scan(timetable);
+			int found = 0;
+			const auto query_start = Clock::now();
+			for (int query = 0; query < QUERIES; ++query) {
+				found += scan.Run(stop(generator), stop(generator), departure(generator)).has_value();
+			}
+			const auto query_time = Clock::now() - query_start;
+
+			std::cerr << "trips: " << timetable.GetTripCount() << ", connections: " << timetable.GetConnections().size()
+				<< ", build: " << ms(build_time) << " ms\n"
+				<< "earliest arrival: " << ms(query_time) / QUERIES << " ms, found " << found << " of " << QUERIES << '\n';
+		}
+	}
+
+}
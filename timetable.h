@@ -0,0 +1,96 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+namespace transport {
+
+	// dense, in order of addition like StopId and BusId
+	using TripId = uint32_t;
+
+	// a trip going from one stop to the next; times are seconds from the start of the service day
+	struct Connection {
+		uint32_t departure;
+		uint32_t arrival;
+		StopId from;
+		StopId to;
+		TripId trip;
+	};
+
+	// Trips of all routes as one contiguous array of connections sorted by departure.
+	// Trips added after a build are merged into the array by the next Build().
+	class Timetable {
+	public:
+		// stops: full stop sequence of the route; times: at every one of them, not decreasing
+		TripId AddTrip(BusId bus, const std::pmr::vector<StopId>& stops, const std::vector<uint32_t>& times);
+		void Build();
+		bool HasPending() const;
+
+		size_t GetTripCount() const;
+		BusId GetTripBus(TripId trip) const;
+		// stops that have trips are below it
+		StopId GetStopBound() const;
+
+		// requires a build after the last AddTrip
+		const std::vector<Connection>& GetConnections() const;
+
+	private:
+		std::vector<Connection> connections_;
+		std::vector<Connection> pending_;
+		std::vector<BusId> trip_bus_; // index: TripId
+		StopId stop_bound_ = 0;
+	};
+
+	// part of a journey made on one trip
+	struct JourneyLeg {
+		TripId trip;
+		StopId from;
+		StopId to;
+		uint32_t departure;
+		uint32_t arrival;
+	};
+
+	// Earliest arrival queries by the Connection Scan Algorithm: a single pass over the
+	// connections from the departure time on, which ends once they leave later than the
+	// best arrival at the target. Changing trips at a stop takes no time.
+	// Buffers are kept between runs like in DijkstraSearch; one object serves one query at a time.
+	class ConnectionScan {
+	public:
+		explicit ConnectionScan(const Timetable& timetable);
+
+		// earliest arrival at "to" leaving "from" not before "departure"; nullopt if there is none
+		std::optional<uint32_t> Run(StopId from, StopId to, uint32_t departure);
+		// trips of the journey found by the last Run, from the start
+		std::vector<JourneyLeg> GetJourney(StopId to) const;
+
+	private:
+		static constexpr uint32_t NONE = ~uint32_t{ 0 };
+
+		// connections where the trip that reached a stop was boarded and left
+		struct Leg {
+			uint32_t enter;
+			uint32_t exit;
+		};
+
+		void Reset();
+
+	private:
+		const Timetable& timetable_;
+		std::vector<uint32_t> arrival_; // index: StopId; NONE if not reached
+		std::vector<Leg> reached_by_;
+		std::vector<uint32_t> trip_enter_; // index: TripId; connection where the trip was boarded, NONE if it was not
+		std::vector<StopId> touched_stops_;
+		std::vector<TripId> touched_trips_;
+		StopId source_ = 0;
+	};
+
+	namespace tests {
+		void TestConnectionScan();
+		void BenchmarkConnectionScan(); // prints to std::cerr
+	}
+
+}
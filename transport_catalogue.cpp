@@ -4,72 +4,287 @@
 #include <iterator>
 
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
 #include <limits>
+#include <random>
 #include <stdexcept>
+#include <thread>
 
 namespace transport {
 
 	using namespace std;
 
-	void TransportCatalogue::AddRoute(std::string name, const std::vector<std::string>& stopnames, bool isRing)
+	TransportCatalogue::TransportCatalogue(AllocationMode mode)
+		: arena_(mode == AllocationMode::ARENA ? make_unique<pmr::monotonic_buffer_resource>() : nullptr)
+		, resource_(arena_ ? arena_.get() : pmr::get_default_resource())
+		, stopname_to_id_(resource_)
+		, busname_to_id_(resource_)
+		, route_stops_(resource_)
+		, stops_(resource_)
+		, routes_(resource_)
+	{
+	}
+
+	TransportCatalogue::TransportCatalogue(const TransportCatalogue& other)
+		: TransportCatalogue(other.arena_ ? AllocationMode::ARENA : AllocationMode::HEAP)
+	{
+		for (const Stop& stop : other.stops_) {
+			AddStop(stop.name, stop.coords);
+		}
+		for (const Bus& route : other.routes_) {
+			AddRouteStops(route.name, pmr::vector<StopId>(other.route_stops_[route.id], resource_), route.isRing);
+		}
+
+		distance_mode_ = other.distance_mode_;
+		// ids are the same, so the id based indexes can be copied as they are
+		stops_distance_ = other.stops_distance_;
+		stop_to_buses_ = other.stop_to_buses_;
+		spatial_index_ = other.spatial_index_;
+		route_segments_ = other.route_segments_;
+		timetable_ = other.timetable_;
+		stops_by_name_ = other.stops_by_name_;
+		routes_by_name_ = other.routes_by_name_;
+		route_info_ = other.route_info_;
+		for (BusId id = 0; id < route_info_.size(); ++id) {
+			if (route_info_[id]) {
+				route_info_[id]->name = routes_[id].name;
+			}
+		}
+		version_ = other.version_;
+	}
+
+	void TransportCatalogue::AddRoute(std::string_view name, const std::vector<std::string>& stopnames, bool isRing)
 	{
 		size_t stop_amount = 0;
 		if (stopnames.size()) {
 			stop_amount = stopnames.size() * (isRing ? 1 : 2) - (isRing ? 0 : 1);
 		}
 		
-		vector<const Stop*> stop_ptrs(stop_amount);
+		pmr::vector<StopId> stop_ids(stop_amount, resource_);
 
 		if (stopnames.size()) {
 
-			transform(stopnames.cbegin(), stopnames.cend(), stop_ptrs.begin(), [this](const auto& stopname) {
-				return GetStop(stopname);
+			// resolved before anything is added, so an unknown stop leaves the catalogue as it was
+			transform(stopnames.cbegin(), stopnames.cend(), stop_ids.begin(), [this](const auto& stopname) {
+				const auto it = stopname_to_id_.find(stopname);
+				if (it == stopname_to_id_.end()) {
+					throw invalid_argument("unknown stop "s + stopname);
+				}
+				return it->second;
 				});
 
 			if (!isRing) {
-				auto it = stop_ptrs.begin();
+				auto it = stop_ids.begin();
 				advance(it, stopnames.size());
-				transform(++stopnames.crbegin(), stopnames.crend(), it, [this](const auto& stopname) {
-					return GetStop(stopname);
-					});
+				reverse_copy(stop_ids.cbegin(), stop_ids.cbegin() + stopnames.size() - 1, it);
 			}
 
 		}
 
-		routes_.push_front({ name, std::move(stop_ptrs), isRing });
-		busname_to_bus_[routes_.front().name] = &routes_.front();
+		AddRouteStops(name, std::move(stop_ids), isRing);
+	}
+
+	void TransportCatalogue::AddRouteStops(std::string_view name, std::pmr::vector<StopId> stop_ids, bool isRing)
+	{
+		vector<StopId> unique_stop_ids(stop_ids.cbegin(), stop_ids.cend());
+		sort(unique_stop_ids.begin(), unique_stop_ids.end());
+		unique_stop_ids.erase(unique(unique_stop_ids.begin(), unique_stop_ids.end()), unique_stop_ids.end());
 
-		for (auto stop_ptr : routes_.front().stops) {
-			stopname_to_buses_[stop_ptr->name].insert(&routes_.front());
+		const BusId id = AppendRoute(name, std::move(stop_ids), isRing);
+		for (StopId stop_id : unique_stop_ids) {
+			stop_to_buses_.Add(stop_id, id);
 		}
 	}
 
-	void TransportCatalogue::AddStop(std::string name, ::geo::Coordinates coords)
+	BusId TransportCatalogue::AppendRoute(std::string_view name, std::pmr::vector<StopId> stop_ids, bool isRing)
 	{
-		stops_.push_front({ name, coords });
-		stopname_to_stop_[stops_.front().name] = &stops_.front();
+		pmr::vector<const Stop*> stop_ptrs(stop_ids.size(), resource_);
+		transform(stop_ids.cbegin(), stop_ids.cend(), stop_ptrs.begin(), [this](StopId stop_id) {
+			return &stops_[stop_id];
+			});
+
+		const BusId id = static_cast<BusId>(routes_.size());
+		routes_.push_back({ pmr::string(name, resource_), std::move(stop_ptrs), isRing, id });
+		const auto [name_it, new_name] = busname_to_id_.emplace(routes_.back().name, id);
+		if (!new_name) {
+			name_it->second = id;
+			repeated_bus_names_ = true;
+		}
+		routes_by_name_.Add(id);
+
+		route_stops_.push_back(std::move(stop_ids));
+		route_info_.emplace_back();
+		++version_;
+
+		return id;
+	}
+
+	void TransportCatalogue::AddStop(std::string_view name, ::geo::Coordinates coords)
+	{
+		const StopId id = static_cast<StopId>(stops_.size());
+		stops_.push_back({ pmr::string(name, resource_), coords, id });
+		stopname_to_id_[stops_.back().name] = id;
+		stops_by_name_.Add(id);
+		stop_points_.Add(coords);
+		++version_;
+	}
+
+	void TransportCatalogue::AddBulk(const std::vector<StopDescription>& stops, const std::vector<BusDescription>& buses,
+		const std::vector<DistanceDescription>& distances, unsigned threads)
+	{
+		stopname_to_id_.reserve(stopname_to_id_.size() + stops.size());
+		for (const auto& stop : stops) {
+			AddStop(stop.name, stop.coords);
+		}
+
+		// name lookups are read-only from here on, so the workers share the map
+		const auto resolve = [this](string_view stopname) {
+			const auto it = stopname_to_id_.find(stopname);
+			return it == stopname_to_id_.end() ? optional<StopId>{} : optional<StopId>{ it->second };
+		};
+		const auto throw_unknown = [](string_view stopname) {
+			throw invalid_argument("unknown stop "s + string(stopname));
+		};
+
+		// full stop sequences of all buses in one array
+		vector<size_t> bus_offsets(buses.size() + 1, 0);
+		for (size_t i = 0; i < buses.size(); ++i) {
+			const size_t count = buses[i].stopnames.size();
+			bus_offsets[i + 1] = bus_offsets[i] + (buses[i].isRing || !count ? count : count * 2 - 1);
+		}
+
+		vector<StopId> bus_stops(bus_offsets.back());
+		vector<vector<StopId>> bus_unique_stops(buses.size());
+		vector<char> bus_failed(buses.size(), false);
+		utils::ParallelFor(buses.size(), threads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const auto& stopnames = buses[i].stopnames;
+				auto out = bus_stops.begin() + bus_offsets[i];
+				for (const auto stopname : stopnames) {
+					const auto stop_id = resolve(stopname);
+					if (!stop_id) {
+						bus_failed[i] = true;
+						break;
+					}
+					*out++ = *stop_id;
+				}
+				if (bus_failed[i]) {
+					continue;
+				}
+				if (!buses[i].isRing && !stopnames.empty()) {
+					const auto first = bus_stops.begin() + bus_offsets[i];
+					reverse_copy(first, first + stopnames.size() - 1, out);
+				}
+
+				auto& unique_stops = bus_unique_stops[i];
+				unique_stops.assign(bus_stops.begin() + bus_offsets[i], bus_stops.begin() + bus_offsets[i + 1]);
+				sort(unique_stops.begin(), unique_stops.end());
+				unique_stops.erase(unique(unique_stops.begin(), unique_stops.end()), unique_stops.end());
+			}
+			});
+
+		vector<pair<StopId, StopId>> distance_ids(distances.size());
+		vector<char> distance_failed(distances.size(), false);
+		utils::ParallelFor(distances.size(), threads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const auto from = resolve(distances[i].from);
+				const auto to = resolve(distances[i].to);
+				if (!from || !to) {
+					distance_failed[i] = true;
+					continue;
+				}
+				distance_ids[i] = { *from, *to };
+			}
+			});
+
+		for (size_t i = 0; i < buses.size(); ++i) {
+			if (bus_failed[i]) {
+				for (const auto stopname : buses[i].stopnames) {
+					if (!resolve(stopname)) {
+						throw_unknown(stopname);
+					}
+				}
+			}
+		}
+		for (size_t i = 0; i < distances.size(); ++i) {
+			if (distance_failed[i]) {
+				throw_unknown(resolve(distances[i].from) ? distances[i].to : distances[i].from);
+			}
+		}
+
+		busname_to_id_.reserve(busname_to_id_.size() + buses.size());
+		for (size_t i = 0; i < buses.size(); ++i) {
+			const BusId id = AppendRoute(buses[i].name,
+				pmr::vector<StopId>(bus_stops.begin() + bus_offsets[i], bus_stops.begin() + bus_offsets[i + 1], resource_),
+				buses[i].isRing);
+			for (StopId stop_id : bus_unique_stops[i]) {
+				stop_to_buses_.Add(stop_id, id);
+			}
+		}
+		stop_to_buses_.Build(routes_, threads);
+		route_segments_.Build(routes_, threads);
+		stops_by_name_.Build(stops_, threads);
+		routes_by_name_.Build(routes_, threads);
+
+		for (size_t i = 0; i < distances.size(); ++i) {
+			stops_distance_.Set(distance_ids[i].first, distance_ids[i].second, distances[i].distance);
+		}
+		stops_distance_.Build(threads);
+		if (!distances.empty()) {
+			for (auto& route_info : route_info_) {
+				route_info.reset();
+			}
+			version_ += distances.size();
+		}
 	}
 
 	const Bus* TransportCatalogue::GetRoute(std::string_view busname) const
 	{
-		auto it = busname_to_bus_.find(busname);
+		auto it = busname_to_id_.find(busname);
 
-		if (it == busname_to_bus_.end()) {
+		if (it == busname_to_id_.end()) {
 			return nullptr;
 		}
 
-		return it->second;
+		return &routes_[it->second];
+	}
+
+	const Bus* TransportCatalogue::GetRoute(BusId id) const
+	{
+		return id < routes_.size() ? &routes_[id] : nullptr;
 	}
 
 	const Stop* TransportCatalogue::GetStop(std::string_view stopname) const
 	{
-		auto it = stopname_to_stop_.find(stopname);
+		auto it = stopname_to_id_.find(stopname);
 
-		if (it == stopname_to_stop_.end()) {
+		if (it == stopname_to_id_.end()) {
 			return nullptr;
 		}
 
-		return it->second;
+		return &stops_[it->second];
+	}
+
+	const Stop* TransportCatalogue::GetStop(StopId id) const
+	{
+		return id < stops_.size() ? &stops_[id] : nullptr;
+	}
+
+	size_t TransportCatalogue::GetRouteCount() const
+	{
+		return routes_.size();
+	}
+
+	size_t TransportCatalogue::GetStopCount() const
+	{
+		return stops_.size();
+	}
+
+	const std::pmr::vector<StopId>& TransportCatalogue::GetRouteStops(BusId id) const
+	{
+		return route_stops_[id];
 	}
 
 	RouteInfo TransportCatalogue::GetRouteInfo(string_view routename) const
@@ -79,23 +294,53 @@ namespace transport {
 
 	RouteInfo TransportCatalogue::GetRouteInfo(const Bus& route) const
 	{
-		unordered_set<string_view> unique_stops;
+		return GetRouteInfo(route.id);
+	}
+
+	RouteInfo TransportCatalogue::GetRouteInfo(BusId id) const
+	{
+		auto& route_info = route_info_[id];
+		if (!route_info) {
+			route_info = ComputeRouteInfo(id);
+		}
+		return *route_info;
+	}
+
+	RouteInfo TransportCatalogue::ComputeRouteInfo(BusId id) const
+	{
+		const Bus& route = routes_[id];
+		const auto& route_stops = route_stops_[id];
+
+		size_t unique_stops = 0;
 		double route_length = 0;
 		double geo_route_length = 0;
 
-		if (route.stops.size()) {
+		if (route_stops.size()) {
+
+			vector<StopId> sorted_stops(route_stops.cbegin() + 1, route_stops.cend());
+			sort(sorted_stops.begin(), sorted_stops.end());
+			unique_stops = unique(sorted_stops.begin(), sorted_stops.end()) - sorted_stops.begin();
 
-			for (unsigned int i = 1; i < route.stops.size(); ++i) {
-				unique_stops.insert(route.stops[i]->name);
-				geo_route_length += ::geo::ComputeDistance(route.stops[i - 1]->coords, route.stops[i]->coords);
-				route_length += GetDistance(route.stops[i - 1]->name, route.stops[i]->name);
+			// segment i goes from route_stops[i] to route_stops[i + 1]
+			vector<double> geo_lengths(route_stops.size() - 1);
+			if (distance_mode_ == ::geo::DistanceMode::EXACT) {
+				stop_points_.ComputeDistances(route_stops.data(), route_stops.data() + 1, geo_lengths.size(), geo_lengths.data());
+			}
+			else {
+				for (size_t i = 0; i < geo_lengths.size(); ++i) {
+					geo_lengths[i] = ::geo::ComputeDistance(stops_[route_stops[i]].coords, stops_[route_stops[i + 1]].coords, distance_mode_);
+				}
+			}
+			for (unsigned int i = 1; i < route_stops.size(); ++i) {
+				geo_route_length += geo_lengths[i - 1];
+				route_length += GetDistance(route_stops[i - 1], route_stops[i]);
 			}
 
 		}
 
 		double curvature = route_length / geo_route_length;
 
-		return { route.name, route.stops.size(), unique_stops.size(), route_length, curvature };
+		return { route.name, route_stops.size(), unique_stops, route_length, geo_route_length, curvature };
 	}
 
 	StopInfo TransportCatalogue::GetStopInfo(string_view stopname) const
@@ -105,34 +350,209 @@ namespace transport {
 
 	StopInfo TransportCatalogue::GetStopInfo(const Stop& stop) const
 	{
-		return { stop.name,
-			stopname_to_buses_.count(stop.name) ?
-			std::optional<std::reference_wrapper<const BusSet>>{ stopname_to_buses_.at(stop.name) } : std::nullopt };
+		return GetStopInfo(stop.id);
+	}
+
+	StopInfo TransportCatalogue::GetStopInfo(StopId id) const
+	{
+		if (stop_to_buses_.HasPending()) {
+			stop_to_buses_.Build(routes_);
+		}
+
+		const BusRange buses = stop_to_buses_.GetBuses(id, routes_);
+		return { stops_[id].name, buses.empty() ? std::nullopt : std::optional<BusRange>{ buses } };
 	}
 
 	void TransportCatalogue::SetDistance(std::string_view stopname_from, std::string_view stopname_to, unsigned int distance) {
-		stops_distance_[{ GetStop(stopname_from), GetStop(stopname_to) }] = distance;
+		const auto from = stopname_to_id_.find(stopname_from);
+		const auto to = stopname_to_id_.find(stopname_to);
+		if (from == stopname_to_id_.end() || to == stopname_to_id_.end()) {
+			throw invalid_argument("unknown stop "s + string(from == stopname_to_id_.end() ? stopname_from : stopname_to));
+		}
+		SetDistance(from->second, to->second, distance);
 	}
 
-	unsigned int TransportCatalogue::GetDistance(std::string_view stopname_from, std::string_view stopname_to) const {
-		auto key = std::make_pair<const Stop*, const Stop*>(GetStop(stopname_from), GetStop(stopname_to));
-		if (!stops_distance_.count(key)) {
-			key = std::make_pair<const Stop*, const Stop*>(GetStop(stopname_to), GetStop(stopname_from));
+	void TransportCatalogue::SetDistance(StopId from, StopId to, unsigned int distance) {
+		stops_distance_.Set(from, to, distance);
+		++version_;
+
+		// any route using the from-to segment (in either direction) passes through "from";
+		// the index keeps one bus per name, so with repeated names every route is checked
+		if (repeated_bus_names_) {
+			for (BusId id = 0; id < routes_.size(); ++id) {
+				if (find(route_stops_[id].begin(), route_stops_[id].end(), from) != route_stops_[id].end()) {
+					route_info_[id].reset();
+				}
+			}
+			return;
+		}
+		if (stop_to_buses_.HasPending()) {
+			stop_to_buses_.Build(routes_);
 		}
+		const BusRange buses = stop_to_buses_.GetBuses(from, routes_);
+		for (auto it = buses.ids_begin(); it != buses.ids_end(); ++it) {
+			route_info_[*it].reset();
+		}
+	}
 
-		if (!stops_distance_.count(key)) {
+	unsigned int TransportCatalogue::GetDistance(std::string_view stopname_from, std::string_view stopname_to) const {
+		const auto from = stopname_to_id_.find(stopname_from);
+		const auto to = stopname_to_id_.find(stopname_to);
+		if (from == stopname_to_id_.end() || to == stopname_to_id_.end()) {
 			return 0;
 		}
+		return GetDistance(from->second, to->second);
+	}
+
+	unsigned int TransportCatalogue::GetDistance(StopId from, StopId to) const {
+		if (stops_distance_.HasPending()) {
+			stops_distance_.Build();
+		}
+		return stops_distance_.Get(from, to);
+	}
+
+	void TransportCatalogue::Finalize() {
+		stops_distance_.Build();
+		stop_to_buses_.Build(routes_);
+		GetSpatialIndex();
+		GetRouteSegmentIndex();
+		GetTimetable();
+		stops_by_name_.Build(stops_);
+		routes_by_name_.Build(routes_);
+		for (BusId id = 0; id < routes_.size(); ++id) {
+			GetRouteInfo(id);
+		}
+	}
+
+	uint64_t TransportCatalogue::GetVersion() const {
+		return version_;
+	}
+
+	const DistanceTable& TransportCatalogue::GetDistanceTable() const {
+		if (stops_distance_.HasPending()) {
+			stops_distance_.Build();
+		}
+		return stops_distance_;
+	}
+
+	const StopBusIndex& TransportCatalogue::GetStopBusIndex() const {
+		if (stop_to_buses_.HasPending()) {
+			stop_to_buses_.Build(routes_);
+		}
+		return stop_to_buses_;
+	}
+
+	TripId TransportCatalogue::AddTrip(std::string_view busname, const std::vector<uint32_t>& times) {
+		const Bus* route = GetRoute(busname);
+		if (!route) {
+			throw invalid_argument("unknown bus "s + string(busname));
+		}
+		const auto& stops = route_stops_[route->id];
+		if (times.size() != stops.size()) {
+			throw invalid_argument("bus "s + string(busname) + " has " + to_string(stops.size()) + " stops, trip has " + to_string(times.size()) + " times");
+		}
+		if (!is_sorted(times.begin(), times.end())) {
+			throw invalid_argument("trip times of bus "s + string(busname) + " go back");
+		}
+
+		const TripId trip = timetable_.AddTrip(route->id, stops, times);
+		++version_;
+		return trip;
+	}
+
+	const Timetable& TransportCatalogue::GetTimetable() const {
+		if (timetable_.HasPending()) {
+			timetable_.Build();
+		}
+		return timetable_;
+	}
 
-		return stops_distance_.at(key);
+	size_t TransportCatalogue::GetDistanceMemoryUsage() const {
+		return stops_distance_.GetMemoryUsage();
+	}
+
+	void TransportCatalogue::SetDistanceMode(::geo::DistanceMode mode) {
+		if (mode == distance_mode_) {
+			return;
+		}
+		distance_mode_ = mode;
+		for (auto& route_info : route_info_) {
+			route_info.reset();
+		}
+		++version_;
+	}
+
+	::geo::DistanceMode TransportCatalogue::GetDistanceMode() const {
+		return distance_mode_;
+	}
+
+	const StopSpatialIndex& TransportCatalogue::GetSpatialIndex() const {
+		// stops are only ever appended, so a size mismatch means new stops
+		if (spatial_index_.Size() != stops_.size() || spatial_index_.GetMode() != distance_mode_) {
+			std::vector<::geo::Coordinates> coords;
+			coords.reserve(stops_.size());
+			for (const Stop& stop : stops_) {
+				coords.push_back(stop.coords);
+			}
+			spatial_index_.Build(coords, distance_mode_);
+		}
+		return spatial_index_;
+	}
+
+	const RouteSegmentIndex& TransportCatalogue::GetRouteSegmentIndex() const {
+		// routes are only ever appended and never change
+		if (route_segments_.GetRouteCount() != routes_.size()) {
+			route_segments_.Build(routes_);
+		}
+		return route_segments_;
+	}
+
+	std::vector<const Bus*> TransportCatalogue::SortByName(const std::vector<BusId>& ids) const {
+		vector<const Bus*> buses;
+		buses.reserve(ids.size());
+		for (BusId id : ids) {
+			buses.push_back(&routes_[id]);
+		}
+		sort(buses.begin(), buses.end(), BusComparator{});
+		return buses;
+	}
+
+	std::vector<const Bus*> TransportCatalogue::FindBusesNear(::geo::Coordinates center, double meters) const {
+		return SortByName(GetRouteSegmentIndex().FindNear(center, meters));
+	}
+
+	std::vector<const Bus*> TransportCatalogue::FindBusesInBox(::geo::Coordinates south_west, ::geo::Coordinates north_east) const {
+		return SortByName(GetRouteSegmentIndex().FindInBox(south_west, north_east));
+	}
+
+	std::vector<NearbyStop> TransportCatalogue::FindStopsWithinRadius(::geo::Coordinates center, double meters) const {
+		return GetSpatialIndex().FindWithinRadius(center, meters);
+	}
+
+	std::vector<NearbyStop> TransportCatalogue::FindNearestStops(::geo::Coordinates center, size_t count) const {
+		return GetSpatialIndex().FindNearest(center, count);
+	}
+
+	NameRange<Stop> TransportCatalogue::GetStopsByName() const {
+		if (stops_by_name_.HasPending()) {
+			stops_by_name_.Build(stops_);
+		}
+		return stops_by_name_.GetRange(stops_);
+	}
+
+	NameRange<Bus> TransportCatalogue::GetRoutesByName() const {
+		if (routes_by_name_.HasPending()) {
+			routes_by_name_.Build(routes_);
+		}
+		return routes_by_name_.GetRange(routes_);
 	}
 
 	std::set<std::string> TransportCatalogue::GetStopNames() const {
 
 		std::set<std::string> result;
 
-		for (const auto& stop : stops_) {
-			result.insert(stop.name);
+		for (const Stop* stop : GetStopsByName()) {
+			result.emplace_hint(result.end(), stop->name);
 		}
 
 		return result;
@@ -143,8 +563,8 @@ namespace transport {
 		
 		std::set<std::string> result;
 
-		for (const auto& bus : routes_) {
-			result.insert(bus.name);
+		for (const Bus* bus : GetRoutesByName()) {
+			result.emplace_hint(result.end(), bus->name);
 		}
 
 		return result;
@@ -181,6 +601,34 @@ namespace transport {
 			assert(route999.length == 200);
 			assert(route999.curvature == 8.6733320170381233e-06);
 
+			// id-based access mirrors name-based one
+			const Stop* stop_b = catalogue.GetStop("stop B");
+			assert(stop_b->id == 1);
+			assert(catalogue.GetStop(stop_b->id) == stop_b);
+			assert(!catalogue.GetStop(StopId{ 100 }));
+			assert(catalogue.GetStopCount() == 6);
+			assert(catalogue.GetDistance(stop_b->id, catalogue.GetStop("stop A")->id) == 100);
+
+			const Bus* bus999 = catalogue.GetRoute("bus 999");
+			assert(bus999->id == 1);
+			assert(catalogue.GetRoute(bus999->id) == bus999);
+			assert(catalogue.GetRouteCount() == 2);
+			assert(catalogue.GetRouteStops(bus999->id).size() == 5);
+			assert(catalogue.GetRouteStops(bus999->id)[3] == stop_b->id);
+			assert(catalogue.GetRouteInfo(bus999->id).length == route999.length);
+			assert(catalogue.GetStopInfo(stop_b->id).buses->size() == 1);
+
+			// the distance mode changes geo lengths, not road lengths
+			const uint64_t version = catalogue.GetVersion();
+			catalogue.SetDistanceMode(::geo::DistanceMode::HAVERSINE);
+			assert(catalogue.GetVersion() > version && catalogue.GetDistanceMode() == ::geo::DistanceMode::HAVERSINE);
+			const RouteInfo haversine999 = catalogue.GetRouteInfo(bus999->id);
+			assert(haversine999.length == route999.length);
+			assert(std::abs(haversine999.geo_length - route999.geo_length) < 1e-3);
+			catalogue.SetDistanceMode(::geo::DistanceMode::EQUIRECTANGULAR);
+			assert(catalogue.GetRouteInfo(bus999->id).geo_length != haversine999.geo_length);
+			assert(catalogue.FindNearestStops({ 54.8, 46.6 }, 1)[0].id == stop_b->id);
+			assert(TransportCatalogue(catalogue).GetDistanceMode() == ::geo::DistanceMode::EQUIRECTANGULAR);
 		}
 
 		void TestCornerCases()
@@ -195,12 +643,46 @@ namespace transport {
 			catalogue.SetDistance("  ", "A", 1000);
 			assert(catalogue.GetDistance("A", "  ") == 1000);
 
+			// unknown stops: no distance to read, none to set
+			assert(catalogue.GetDistance("A", "Z") == 0 && catalogue.GetDistance("Z", "A") == 0);
+			for (const auto& [from, to] : { std::pair{ "A", "Z" }, std::pair{ "Z", "A" } }) {
+				bool thrown = false;
+				try {
+					catalogue.SetDistance(from, to, 100);
+				}
+				catch (const std::invalid_argument&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+
 			catalogue.SetDistance("A", "A", 300);
 			catalogue.AddRoute("cyclic", { "A", "A", "A" }, false);
 			auto cyclic_info = catalogue.GetRouteInfo("cyclic");
 			assert(cyclic_info.length == 1200);
 			assert(cyclic_info.unique_stops_amount == 1);
 
+			// cached route info follows distance updates
+			catalogue.SetDistance("A", "A", 500);
+			assert(catalogue.GetRouteInfo("cyclic").length == 2000);
+			catalogue.SetDistance("  ", "A", 10);
+			assert(catalogue.GetRouteInfo("cyclic").length == 2000);
+
+			// a route through an unknown stop is refused and leaves no trace
+			{
+				const size_t route_count = catalogue.GetRouteCount();
+				const uint64_t version = catalogue.GetVersion();
+				bool thrown = false;
+				try {
+					catalogue.AddRoute("unknown", { "A", "Z" }, false);
+				}
+				catch (const std::invalid_argument&) {
+					thrown = true;
+				}
+				assert(thrown && catalogue.GetRouteCount() == route_count && catalogue.GetVersion() == version);
+				assert(catalogue.GetRoute("unknown") == nullptr);
+			}
+
 			catalogue.AddRoute("empty", {  }, true);
 			assert(catalogue.GetRouteInfo("empty").stops_amount == 0);
 			catalogue.AddRoute("empty ring", {  }, true);
@@ -215,6 +697,215 @@ namespace transport {
 			auto overflow_info = catalogue.GetRouteInfo("B2C_and_back");
 			assert(overflow_info.length == max_value * 2.0);
 
+			// spatial queries see stops added after the previous query
+			assert(catalogue.FindNearestStops({ 0, 0 }, 1)[0].id == catalogue.GetStop("  ")->id);
+			catalogue.AddStop("D", { .0, .001 });
+			const auto nearby = catalogue.FindStopsWithinRadius({ 0, 0 }, 200);
+			assert(nearby.size() == 2 && nearby[1].id == catalogue.GetStop("D")->id);
+			assert(catalogue.FindNearestStops({ 0, 0 }, 10).size() == 5);
+
+			// bus corridors see routes added after the previous query, sorted by name
+			assert(catalogue.FindBusesNear({ -0.0001, 0.0005 }, 30).empty());
+			catalogue.AddRoute("z", { "  ", "D" }, false);
+			catalogue.AddRoute("y", { "D", "  " }, true);
+			const auto corridor = catalogue.FindBusesNear({ -0.0001, 0.0005 }, 30);
+			assert(corridor.size() == 2 && corridor[0]->name == "y" && corridor[1]->name == "z");
+			assert(catalogue.FindBusesInBox({ -0.001, 0.0002 }, { 0.00001, 0.0003 }).size() == 2);
+			assert(catalogue.FindBusesInBox({ 0.001, 0.0002 }, { 0.002, 0.0003 }).empty());
+
+			// trips follow the full stop sequence: B, C, B
+			const uint64_t version = catalogue.GetVersion();
+			const TripId trip = catalogue.AddTrip("B2C_and_back", { 100, 200, 300 });
+			assert(catalogue.GetVersion() > version);
+			assert(catalogue.GetTimetable().GetConnections().size() == 2);
+			assert(catalogue.GetTimetable().GetTripBus(trip) == catalogue.GetRoute("B2C_and_back")->id);
+			for (const std::vector<uint32_t>& times : { std::vector<uint32_t>{ 100, 200 }, std::vector<uint32_t>{ 100, 300, 200 } }) {
+				bool thrown = false;
+				try {
+					catalogue.AddTrip("B2C_and_back", times);
+				}
+				catch (const std::invalid_argument&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+			assert(TransportCatalogue(catalogue).GetTimetable().GetConnections().size() == 2);
+
+			// name order follows additions; a repeated name yields the stop its name resolves to
+			const auto names = [](const auto& range) {
+				std::vector<std::string> result;
+				for (const auto* item : range) {
+					result.emplace_back(item->name);
+				}
+				return result;
+			};
+			assert(names(catalogue.GetStopsByName()) == (std::vector<std::string>{ "  ", "A", "B", "C", "D" }));
+			catalogue.AddStop("B", { 1, 1 });
+			catalogue.AddStop("AA", { 1, 1 });
+			assert(names(catalogue.GetStopsByName()) == (std::vector<std::string>{ "  ", "A", "AA", "B", "C", "D" }));
+			assert(*std::next(catalogue.GetStopsByName().begin(), 3) == catalogue.GetStop("B"));
+			assert(names(catalogue.GetRoutesByName()) == (std::vector<std::string>{ " ", "B2C_and_back", "cyclic", "empty", "empty ring", "y", "z" }));
+			assert(catalogue.GetRouteNames().size() == catalogue.GetRoutesByName().size());
+			assert(names(TransportCatalogue(catalogue).GetStopsByName()) == names(catalogue.GetStopsByName()));
+
+			// arena mode behaves the same
+			TransportCatalogue arena_catalogue(AllocationMode::ARENA);
+			arena_catalogue.AddStop("a rather long stop name that does not fit into SSO", { 53.199489, -105.759253 });
+			arena_catalogue.AddStop("B", { 54.840504, 46.591607 });
+			arena_catalogue.SetDistance("B", "a rather long stop name that does not fit into SSO", 700);
+			arena_catalogue.AddRoute("long", { "a rather long stop name that does not fit into SSO", "B" }, false);
+			assert(arena_catalogue.GetRouteInfo("long").length == 1400);
+			assert(arena_catalogue.GetRoute("long")->stops[2]->name == "a rather long stop name that does not fit into SSO");
+
+			// buses added again under a name keep following distance updates, the hidden ones too
+			TransportCatalogue repeated;
+			repeated.AddStop("A", { 55.6, 37.2 });
+			repeated.AddStop("B", { 55.61, 37.21 });
+			for (int i = 0; i < 3; ++i) {
+				repeated.AddRoute("X", { "A", "B" }, false);
+			}
+			repeated.SetDistance("A", "B", 1000);
+			assert(repeated.GetRouteInfo("X").length == 2000 && repeated.GetRouteInfo(BusId{ 1 }).length == 2000);
+			repeated.SetDistance("B", "A", 5000);
+			assert(repeated.GetRouteInfo("X").length == 6000 && repeated.GetRouteInfo(BusId{ 1 }).length == 6000);
+			repeated.SetDistance("A", "B", 5000);
+			assert(repeated.GetRouteInfo("X").length == 10000 && repeated.GetRouteInfo(BusId{ 1 }).length == 10000);
+
+		}
+
+		void TestBulkLoad()
+		{
+			// deterministic pseudo-random network, big enough for the parallel sorts to split
+			uint32_t seed = 12345;
+			const auto next_random = [&seed](uint32_t bound) {
+				seed = seed * 1103515245 + 12345;
+				return (seed >> 8) % bound;
+			};
+
+			std::vector<std::string> stop_names;
+			std::vector<StopDescription> stops;
+			for (int i = 0; i < 6000; ++i) {
+				stop_names.push_back("stop " + std::to_string(i));
+			}
+			for (int i = 0; i < 6000; ++i) {
+				stops.push_back({ stop_names[i], { 55.0 + next_random(1000) * 1e-4, 37.0 + next_random(1000) * 1e-4 } });
+			}
+
+			std::vector<std::string> bus_names;
+			std::vector<BusDescription> buses;
+			for (int i = 0; i < 3000; ++i) {
+				bus_names.push_back("bus " + std::to_string(next_random(2500))); // some names repeat
+			}
+			for (int i = 0; i < 3000; ++i) {
+				BusDescription bus{ bus_names[i], {}, next_random(2) == 0 };
+				const uint32_t stop_count = next_random(12);
+				for (uint32_t j = 0; j < stop_count; ++j) {
+					bus.stopnames.push_back(stop_names[next_random(6000)]);
+				}
+				if (bus.isRing && !bus.stopnames.empty()) {
+					bus.stopnames.push_back(bus.stopnames.front());
+				}
+				buses.push_back(std::move(bus));
+			}
+
+			std::vector<DistanceDescription> distances;
+			for (int i = 0; i < 40000; ++i) {
+				distances.push_back({ stop_names[next_random(6000)], stop_names[next_random(6000)], next_random(5000) });
+			}
+
+			TransportCatalogue sequential;
+			for (const auto& stop : stops) {
+				sequential.AddStop(stop.name, stop.coords);
+			}
+			for (const auto& bus : buses) {
+				sequential.AddRoute(bus.name, std::vector<std::string>(bus.stopnames.begin(), bus.stopnames.end()), bus.isRing);
+			}
+			for (const auto& distance : distances) {
+				sequential.SetDistance(distance.from, distance.to, distance.distance);
+			}
+
+			TransportCatalogue bulk(AllocationMode::ARENA);
+			bulk.AddBulk(stops, buses, distances, 4);
+
+			assert(bulk.GetStopCount() == sequential.GetStopCount());
+			assert(bulk.GetRouteCount() == sequential.GetRouteCount());
+			for (BusId id = 0; id < sequential.GetRouteCount(); ++id) {
+				assert(bulk.GetRoute(id)->name == sequential.GetRoute(id)->name);
+				assert(bulk.GetRouteStops(id) == sequential.GetRouteStops(id));
+				const RouteInfo expected = sequential.GetRouteInfo(id);
+				const RouteInfo actual = bulk.GetRouteInfo(id);
+				assert(actual.unique_stops_amount == expected.unique_stops_amount && actual.length == expected.length);
+			}
+			for (StopId id = 0; id < sequential.GetStopCount(); ++id) {
+				const auto expected = sequential.GetStopInfo(id).buses;
+				const auto actual = bulk.GetStopInfo(id).buses;
+				assert(expected.has_value() == actual.has_value());
+				assert(!expected || std::equal(expected->ids_begin(), expected->ids_end(), actual->ids_begin(), actual->ids_end()));
+			}
+			assert(bulk.GetDistanceTable().GetOffsets() == sequential.GetDistanceTable().GetOffsets());
+			for (const auto& distance : distances) {
+				assert(bulk.GetDistance(distance.from, distance.to) == sequential.GetDistance(distance.from, distance.to));
+				assert(bulk.GetDistance(distance.to, distance.from) == sequential.GetDistance(distance.to, distance.from));
+			}
+
+			bool rejected = false;
+			try {
+				TransportCatalogue broken;
+				broken.AddBulk({ { "A", { 55.0, 37.0 } } }, { { "1", { "A", "B" }, false } }, {});
+			}
+			catch (const std::invalid_argument&) {
+				rejected = true;
+			}
+			assert(rejected);
+		}
+
+		void BenchmarkBulkLoad()
+		{
+			using Clock = std::chrono::steady_clock;
+			const auto ms = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+			// 200000 stops, 20000 buses of 25 stops, 500000 distances
+			std::mt19937 generator(1);
+			std::uniform_int_distribution<size_t> stop(0, 199999);
+			std::uniform_real_distribution<double> lat(55.5, 56.), lng(37.3, 37.9);
+			std::vector<std::string> names;
+			for (int i = 0; i < 200000; ++i) {
+				names.push_back("stop " + std::to_string(i));
+			}
+			for (int i = 0; i < 20000; ++i) {
+				names.push_back("bus " + std::to_string(i));
+			}
+			std::vector<StopDescription> stops;
+			for (int i = 0; i < 200000; ++i) {
+				stops.push_back({ names[i], { lat(generator), lng(generator) } });
+			}
+			std::vector<BusDescription> buses;
+			for (int i = 0; i < 20000; ++i) {
+				BusDescription& bus = buses.emplace_back(BusDescription{ names[200000 + i], {}, i % 2 == 0 });
+				for (int j = 0; j < 25; ++j) {
+					bus.stopnames.push_back(names[stop(generator)]);
+				}
+			}
+			std::vector<DistanceDescription> distances;
+			for (int i = 0; i < 500000; ++i) {
+				distances.push_back({ names[stop(generator)], names[stop(generator)], static_cast<unsigned>(stop(generator)) });
+			}
+
+			// each part on its own: adding the stops and the buses themselves (names, storage, the name
+			// maps) is sequential, so the parts scale as far as their parallel share allows
+			std::cerr << "bulk load, " << std::thread::hardware_concurrency() << " hardware threads\n";
+			for (unsigned threads : { 1u, 2u, 4u, 8u }) {
+				TransportCatalogue catalogue(AllocationMode::ARENA);
+				const auto start = Clock::now();
+				catalogue.AddBulk(stops, {}, {}, threads);
+				const auto stops_done = Clock::now();
+				catalogue.AddBulk({}, buses, {}, threads);
+				const auto buses_done = Clock::now();
+				catalogue.AddBulk({}, {}, distances, threads);
+				const auto distances_done = Clock::now();
+				std::cerr << threads << " threads: stops " << ms(stops_done - start) << " ms, buses " << ms(buses_done - stops_done)
+					<< " ms, distances " << ms(distances_done - buses_done) << " ms, total " << ms(distances_done - start) << " ms\n";
+			}
 		}
 	}
 
@@ -1,8 +1,17 @@
 #pragma once
 
 #include "domain.h"
+#include "distance_table.h"
+#include "stop_bus_index.h"
+#include "spatial_index.h"
+#include "route_segment_index.h"
+#include "timetable.h"
+#include "name_index.h"
 #include "geo.h"
+#include "geo_batch.h"
+#include "parallel.h"
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -10,6 +19,8 @@
 #include <map>
 #include <set>
 #include <deque>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 #include <optional>
 #include <functional>
@@ -21,54 +32,156 @@ namespace transport {
 		size_t stops_amount;
 		size_t unique_stops_amount;
 		double length;
+		double geo_length;
 		double curvature;
 	};
 
 	struct StopInfo {
 		std::string_view name;
-		const std::optional<std::reference_wrapper<const BusSet>> buses;
+		const std::optional<BusRange> buses; // sorted by name; nullopt if no bus stops here
+	};
+
+	struct StopDescription {
+		std::string_view name;
+		::geo::Coordinates coords;
+	};
+
+	struct BusDescription {
+		std::string_view name;
+		std::vector<std::string_view> stopnames;
+		bool isRing;
+	};
+
+	struct DistanceDescription {
+		std::string_view from;
+		std::string_view to;
+		unsigned int distance;
+	};
+
+	enum class AllocationMode {
+		HEAP,  // every name and stop list is a separate heap allocation
+		ARENA, // names, stop lists, name lookup and stop/bus storage go to a monotonic arena freed with the catalogue
 	};
 
 	class TransportCatalogue {
 	public:
-		void AddRoute(std::string name, const std::vector<std::string>& stopnames, bool isRing);
-		void AddStop(std::string name, ::geo::Coordinates coords);
+		explicit TransportCatalogue(AllocationMode mode = AllocationMode::HEAP);
+		TransportCatalogue(const TransportCatalogue& other); // deep copy in the same allocation mode
+		TransportCatalogue(TransportCatalogue&& other) = default;
+		TransportCatalogue& operator=(const TransportCatalogue&) = delete;
+		TransportCatalogue& operator=(TransportCatalogue&&) = delete;
+
+		void AddRoute(std::string_view name, const std::vector<std::string>& stopnames, bool isRing); // throws std::invalid_argument for an unknown stop
+		void AddStop(std::string_view name, ::geo::Coordinates coords);
+
+		// Same result as AddStop for all stops, then AddRoute for all buses, then SetDistance
+		// for all distances, each in the given order. Name resolution, the route stop arrays and
+		// the index sorts run on "threads" threads; adding the stops and buses themselves (names,
+		// storage, the name maps) is sequential and bounds the speedup. Throws
+		// std::invalid_argument on an unknown stop name, after the stops are added.
+		void AddBulk(const std::vector<StopDescription>& stops, const std::vector<BusDescription>& buses,
+			const std::vector<DistanceDescription>& distances, unsigned threads = utils::DefaultThreadCount());
 
 		const Bus* GetRoute(std::string_view busname) const;
+		const Bus* GetRoute(BusId id) const;
 		const Stop* GetStop(std::string_view stopname) const;
+		const Stop* GetStop(StopId id) const;
+
+		size_t GetRouteCount() const;
+		size_t GetStopCount() const;
+
+		// full stop sequence of the route (non-ring routes are already unfolded)
+		const std::pmr::vector<StopId>& GetRouteStops(BusId id) const;
 
 		RouteInfo GetRouteInfo(std::string_view routename) const;
 		RouteInfo GetRouteInfo(const Bus& route) const;
+		RouteInfo GetRouteInfo(BusId id) const; // computed on first request, then cached until SetDistance touches the route
 
 		StopInfo GetStopInfo(std::string_view stopname) const;
 		StopInfo GetStopInfo(const Stop& stop) const;
-
-		void SetDistance(std::string_view stopname1, std::string_view stopname2, unsigned int distance);
-		unsigned int GetDistance(std::string_view stopname1, std::string_view stopname2) const;
-
+		StopInfo GetStopInfo(StopId id) const;
+
+		void SetDistance(std::string_view stopname1, std::string_view stopname2, unsigned int distance); // throws std::invalid_argument for an unknown stop
+		void SetDistance(StopId from, StopId to, unsigned int distance);
+		unsigned int GetDistance(std::string_view stopname1, std::string_view stopname2) const; // 0 for an unknown stop
+		unsigned int GetDistance(StopId from, StopId to) const;
+		size_t GetDistanceMemoryUsage() const; // bytes taken by the road distance table
+
+		// times: seconds from the start of the service day at every stop of the full stop sequence,
+		// not decreasing; throws std::invalid_argument on an unknown bus or a mismatching list
+		TripId AddTrip(std::string_view busname, const std::vector<uint32_t>& times);
+		const Timetable& GetTimetable() const;
+
+		// how straight (geo) distances are measured: route geo lengths and curvature, nearby stops;
+		// EXACT by default. A change drops the cached route info and bumps the version
+		void SetDistanceMode(::geo::DistanceMode mode);
+		::geo::DistanceMode GetDistanceMode() const;
+
+		// by straight (geo) distance, closest first
+		std::vector<NearbyStop> FindStopsWithinRadius(::geo::Coordinates center, double meters) const;
+		std::vector<NearbyStop> FindNearestStops(::geo::Coordinates center, size_t count) const;
+		// buses with a part of the way between stops within "meters" of center / through the box; sorted by name
+		std::vector<const Bus*> FindBusesNear(::geo::Coordinates center, double meters) const;
+		std::vector<const Bus*> FindBusesInBox(::geo::Coordinates south_west, ::geo::Coordinates north_east) const;
+
+		// built indexes, e.g. for serialization
+		const DistanceTable& GetDistanceTable() const;
+		const StopBusIndex& GetStopBusIndex() const;
+
+		// every name once, in name order, without allocating; valid until the next AddStop / AddRoute
+		NameRange<Stop> GetStopsByName() const;
+		NameRange<Bus> GetRoutesByName() const;
+		// copies of the same names
 		std::set<std::string> GetStopNames() const;
 		std::set<std::string> GetRouteNames() const;
 
-	private:
-		struct PtrPairHasher {
-			size_t operator()(std::pair<const Stop*, const Stop*> pair_) const noexcept {
-				return std::hash<const void*>{}(pair_.first) + 3 * std::hash<const void*>{}(pair_.second);
-			}
-		};
+		// Builds every lazily maintained index and route info. After it, and until
+		// the next modification, const queries do not write and are safe to run concurrently.
+		void Finalize();
+
+		// grows with every AddStop/AddRoute/SetDistance/AddTrip/SetDistanceMode; copies keep the version
+		uint64_t GetVersion() const;
 
 	private:
-		std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
-		std::unordered_map<std::string_view, const Bus*> busname_to_bus_;
-		std::unordered_map<std::pair<const Stop*, const Stop*>, unsigned int, PtrPairHasher> stops_distance_;
-		std::unordered_map<std::string_view, BusSet> stopname_to_buses_;
+		// stop_ids: full (unfolded) stop sequence
+		void AddRouteStops(std::string_view name, std::pmr::vector<StopId> stop_ids, bool isRing);
+		// adds the route without registering it in stop_to_buses_
+		BusId AppendRoute(std::string_view name, std::pmr::vector<StopId> stop_ids, bool isRing);
+		RouteInfo ComputeRouteInfo(BusId id) const;
+		const StopSpatialIndex& GetSpatialIndex() const;
+		const RouteSegmentIndex& GetRouteSegmentIndex() const;
+		std::vector<const Bus*> SortByName(const std::vector<BusId>& ids) const;
 
-		std::deque<Stop> stops_; // queue does not have iterators; and list is over-functional for the task
-		std::deque<Bus> routes_;
+	private:
+		std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_; // ARENA mode only
+		std::pmr::memory_resource* resource_;
+
+		std::pmr::unordered_map<std::string_view, StopId> stopname_to_id_;
+		std::pmr::unordered_map<std::string_view, BusId> busname_to_id_;
+		mutable DistanceTable stops_distance_; // rebuilt on the first read after new pairs were added
+		mutable StopBusIndex stop_to_buses_; // rebuilt on the first read after new routes were added
+		mutable StopSpatialIndex spatial_index_; // rebuilt on the first query after new stops were added
+		mutable RouteSegmentIndex route_segments_; // rebuilt on the first query after new routes were added
+		mutable Timetable timetable_; // rebuilt on the first read after new trips were added
+		mutable NameIndex<Stop> stops_by_name_; // rebuilt on the first read after new stops were added
+		mutable NameIndex<Bus> routes_by_name_; // rebuilt on the first read after new routes were added
+		std::pmr::vector<std::pmr::vector<StopId>> route_stops_; // index: BusId
+		mutable std::vector<std::optional<RouteInfo>> route_info_; // index: BusId
+
+		std::pmr::deque<Stop> stops_; // index: StopId; deque keeps pointers valid on growth
+		::geo::PreparedPoints stop_points_; // index: StopId
+		::geo::DistanceMode distance_mode_ = ::geo::DistanceMode::EXACT;
+		std::pmr::deque<Bus> routes_; // index: BusId
+
+		bool repeated_bus_names_ = false; // some bus was added under the name of another
+		uint64_t version_ = 0;
 	};
 
 	namespace tests {
 		void TestCommonCases();
 		void TestCornerCases();
+		void TestBulkLoad();
+		void BenchmarkBulkLoad(); // prints to std::cerr
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace transport::router {
+
+	using namespace std;
+
+	namespace {
+		constexpr double METERS_PER_KM = 1000;
+		constexpr double MINUTES_PER_HOUR = 60;
+
+		// stop vertices, then the on board vertices of every run
+		size_t CountVertices(const TransportCatalogue& catalogue) {
+			size_t count = catalogue.GetStopCount();
+			for (BusId bus = 0; bus < catalogue.GetRouteCount(); ++bus) {
+				const size_t stops = catalogue.GetRouteStops(bus).size();
+				count += catalogue.GetRoute(bus)->isRing ? stops : stops + 1;
+			}
+			return count;
+		}
+	}
+
+	TransportRouter::TransportRouter(const TransportCatalogue& catalogue, RoutingSettings settings)
+		: catalogue_(catalogue)
+		, settings_(settings)
+		, version_(catalogue.GetVersion())
+		, graph_(CountVertices(catalogue))
+	{
+		auto base = static_cast<graph::VertexId>(catalogue_.GetStopCount());
+
+		for (BusId bus = 0; bus < catalogue_.GetRouteCount(); ++bus) {
+
+			const auto& stops = catalogue_.GetRouteStops(bus);
+			if (stops.empty()) {
+				continue;
+			}
+
+			if (catalogue_.GetRoute(bus)->isRing) {
+				AddRun(bus, stops, 0, stops.size() - 1, base);
+				base += static_cast<graph::VertexId>(stops.size());
+			}
+			else {
+				// the unfolded sequence is there and back, both runs share the terminal
+				const size_t terminal = stops.size() / 2;
+				AddRun(bus, stops, 0, terminal, base);
+				AddRun(bus, stops, terminal, stops.size() - 1, base + static_cast<graph::VertexId>(terminal + 1));
+				base += static_cast<graph::VertexId>(stops.size() + 1);
+			}
+		}
+
+		graph_.Build();
+	}
+
+	void TransportRouter::AddRun(BusId bus, const std::pmr::vector<StopId>& stops, size_t first, size_t last, graph::VertexId base) {
+
+		const double meters_per_minute = settings_.bus_velocity * METERS_PER_KM / MINUTES_PER_HOUR;
+
+		for (size_t i = first; i <= last; ++i) {
+			const auto on_board = static_cast<graph::VertexId>(base + (i - first));
+			if (i < last) {
+				graph_.AddEdge({ stops[i], on_board, settings_.bus_wait_time });
+				edge_info_.push_back({ EdgeType::BOARD, stops[i] });
+				graph_.AddEdge({ on_board, on_board + 1, catalogue_.GetDistance(stops[i], stops[i + 1]) / meters_per_minute });
+				edge_info_.push_back({ EdgeType::RIDE, bus });
+			}
+			if (i > first) {
+				graph_.AddEdge({ on_board, stops[i], 0 });
+				edge_info_.push_back({ EdgeType::ALIGHT, stops[i] });
+			}
+		}
+	}
+
+	std::optional<RouteResult> TransportRouter::FindRoute(std::string_view from, std::string_view to) const {
+		const Stop* from_stop = catalogue_.GetStop(from);
+		const Stop* to_stop = catalogue_.GetStop(to);
+		if (!from_stop || !to_stop) {
+			return nullopt;
+		}
+		return FindRoute(from_stop->id, to_stop->id);
+	}
+
+	std::optional<RouteResult> TransportRouter::FindRoute(StopId from, StopId to) const {
+
+		optional<double> total_time;
+		vector<graph::EdgeId> path;
+		if (hierarchy_) {
+			auto search = hierarchy_searches_.Acquire([this] { return make_unique<graph::HierarchySearch>(*hierarchy_); });
+			total_time = search->Run(from, to);
+			if (total_time) {
+				path = search->GetPath();
+			}
+		}
+		else {
+			auto search = searches_.Acquire([this] { return make_unique<graph::DijkstraSearch>(graph_); });
+			total_time = search->Run(from, to);
+			if (total_time) {
+				path = search->GetPath(to);
+			}
+		}
+		if (!total_time) {
+			return nullopt;
+		}
+
+		// consecutive rides are one trip on the bus
+		RouteResult result{ *total_time, {} };
+		for (graph::EdgeId id : path) {
+			const EdgeInfo& info = edge_info_[id];
+			const double time = graph_.GetEdge(id).weight;
+			switch (info.type) {
+			case EdgeType::BOARD:
+				result.items.push_back({ RouteItem::Type::WAIT, catalogue_.GetStop(info.id)->name, 0, time });
+				break;
+			case EdgeType::RIDE:
+				if (result.items.back().type == RouteItem::Type::WAIT) {
+					result.items.push_back({ RouteItem::Type::BUS, catalogue_.GetRoute(info.id)->name, 0, 0 });
+				}
+				++result.items.back().span_count;
+				result.items.back().time += time;
+				break;
+			case EdgeType::ALIGHT:
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<ReachableStop> TransportRouter::FindReachableStops(StopId from, double max_time) const {
+
+		auto search = searches_.Acquire([this] { return make_unique<graph::DijkstraSearch>(graph_); });
+		const size_t stop_count = catalogue_.GetStopCount();
+
+		vector<ReachableStop> result;
+		for (graph::VertexId vertex : search->RunBounded(from, max_time)) {
+			if (vertex < stop_count) {
+				result.push_back({ vertex, search->GetWeight(vertex) });
+			}
+		}
+		// settled in the order of time already, only ties are left
+		stable_sort(result.begin(), result.end(), [](const ReachableStop& lhs, const ReachableStop& rhs) {
+			return lhs.time < rhs.time || (lhs.time == rhs.time && lhs.id < rhs.id);
+			});
+		return result;
+	}
+
+	std::vector<double> TransportRouter::ComputeTravelTimes(const std::vector<StopId>& sources, const std::vector<StopId>& targets,
+		unsigned threads) const {
+
+		vector<double> times(sources.size() * targets.size());
+		if (times.empty()) {
+			return times;
+		}
+
+		// a one-to-many search per source; rows are disjoint, so the threads write without locking
+		utils::ParallelFor(sources.size(), threads, [&](size_t begin, size_t end) {
+			auto search = searches_.Acquire([this] { return make_unique<graph::DijkstraSearch>(graph_); });
+			for (size_t row = begin; row < end; ++row) {
+				search->RunToTargets(sources[row], targets);
+				double* times_row = times.data() + row * targets.size();
+				for (size_t column = 0; column < targets.size(); ++column) {
+					times_row[column] = search->GetWeight(targets[column]);
+				}
+			}
+			});
+		return times;
+	}
+
+	void TransportRouter::BuildHierarchy() {
+		hierarchy_searches_.Clear();
+		hierarchy_ = make_unique<graph::ContractionHierarchy>(graph_);
+	}
+
+	void TransportRouter::SaveHierarchy(std::ostream& output) const {
+		if (!hierarchy_) {
+			throw logic_error("no hierarchy to save");
+		}
+		hierarchy_->Save(output);
+	}
+
+	void TransportRouter::LoadHierarchy(std::istream& input) {
+		auto hierarchy = make_unique<graph::ContractionHierarchy>(graph::ContractionHierarchy::Load(input, graph_));
+		hierarchy_searches_.Clear();
+		hierarchy_ = move(hierarchy);
+	}
+
+	bool TransportRouter::HasHierarchy() const {
+		return hierarchy_ != nullptr;
+	}
+
+	uint64_t TransportRouter::GetCatalogueVersion() const {
+		return version_;
+	}
+
+	const graph::DirectedWeightedGraph& TransportRouter::GetGraph() const {
+		return graph_;
+	}
+
+	namespace tests {
+		void TestTransportRouter()
+		{
+			TransportCatalogue catalogue;
+			catalogue.AddStop("A", { 55.60, 37.60 });
+			catalogue.AddStop("B", { 55.61, 37.61 });
+			catalogue.AddStop("C", { 55.62, 37.62 });
+			catalogue.AddStop("D", { 55.63, 37.63 });
+			catalogue.AddStop("E", { 55.64, 37.64 });
+			catalogue.SetDistance("A", "B", 1000);
+			catalogue.SetDistance("B", "C", 2000);
+			catalogue.SetDistance("C", "D", 3000);
+			catalogue.SetDistance("D", "C", 500);
+			catalogue.AddRoute("1", { "A", "B", "C" }, false);
+			catalogue.AddRoute("2", { "C", "D", "C" }, true);
+
+			// 1 km per minute
+			const TransportRouter router(catalogue, { 2, 60 });
+			assert(router.GetCatalogueVersion() == catalogue.GetVersion());
+
+			const auto a_to_c = router.FindRoute("A", "C");
+			assert(a_to_c && a_to_c->total_time == 5);
+			assert(a_to_c->items.size() == 2);
+			assert(a_to_c->items[0].type == RouteItem::Type::WAIT && a_to_c->items[0].name == "A" && a_to_c->items[0].time == 2);
+			assert(a_to_c->items[1].type == RouteItem::Type::BUS && a_to_c->items[1].name == "1");
+			assert(a_to_c->items[1].span_count == 2 && a_to_c->items[1].time == 3);
+
+			assert(router.FindRoute("C", "A")->total_time == 5);
+			assert(router.FindRoute("B", "A")->total_time == 3);
+
+			const auto a_to_d = router.FindRoute("A", "D");
+			assert(a_to_d->total_time == 10 && a_to_d->items.size() == 4);
+			assert(a_to_d->items[2].name == "C" && a_to_d->items[3].name == "2" && a_to_d->items[3].span_count == 1);
+
+			const auto d_to_b = router.FindRoute("D", "B");
+			assert(d_to_b->total_time == 6.5 && d_to_b->items[1].time == 0.5 && d_to_b->items[3].time == 2);
+
+			const auto a_to_a = router.FindRoute("A", "A");
+			assert(a_to_a->total_time == 0 && a_to_a->items.empty());
+
+			assert(!router.FindRoute("A", "E"));
+			assert(!router.FindRoute("A", "unknown"));
+
+			// isochrones agree with the routes
+			const auto from_a = router.FindReachableStops(0, 5);
+			assert(from_a.size() == 3 && from_a[0].id == 0 && from_a[0].time == 0);
+			assert(from_a[1].id == 1 && from_a[1].time == 3 && from_a[2].id == 2 && from_a[2].time == 5);
+			assert(router.FindReachableStops(0, 4.5).size() == 2);
+			assert(router.FindReachableStops(4, 100).size() == 1);
+			for (StopId from = 0; from < catalogue.GetStopCount(); ++from) {
+				for (double max_time : { 0.0, 3.0, 6.5, 12.0 }) {
+					size_t expected = 0;
+					for (StopId to = 0; to < catalogue.GetStopCount(); ++to) {
+						const auto route = router.FindRoute(from, to);
+						expected += route && route->total_time <= max_time;
+					}
+					assert(router.FindReachableStops(from, max_time).size() == expected);
+				}
+			}
+
+			// the matrix agrees with the routes whatever the number of threads
+			const std::vector<StopId> sources{ 0, 3, 4, 0 };
+			const std::vector<StopId> targets{ 2, 0, 4 };
+			const auto times = router.ComputeTravelTimes(sources, targets, 1);
+			assert(times.size() == sources.size() * targets.size());
+			assert(router.ComputeTravelTimes(sources, targets, 3) == times);
+			for (size_t row = 0; row < sources.size(); ++row) {
+				for (size_t column = 0; column < targets.size(); ++column) {
+					const auto route = router.FindRoute(sources[row], targets[column]);
+					assert(route ? route->total_time == times[row * targets.size() + column]
+						: times[row * targets.size() + column] == std::numeric_limits<double>::infinity());
+				}
+			}
+			assert(router.ComputeTravelTimes({}, targets).empty());
+
+			// the hierarchy gives the same answers, also after a save / load round trip
+			TransportRouter fast_router(catalogue, { 2, 60 });
+			fast_router.BuildHierarchy();
+			std::stringstream stream;
+			fast_router.SaveHierarchy(stream);
+			TransportRouter loaded_router(catalogue, { 2, 60 });
+			loaded_router.LoadHierarchy(stream);
+			assert(loaded_router.HasHierarchy());
+
+			for (const TransportRouter* hierarchy_router : { &fast_router, &loaded_router }) {
+				for (StopId from = 0; from < catalogue.GetStopCount(); ++from) {
+					for (StopId to = 0; to < catalogue.GetStopCount(); ++to) {
+						const auto expected = router.FindRoute(from, to);
+						const auto actual = hierarchy_router->FindRoute(from, to);
+						assert(expected.has_value() == actual.has_value());
+						if (expected) {
+							assert(expected->total_time == actual->total_time && expected->items.size() == actual->items.size());
+						}
+					}
+				}
+			}
+			const auto d_to_b_fast = fast_router.FindRoute("D", "B");
+			assert(d_to_b_fast->items[1].name == "2" && d_to_b_fast->items[3].name == "1" && d_to_b_fast->items[3].span_count == 1);
+
+			// a hierarchy of another graph is refused
+			stream.clear();
+			stream.seekg(0);
+			TransportRouter slow_router(catalogue, { 3, 60 });
+			bool thrown = false;
+			try {
+				slow_router.LoadHierarchy(stream);
+			}
+			catch (const graph::HierarchyError&) {
+				thrown = true;
+			}
+			assert(thrown && !slow_router.HasHierarchy());
+		}
+
+		void BenchmarkTransportRouter()
+		{
+			using Clock = std::chrono::steady_clock;
+			const auto ms = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+			// stops on a grid, a non-ring bus along every row and column and a ring around every block of 10 x 10
+			constexpr int SIDE = 60;
+			std::mt19937 generator(1);
+			std::uniform_int_distribution<unsigned> distance(300, 1500);
+
+			std::vector<std::string> names;
+			for (int i = 0; i < SIDE * SIDE; ++i) {
+				names.push_back("stop " + std::to_string(i));
+			}
+			TransportCatalogue catalogue;
+			for (int i = 0; i < SIDE * SIDE; ++i) {
+				catalogue.AddStop(names[i], { 55.5 + i / SIDE * 0.003, 37.3 + i % SIDE * 0.005 });
+			}
+			int bus_number = 0;
+			const auto add_bus = [&](std::vector<std::string> stops, bool is_ring) {
+				for (size_t i = 0; i + 1 < stops.size(); ++i) {
+					catalogue.SetDistance(stops[i], stops[i + 1], distance(generator));
+				}
+				catalogue.AddRoute(std::to_string(bus_number++), stops, is_ring);
+			};
+			for (int line = 0; line < SIDE; ++line) {
+				std::vector<std::string> row, column;
+				for (int i = 0; i < SIDE; ++i) {
+					row.push_back(names[line * SIDE + i]);
+					column.push_back(names[i * SIDE + line]);
+				}
+				add_bus(row, false);
+				add_bus(column, false);
+			}
+			for (int top = 0; top + 10 < SIDE; top += 10) {
+				for (int left = 0; left + 10 < SIDE; left += 10) {
+					std::vector<std::string> ring;
+					for (int i = 0; i < 10; ++i) {
+						ring.push_back(names[top * SIDE + left + i]);
+					}
+					for (int i = 0; i < 10; ++i) {
+						ring.push_back(names[(top + i) * SIDE + left + 10]);
+					}
+					for (int i = 10; i > 0; --i) {
+						ring.push_back(names[(top + 10) * SIDE + left + i]);
+					}
+					for (int i = 10; i > 0; --i) {
+						ring.push_back(names[(top + i) * SIDE + left]);
+					}
+					ring.push_back(ring.front());
+					add_bus(ring, true);
+				}
+			}
+
+			const auto graph_start = Clock::now();
+			TransportRouter router(catalogue, { 6, 40 });
+			const auto graph_time = Clock::now() - graph_start;
+
+			std::uniform_int_distribution<StopId> stop(0, SIDE * SIDE - 1);
+			std::vector<std::pair<StopId, StopId>> queries(300);
+			for (auto& query : queries) {
+				query = { stop(generator), stop(generator) };
+			}
+
+			double checksum = 0;
+			const auto plain_start = Clock::now();
+			for (const auto& [from, to] : queries) {
+				checksum += router.FindRoute(from, to)->total_time;
+			}
+			const auto plain_time = Clock::now() - plain_start;
+
+			const auto build_start = Clock::now();
+			router.BuildHierarchy();
+			const auto build_time = Clock::now() - build_start;
+
+			const auto ch_start = Clock::now();
+			for (const auto& [from, to] : queries) {
+				checksum -= router.FindRoute(from, to)->total_time;
+			}
+			const auto ch_time = Clock::now() - ch_start;
+
+			size_t reachable = 0;
+			const auto isochrone_start = Clock::now();
+			for (const auto& query : queries) {
+				reachable += router.FindReachableStops(query.first, 30).size();
+			}
+			const auto isochrone_time = Clock::now() - isochrone_start;
+
+			std::vector<StopId> matrix_stops(200);
+			for (StopId& id : matrix_stops) {
+				id = stop(generator);
+			}
+			const auto matrix_start = Clock::now();
+			router.ComputeTravelTimes(matrix_stops, matrix_stops);
+			const auto matrix_time = Clock::now() - matrix_start;
+
+			std::cerr << "stops: " << catalogue.GetStopCount() << ", buses: " << catalogue.GetRouteCount()
+				<< ", graph: " << router.GetGraph().GetVertexCount() << " vertices, " << router.GetGraph().GetEdgeCount() << " edges\n"
+				<< "graph build: " << ms(graph_time) << " ms, hierarchy build: " << ms(build_time) << " ms\n"
+				<< "dijkstra route: " << ms(plain_time) / queries.size() << " ms\n"
+				<< "hierarchy route: " << ms(ch_time) / queries.size() << " ms\n"
+				<< "30 minute isochrone: " << ms(isochrone_time) / queries.size() << " ms, "
+				<< reachable / queries.size() << " stops on average\n"
+				<< matrix_stops.size() << " x " << matrix_stops.size() << " matrix: " << ms(matrix_time) << " ms on "
+				<< utils::DefaultThreadCount() << " threads\n"
+				<< "total time difference (should be ~0): " << checksum << '\n';
+		}
+	}
+
+}
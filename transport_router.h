@@ -0,0 +1,110 @@
+#pragma once
+
+#include "contraction_hierarchy.h"
+#include "graph.h"
+#include "parallel.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace transport::router {
+
+	struct RoutingSettings {
+		double bus_wait_time = 0; // minutes
+		double bus_velocity = 1;  // km/h
+	};
+
+	struct RouteItem {
+		enum class Type {
+			WAIT, // at stop "name"
+			BUS,  // ride on bus "name" over span_count stops
+		};
+
+		Type type;
+		std::string_view name;
+		int span_count;
+		double time; // minutes
+	};
+
+	struct RouteResult {
+		double total_time; // minutes
+		std::vector<RouteItem> items;
+	};
+
+	struct ReachableStop {
+		StopId id;
+		double time; // minutes
+	};
+
+	// Travel graph of the catalogue, built once in the constructor:
+	// - a vertex per stop, where a passenger waits for a bus;
+	// - a vertex per stop of every route run, where the passenger is on board.
+	// Boarding costs the wait time, riding to the next stop costs the road distance at
+	// bus velocity, getting off is free. A non-ring route is two runs (there and back),
+	// so passing the terminal means getting off and waiting again.
+	// The router refers to the catalogue, which must outlive it and not change while it is used.
+	// Queries may run concurrently, each on search buffers of its own that are kept for the next ones.
+	class TransportRouter {
+	public:
+		TransportRouter(const TransportCatalogue& catalogue, RoutingSettings settings);
+
+		std::optional<RouteResult> FindRoute(std::string_view from, std::string_view to) const;
+		std::optional<RouteResult> FindRoute(StopId from, StopId to) const;
+
+		// stops with the earliest arrival from "from" within max_time minutes (including
+		// "from" itself), by time then id; the search goes no further than max_time
+		std::vector<ReachableStop> FindReachableStops(StopId from, double max_time) const;
+		// travel times from every source to every target, row-major with a row per source,
+		// infinity where there is no route; the sources are split between the threads
+		std::vector<double> ComputeTravelTimes(const std::vector<StopId>& sources, const std::vector<StopId>& targets,
+			unsigned threads = utils::DefaultThreadCount()) const;
+
+		// Optional preprocessing: once a contraction hierarchy is built or loaded, FindRoute
+		// runs a bidirectional search over it instead of plain Dijkstra
+		void BuildHierarchy();
+		void SaveHierarchy(std::ostream& output) const;
+		void LoadHierarchy(std::istream& input); // throws graph::HierarchyError if it does not fit the graph
+		bool HasHierarchy() const;
+
+		// catalogue version the graph was built from
+		uint64_t GetCatalogueVersion() const;
+		const graph::DirectedWeightedGraph& GetGraph() const;
+
+	private:
+		enum class EdgeType : uint8_t {
+			BOARD,
+			RIDE,
+			ALIGHT,
+		};
+
+		struct EdgeInfo {
+			EdgeType type;
+			uint32_t id; // StopId for BOARD, BusId for RIDE
+		};
+
+		// stops[first..last] of the route, on board vertices from "base" on
+		void AddRun(BusId bus, const std::pmr::vector<StopId>& stops, size_t first, size_t last, graph::VertexId base);
+
+	private:
+		const TransportCatalogue& catalogue_;
+		RoutingSettings settings_;
+		uint64_t version_;
+
+		graph::DirectedWeightedGraph graph_;
+		std::vector<EdgeInfo> edge_info_; // index: EdgeId
+		mutable utils::ObjectPool<graph::DijkstraSearch> searches_;
+		std::unique_ptr<graph::ContractionHierarchy> hierarchy_;
+		mutable utils::ObjectPool<graph::HierarchySearch> hierarchy_searches_;
+	};
+
+	namespace tests {
+		void TestTransportRouter();
+		void BenchmarkTransportRouter(); // prints to std::cerr
+	}
+
+}